@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "citadel/nnue.hpp"
+#include "citadel/position.hpp"
+#include "citadel/search.hpp"
+
+using citadel::Position;
+
+// Replaces the global allocator to count heap allocations made while searching, and fails if
+// any of them happens below the root (negamax/quiescence). Allocations outside the hot path
+// (root move list, PV extraction, info callbacks) are reported but allowed.
+
+static std::atomic<std::uint64_t> g_allocs{0};
+static std::atomic<std::uint64_t> g_hotAllocs{0};
+static std::atomic<std::uint64_t> g_hotBytes{0};
+
+static void* countedAlloc(std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (citadel::searchHotPathActive()) {
+    g_hotAllocs.fetch_add(1, std::memory_order_relaxed);
+    g_hotBytes.fetch_add(n, std::memory_order_relaxed);
+  }
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n) {
+  return countedAlloc(n);
+}
+void* operator new[](std::size_t n) {
+  return countedAlloc(n);
+}
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+static std::optional<std::string> argValue(int argc, char** argv, std::string_view key) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::string_view(argv[i]) == key) return std::string(argv[i + 1]);
+  }
+  return std::nullopt;
+}
+
+static int intArg(int argc, char** argv, std::string_view key, int def) {
+  if (auto v = argValue(argc, argv, key)) return std::atoi(v->c_str());
+  return def;
+}
+
+static void usage(std::string_view exe) {
+  std::cerr << "Usage:\n"
+            << "  " << exe << " [--fenfile <file>] [--depth N] [--limit N] [--nnuefile <path>]\n"
+            << "       (defaults: fen.txt, depth 5, first 32 positions, HCE unless --nnuefile is given)\n"
+            << "       exits with status 1 if the search allocated below the root\n";
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 1 && (std::string_view(argv[1]) == "-h" || std::string_view(argv[1]) == "--help")) {
+      usage(argv[0]);
+      return 0;
+    }
+    const std::string fenFile = argValue(argc, argv, "--fenfile").value_or("fen.txt");
+    const int depth = std::max(1, intArg(argc, argv, "--depth", 5));
+    const int limit = std::max(1, intArg(argc, argv, "--limit", 32));
+
+    std::vector<Position> positions;
+    {
+      std::ifstream f(fenFile);
+      if (!f) throw std::runtime_error("failed to open fenfile: " + fenFile);
+      std::string line;
+      while (std::getline(f, line) && static_cast<int>(positions.size()) < limit) {
+        if (line.empty() || line[0] == '#') continue;
+        Position p = Position::fromFEN(line.substr(0, line.find(';')));
+        if (!p.gameOver()) positions.push_back(std::move(p));
+      }
+    }
+    if (positions.empty()) throw std::runtime_error("no playable positions in " + fenFile);
+
+    citadel::NNUE nnue;
+    if (auto path = argValue(argc, argv, "--nnuefile")) {
+      if (!nnue.loadFromFile(*path)) throw std::runtime_error("nnue load failed: " + nnue.lastError());
+    }
+
+    citadel::SearchOptions opt;
+    opt.limits.depth = depth;
+    opt.evalBackend = nnue.loaded() ? citadel::EvalBackend::NNUE : citadel::EvalBackend::HCE;
+    opt.nnue = nnue.loaded() ? &nnue : nullptr;
+    std::uint64_t infos = 0;
+    opt.onInfo = [&](const citadel::SearchInfo&) { ++infos; };
+
+    // Warm-up: TT and thread-local buffers are allocated on first use.
+    {
+      Position p = positions.front();
+      (void)citadel::searchBestMove(p, opt);
+    }
+    const std::uint64_t warmupHot = g_hotAllocs.exchange(0);
+    g_hotBytes.store(0);
+
+    std::uint64_t nodes = 0;
+    std::uint64_t allocs = 0;
+    int failed = 0;
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      Position p = positions[i];
+      citadel::clearTranspositionTable();
+      const std::uint64_t a0 = g_allocs.load();
+      const std::uint64_t h0 = g_hotAllocs.load();
+      const std::uint64_t b0 = g_hotBytes.load();
+      const auto r = citadel::searchBestMove(p, opt);
+      nodes += r.nodes;
+      allocs += g_allocs.load() - a0;
+      const std::uint64_t hot = g_hotAllocs.load() - h0;
+      if (hot > 0) {
+        ++failed;
+        std::cout << "FAIL " << hot << " allocations (" << (g_hotBytes.load() - b0) << " bytes) below the root: " << positions[i].toFEN() << "\n";
+      }
+    }
+
+    std::cout << "Searches        : " << positions.size() << " (depth " << depth << ", " << (nnue.loaded() ? "nnue" : "hce") << ")\n";
+    std::cout << "Nodes           : " << nodes << "\n";
+    std::cout << "Info callbacks  : " << infos << "\n";
+    std::cout << "Allocations     : " << allocs << " (root / reporting only)\n";
+    std::cout << "Hot-path allocs : " << g_hotAllocs.load() << " (warm-up: " << warmupHot << ")\n";
+    std::cout << (failed ? "FAILED" : "OK") << "\n";
+    return failed ? 1 : 0;
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+}
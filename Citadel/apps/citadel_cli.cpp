@@ -1,14 +1,22 @@
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <chrono>
 #include <cctype>
 #include <ctime>
 #include <exception>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <random>
@@ -19,8 +27,19 @@
 #include <vector>
 
 #include "citadel/perft.hpp"
+#include "citadel/hashfilter.hpp"
+#include "citadel/hce.hpp"
+#include "citadel/hcetuner.hpp"
+#include "citadel/mappedfile.hpp"
 #include "citadel/nnue.hpp"
+#include "citadel/nnuetrain.hpp"
+#include "citadel/parallel.hpp"
+#include "citadel/perfcounters.hpp"
 #include "citadel/search.hpp"
+#include "citadel/searchparams.hpp"
+#include "citadel/trace.hpp"
+#include "citadel/trainingdata.hpp"
+#include "citadel/uciprocess.hpp"
 
 using citadel::Move;
 using citadel::MoveList;
@@ -30,6 +49,8 @@ static constexpr const char* DEFAULT_NNUE_FILE = "/Users/parent/Desktop/Citadel/
 
 static std::string toLowerCopy(std::string_view sv);
 static std::optional<std::string> argValue(int argc, char** argv, std::string_view key);
+static std::string moveToUciToken(const Move& m);
+static std::optional<Move> parseMoveToken(Position& pos, std::string_view tok);
 
 static std::optional<citadel::EvalBackend> parseEvalBackend(std::string_view s) {
   const std::string v = toLowerCopy(s);
@@ -63,6 +84,8 @@ static EvalContext loadEvalForCommand(int argc, char** argv) {
   if (auto v = argValue(argc, argv, "--nnuefile")) {
     if (!v->empty()) ec.nnueFile = *v;
   }
+  if (auto v = argValue(argc, argv, "--hce-params")) citadel::setHceParams(citadel::HceParams::load(*v));
+  if (auto v = argValue(argc, argv, "--search-params")) citadel::setSearchParams(citadel::SearchParams::load(*v));
 
   if (ec.backend == citadel::EvalBackend::NNUE) {
     if (!ec.nnue.loadFromFile(ec.nnueFile)) {
@@ -77,12 +100,42 @@ static EvalContext loadEvalForCommand(int argc, char** argv) {
 static void usage(std::string_view exe) {
   std::cerr << "Usage:\n"
             << "  " << exe << " uci\n"
-            << "  " << exe << " perft <depth> [--fen <fen>] [--divide]\n"
-            << "  " << exe << " bestmove [--depth N] [--fen <fen>] [--eval hce|nnue] [--nnuefile <path>]\n"
+            << "  " << exe << " perft <depth> [--fen <fen>] [--divide] [--threads N] [--hash MB]\n"
+            << "       (--threads 0 uses all hardware threads; --hash caches subtree counts)\n"
+            << "  " << exe << " perft --suite <file> [--depth N] [--generate <out>] [--threads N] [--hash MB]\n"
+            << "       (EPD lines '<fen> ;D1 n ;D2 n ...'; --generate writes counts up to --depth)\n"
+            << "  " << exe << " bench [depth=6] [threads=1] [hce|nnue] [--nnuefile <path>] [--perf]\n"
+            << "  " << exe << " bestmove [--depth N] [--multipv N] [--rootmoves] [--fen <fen>] [--eval hce|nnue] [--nnuefile <path>]\n"
             << "  " << exe << " play [--engine white|black|none] [--depth N] [--fen <fen>] [--pgn <file>] [--append] [--eval hce|nnue] [--nnuefile <path>]\n"
             << "  " << exe << " selfplay [--depth N] [--maxplies N] [--fen <fen>] [--pgn <file>] [--append] [--eval hce|nnue] [--nnuefile <path>]\n"
             << "  " << exe << " datagen --out <file> [--samples N] [--depth N] [--maxplies N] [--fen <fen>] [--append] [--seed N]\n"
             << "                 [--random-move-prob P] [--randomize-start N] [--threads N] [--fenfile <file>] [--eval hce|nnue] [--nnuefile <path>]\n"
+            << "                 [--format text|bin|chain] [--adj-win CP] [--adj-win-plies N] [--adj-draw CP] [--adj-draw-plies N] [--dedup MB]\n"
+            << "                 [--nodes N] [--shards] [--checkpoint SECS] [--resume]\n"
+            << "       (bin: 64-byte packed records; chain: per-game start position + 4 bytes per sample)\n"
+            << "       (--shards: one file per thread (data.bin -> data.000.bin, ...), progress in <out>.manifest every --checkpoint seconds;\n"
+            << "        --resume continues an interrupted sharded run with the same --out; --nodes: node budget per search)\n"
+            << "  " << exe << " relabel --in <file> --out <file> [--depth N] [--nodes N] [--threads N] [--eval hce|nnue] [--nnuefile <path>]\n"
+            << "       (re-searches every sample of a datagen file, text or binary; only the evals change)\n"
+            << "  " << exe << " data stats <files...> [--threads N] [--dedup MB]\n"
+            << "  " << exe << " data merge <files...> --out <file> [--format text|bin|chain] [--threads N]\n"
+            << "  " << exe << " data shuffle <files...> --out <file> [--format text|bin] [--memory MB] [--tmpdir <dir>] [--seed N] [--threads N]\n"
+            << "       (inputs: text, bin or chain datagen files, or a sharded run's .manifest)\n"
+            << "  " << exe << " train <files...> --out <net.cnue> [--val <file>] [--epochs N] [--batch N] [--lr X] [--lr-gamma X]\n"
+            << "                 [--lambda X] [--wdl-scale X] [--shuffle-buffer N] [--threads N] [--seed N]\n"
+            << "       (lambda weighs the search eval against the game result; the net is rewritten after every epoch)\n"
+            << "  " << exe << " tune <files...> --out <params.txt> [--params <start.txt>] [--iterations N] [--lr X] [--lambda X]\n"
+            << "                 [--wdl-scale X] [--report N] [--threads N]\n"
+            << "       (fits the HCE weights; any command taking --eval also takes --hce-params <file>)\n"
+            << "  " << exe << " spsa --out <params.txt> [--iterations N] [--nodes N] [--depth N] [--tune a,b,...] [--r-end X] [--alpha X] [--gamma X]\n"
+            << "                 [--openings <fenfile>] [--random-plies N] [--maxplies N] [--adj-win CP] [--adj-draw CP] [--threads N] [--seed N]\n"
+            << "                 [--eval hce|nnue] [--nnuefile <path>] [--search-params <start.txt>]\n"
+            << "       (tunes the search parameters with local game pairs; any command taking --eval also takes --search-params <file>)\n"
+            << "  " << exe << " match --engine1 <spec> --engine2 <spec> [--games N] [--concurrency N] [--depth N] [--nodes N] [--movetime MS]\n"
+            << "                 [--tc S[+INC]] [--openings <fenfile>] [--random-plies N] [--pgn <file>] [--append] [--report N] [--seed N]\n"
+            << "                 [--sprt] [--elo0 X] [--elo1 X] [--alpha X] [--beta X] [--maxplies N] [--adj-win CP] [--adj-draw CP] [--time-margin MS]\n"
+            << "       (spec: comma-separated name=, eval=hce|nnue, nnue=<path>, params=<search params>, depth=, nodes=, movetime=, tc=,\n"
+            << "        option.<Name>=<value>, cmd=<UCI engine command> (last); openings default to fen.txt, each played with both colours)\n"
             << "  " << exe << " review [--depth N] [--pgn <file>|-] [--eval hce|nnue] [--nnuefile <path>]\n"
             << "       (omit --pgn or use '-' to read PGN from stdin)\n";
 }
@@ -236,8 +289,120 @@ static void maybeWritePgnToFile(const std::optional<std::string>& pgnPath, bool
   writePgnGame(f, eventName, whiteName, blackName, "local", todayPgnDate(), "1", startFen, resultTok, termination, moves, startPos);
 }
 
+// perft --suite <file>: checks every position against its expected counts, positions spread
+// over all threads. With --generate <out> the counts up to --depth are written instead.
+static void cmdPerftSuite(int argc, char** argv, const std::string& suitePath, int threads, citadel::PerftHash* hash) {
+  std::ifstream f(suitePath);
+  if (!f) throw std::runtime_error("perft: failed to open suite: " + suitePath);
+  const std::vector<citadel::PerftSuiteEntry> suite = citadel::loadPerftSuite(f);
+  if (suite.empty()) throw std::runtime_error("perft: suite is empty: " + suitePath);
+
+  const int maxDepth = intArg(argc, argv, "--depth", 0); // 0 = every depth listed in the file
+  const auto genPath = argValue(argc, argv, "--generate");
+  if (genPath && maxDepth <= 0) throw std::runtime_error("perft: --generate needs --depth N");
+
+  struct Result {
+    std::vector<std::uint64_t> got;
+    int failDepth = 0;
+    std::string error;
+  };
+  std::vector<Result> results(suite.size());
+  std::atomic<std::size_t> next{0};
+  std::atomic<std::uint64_t> totalNodes{0};
+
+  auto worker = [&]() {
+    while (true) {
+      const std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= suite.size()) break;
+      const citadel::PerftSuiteEntry& e = suite[i];
+      Result& r = results[i];
+
+      int depths = genPath ? maxDepth : static_cast<int>(e.expected.size());
+      if (maxDepth > 0) depths = std::min(depths, maxDepth);
+      r.got.assign(static_cast<std::size_t>(std::max(depths, 0)), 0);
+      try {
+        Position pos = Position::fromFEN(e.fen);
+        for (int d = 1; d <= depths; ++d) {
+          const std::size_t k = static_cast<std::size_t>(d - 1);
+          if (!genPath && e.expected[k] == 0) continue;
+          const std::uint64_t n = hash ? citadel::perftHashed(pos, d, *hash) : citadel::perft(pos, d);
+          r.got[k] = n;
+          totalNodes.fetch_add(n, std::memory_order_relaxed);
+          if (!genPath && n != e.expected[k]) {
+            r.failDepth = d;
+            break;
+          }
+        }
+      } catch (const std::exception& ex) {
+        r.error = ex.what();
+      }
+    }
+  };
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  pool.reserve(static_cast<std::size_t>(threads));
+  for (int t = 0; t < threads; ++t) pool.emplace_back(worker);
+  for (auto& th : pool) th.join();
+  const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+
+  int failures = 0;
+  for (std::size_t i = 0; i < suite.size(); ++i) {
+    const Result& r = results[i];
+    if (!r.error.empty()) {
+      ++failures;
+      std::cout << "ERROR #" << (i + 1) << ": " << r.error << "\n  " << suite[i].fen << "\n";
+      continue;
+    }
+    if (r.failDepth == 0) continue;
+    ++failures;
+
+    // Drill down: per-move counts at the failing depth, to diff against a known-good build.
+    const std::size_t k = static_cast<std::size_t>(r.failDepth - 1);
+    std::cout << "FAIL  #" << (i + 1) << " D" << r.failDepth << ": expected " << suite[i].expected[k] << ", got " << r.got[k] << "\n  "
+              << suite[i].fen << "\n";
+    const Position pos = Position::fromFEN(suite[i].fen);
+    for (const auto& [m, n] : citadel::perftDivideParallel(pos, r.failDepth, threads, hash)) {
+      std::cout << "    " << citadel::moveToString(m) << "  " << n << "\n";
+    }
+  }
+
+  if (genPath) {
+    std::ofstream out(*genPath, std::ios::out | std::ios::trunc);
+    if (!out) throw std::runtime_error("perft: failed to open for writing: " + *genPath);
+    for (std::size_t i = 0; i < suite.size(); ++i) {
+      if (!results[i].error.empty()) continue;
+      out << citadel::formatPerftSuiteLine(citadel::PerftSuiteEntry{suite[i].fen, results[i].got}) << "\n";
+    }
+    std::cout << "Wrote " << (suite.size() - static_cast<std::size_t>(failures)) << " positions (D1..D" << maxDepth << ") to " << *genPath << "\n";
+  } else {
+    std::cout << "Passed: " << (suite.size() - static_cast<std::size_t>(failures)) << " / " << suite.size() << "\n";
+  }
+
+  const std::uint64_t nodes = totalNodes.load(std::memory_order_relaxed);
+  std::cout << "Nodes: " << nodes << "\n";
+  std::cout << "Time : " << dt.count() << " s (" << threads << " threads)\n";
+  std::cout << "NPS  : " << static_cast<std::uint64_t>(dt.count() > 0.0 ? static_cast<double>(nodes) / dt.count() : 0.0) << "\n";
+
+  if (failures > 0) throw std::runtime_error("perft suite: " + std::to_string(failures) + " failing position(s)");
+}
+
 static void cmdPerft(int argc, char** argv) {
   if (argc < 3) throw std::runtime_error("perft: missing depth");
+  const auto suitePath = argValue(argc, argv, "--suite");
+  int threads = intArg(argc, argv, "--threads", suitePath ? 0 : 1);
+  if (threads <= 0) {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+  }
+  const int hashMb = intArg(argc, argv, "--hash", 0);
+  std::unique_ptr<citadel::PerftHash> hash;
+  if (hashMb > 0) hash = std::make_unique<citadel::PerftHash>(static_cast<std::size_t>(hashMb));
+  if (suitePath) {
+    cmdPerftSuite(argc, argv, *suitePath, threads, hash.get());
+    return;
+  }
+
   const int depth = std::atoi(argv[2]);
   Position pos = loadPositionFromArgs(argc, argv);
 
@@ -245,7 +410,7 @@ static void cmdPerft(int argc, char** argv) {
   std::cout << "FEN: " << pos.toFEN() << "\n\n";
 
   if (hasFlag(argc, argv, "--divide")) {
-    const auto rows = citadel::perftDivide(pos, depth);
+    const auto rows = citadel::perftDivideParallel(pos, depth, threads, hash.get());
     std::uint64_t total = 0;
     for (const auto& [m, n] : rows) {
       std::cout << citadel::moveToString(m) << "  " << n << "\n";
@@ -253,15 +418,157 @@ static void cmdPerft(int argc, char** argv) {
     }
     std::cout << "Total: " << total << "\n";
   } else {
-    const auto st = citadel::perftTimed(pos, depth);
+    const auto st = citadel::perftTimed(pos, depth, threads, hash.get());
     std::cout << "Nodes: " << st.nodes << "\n";
     std::cout << "Time : " << st.seconds << " s\n";
     std::cout << "NPS  : " << static_cast<std::uint64_t>(st.nps) << "\n";
   }
 }
 
+// Fixed bench positions: every 17th line of fen.txt (openings, wall-heavy middlegames, endgames).
+// Changing this list changes the bench signature.
+static constexpr const char* BENCH_FENS[] = {
+    "clpisiplc/mlmmmmmlm/mmm3mmm/9/9/9/MMM3MMM/MLMMMMMLM/CLPISIPLC w Bb - 0 1",
+    "pppwwwppp/mmmwswmmm/mmmw1wmmm/2p1w1p2/2mi1m3/2LP1PL2/9/1L1MCM1L1/C2ISI2C w Bb - 0 1",
+    "Mpwi1swpM/wMwwwwwMw/cw1wlw1wc/www1w1www/1r1R1R1r1/WWW1W1WWW/CW1WLW1WC/WmWWWWWmW/mPWI1SWPm w Bb - 0 1",
+    "cpl1s1lpc/mmmmmmmmm/9/9/1RRR1RRR1/9/9/2M1M1M2/2C1S1C2 b Bb - 0 1",
+    "ll2s1l1c/p1l1p1l1l/Wc1iR1WiR/m1mm1mmmm/wmRmmmR2/WMRMR3M/MIMM1MMMM/1ILP1I1I1/C1PPS1PLC w Bb - 0 1",
+    "p1wsw4/2wm5/1wwmr1S2/1w1w5/wmwr1R2W/1WW2W2M/M1W1RW3/2WMM4/3W1L1W1 b - - 0 1",
+    "clpisiplc/mmmmmmmmm/9/9/9/6W2/6M2/MMMMMM1MM/CLPISIPLC b Bb 0 1",
+    "clpisiplc/mmmmmmmmm/9/9/9/9/3L5/MMMMMMMMM/C1PISIPLC b Bb - 0 1",
+    "cl1isi2c/mmmmmmmmm/5p3/9/4p4/2W1L4/2M6/MM1MMMMMM/C1PISIP1C w Bb - 0 1",
+    "clpis1plc/mmmmm1mmm/6mi1/6w2/9/2W6/1IMP5/MMM1MMMMM/CL2SIPLC b Bb 0 1",
+    "c1p1siplc/mm1mmmmmm/1im6/2w1l4/9/4L1W2/3L2MI1/MMMMMM1MM/C1PIS1P1C b Bb - 0 1",
+    "clpisiplc/mmmmmmmmm/9/6L2/9/9/9/MMMMMMMMM/C1PISIPLC b Bb - 0 1",
+    "c1pisc3/mmmmm1mmm/3l2mi1/3pl1w2/9/4L1W2/3L1PMI1/MMMMMWMMM/1CPIS3C w Bb 0 1",
+    "c1pisi1lc/mm1mmmmmm/2ml1p3/2w6/9/2W1L4/2M2P3/MM1MMMMMM/C1PISI1LC w Bb 0 1",
+    "cl2siplc/mmmimmmmm/3p5/2rm5/9/2W4I1/2MW1M3/MM1MM1MMM/CLPIS1PLC b Bb - 0 1",
+    "c2isi1lc/mmmmmm1mm/3l1pm2/6w2/9/6W2/3P2M2/MMMMMM1MM/CL1ISI1LC b Bb 0 1",
+};
+
+struct BenchResult {
+  std::uint64_t nodes = 0;
+  double seconds = 0.0;
+};
+
+// Searches every bench position to `depth` from a cleared TT; total nodes is a deterministic
+// signature of search behaviour. threads > 1 searches positions concurrently without the TT
+// (it is single-threaded), which gives a different (but again deterministic) signature.
+// With `perf`, hardware counters are read around the searches and reported per node.
+static BenchResult runBench(int depth, int threads, citadel::EvalBackend backend, const citadel::NNUE* nnue,
+                            const std::function<void(const std::string&)>& out, citadel::PerfCounters* perf = nullptr) {
+  constexpr std::size_t count = std::size(BENCH_FENS);
+  std::vector<citadel::SearchResult> results(count);
+  std::atomic<std::size_t> next{0};
+
+  auto searchOne = [&](std::size_t i, bool useTT) {
+    Position pos = Position::fromFEN(BENCH_FENS[i]);
+    citadel::SearchOptions opt;
+    opt.limits.depth = depth;
+    opt.evalBackend = backend;
+    opt.nnue = nnue;
+    opt.useTT = useTT;
+    if (useTT) citadel::clearTranspositionTable();
+    results[i] = citadel::searchBestMove(pos, opt);
+  };
+
+  citadel::clearEvalCache();
+  if (perf) perf->start();
+  const auto t0 = std::chrono::steady_clock::now();
+  if (threads <= 1) {
+    for (std::size_t i = 0; i < count; ++i) searchOne(i, true);
+  } else {
+    std::vector<std::thread> pool;
+    pool.reserve(static_cast<std::size_t>(threads));
+    for (int t = 0; t < threads; ++t) {
+      pool.emplace_back([&]() {
+        citadel::traceThreadName("bench");
+        for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) searchOne(i, false);
+      });
+    }
+    for (auto& th : pool) th.join();
+  }
+  const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+  if (perf) perf->stop();
+
+  BenchResult br;
+  br.seconds = dt.count();
+  citadel::SearchStats stats;
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto& r = results[i];
+    br.nodes += r.nodes;
+    stats += r.stats;
+    out("Position " + std::to_string(i + 1) + "/" + std::to_string(count) + ": bestmove " + citadel::moveToString(r.best) + " score " +
+        std::to_string(r.score) + " nodes " + std::to_string(r.nodes));
+  }
+  out("===========================");
+  out("Total time (ms) : " + std::to_string(static_cast<std::uint64_t>(br.seconds * 1000.0)));
+  out("Nodes searched  : " + std::to_string(br.nodes));
+  out("Nodes/second    : " + std::to_string(static_cast<std::uint64_t>(br.seconds > 0.0 ? static_cast<double>(br.nodes) / br.seconds : 0.0)));
+  if (perf) {
+    using PC = citadel::PerfCounters;
+    const PC::Sample smp = perf->read();
+    const double nodes = static_cast<double>(std::max<std::uint64_t>(br.nodes, 1));
+    for (int e = 0; e < PC::EventCount; ++e) {
+      const auto ev = static_cast<PC::Event>(e);
+      std::ostringstream os;
+      os << std::left << std::setw(20) << (std::string(PC::eventName(ev)) + "/node") << ": ";
+      if (smp.valid[ev]) {
+        os << std::fixed << std::setprecision(2) << static_cast<double>(smp.value[ev]) / nodes << " (total " << smp.value[ev] << ")";
+      } else {
+        os << "n/a";
+      }
+      out(os.str());
+    }
+    if (smp.valid[PC::Cycles] && smp.valid[PC::Instructions] && smp.value[PC::Cycles] > 0) {
+      std::ostringstream os;
+      os << std::left << std::setw(20) << "IPC" << ": " << std::fixed << std::setprecision(2)
+         << static_cast<double>(smp.value[PC::Instructions]) / static_cast<double>(smp.value[PC::Cycles]);
+      out(os.str());
+    }
+  }
+  if constexpr (citadel::kSearchStatsEnabled) {
+    for (const auto& l : citadel::formatSearchStats(stats)) out("stats " + l);
+  }
+  return br;
+}
+
+// bench [depth] [threads] [eval] [--perf]
+static void cmdBench(int argc, char** argv) {
+  // Positional arguments stop at the first option.
+  int npos = 2;
+  while (npos < argc && std::string_view(argv[npos]).substr(0, 2) != "--") ++npos;
+  const int depth = (npos > 2) ? std::atoi(argv[2]) : 6;
+  const int threads = (npos > 3) ? std::atoi(argv[3]) : 1;
+  citadel::EvalBackend backend = citadel::EvalBackend::HCE;
+  if (npos > 4) {
+    const auto eb = parseEvalBackend(argv[4]);
+    if (!eb) throw std::runtime_error(std::string("bench: unknown eval '") + argv[4] + "'");
+    backend = *eb;
+  }
+  if (depth <= 0) throw std::runtime_error("bench: depth must be > 0");
+
+  citadel::NNUE nnue;
+  if (backend == citadel::EvalBackend::NNUE) {
+    const std::string file = argValue(argc, argv, "--nnuefile").value_or(DEFAULT_NNUE_FILE);
+    if (!nnue.loadFromFile(file)) throw std::runtime_error("bench: nnue load failed: " + nnue.lastError());
+  }
+
+  // Counters are optional: without them the bench still runs and reports NPS.
+  citadel::PerfCounters perf;
+  bool usePerf = hasFlag(argc, argv, "--perf");
+  if (usePerf && !perf.open()) {
+    std::cerr << "bench: hardware counters unavailable (" << perf.lastError() << ")\n";
+    usePerf = false;
+  }
+
+  (void)runBench(depth, threads, backend, nnue.loaded() ? &nnue : nullptr, [](const std::string& line) { std::cout << line << "\n"; },
+                 usePerf ? &perf : nullptr);
+}
+
 static void cmdBestmove(int argc, char** argv) {
   const int depth = intArg(argc, argv, "--depth", 4);
+  const int multiPV = intArg(argc, argv, "--multipv", 1);
   Position pos = loadPositionFromArgs(argc, argv);
 
   std::cout << pos.pretty() << "\n";
@@ -272,12 +579,40 @@ static void cmdBestmove(int argc, char** argv) {
   opt.limits.depth = depth;
   opt.evalBackend = ec.backend;
   opt.nnue = ec.nnuePtr();
+  opt.multiPV = multiPV;
+
+  // Keep the lines of the deepest completed iteration.
+  std::vector<citadel::SearchInfo> lines;
+  if (multiPV > 1) {
+    opt.onInfo = [&](const citadel::SearchInfo& info) {
+      if (info.multipv == 1) lines.clear();
+      lines.push_back(info);
+    };
+  }
+
   auto r = citadel::searchBestMove(pos, opt);
+  if (hasFlag(argc, argv, "--rootmoves")) {
+    for (const auto& rm : r.rootMoves) {
+      std::cout << std::setw(7) << rm.score << (rm.exact ? ' ' : '<') << std::setw(10) << rm.nodes << " ";
+      for (const auto& m : rm.pv) std::cout << ' ' << citadel::moveToString(m);
+      std::cout << "\n";
+    }
+  }
+  for (const auto& l : lines) {
+    std::cout << "line " << l.multipv << "   " << std::setw(7) << l.score << " ";
+    for (const auto& m : l.pv) std::cout << ' ' << citadel::moveToString(m);
+    std::cout << "\n";
+  }
   std::cout << "bestmove " << citadel::moveToString(r.best) << "\n";
   std::cout << "score    " << r.score << "\n";
   std::cout << "nodes    " << r.nodes << "\n";
   std::cout << "time     " << r.seconds << " s\n";
   if (r.seconds > 0.0) std::cout << "nps      " << static_cast<std::uint64_t>(static_cast<double>(r.nodes) / r.seconds) << "\n";
+  if (r.evalCacheProbes > 0) {
+    std::cout << "evalhit  " << std::fixed << std::setprecision(1)
+              << (100.0 * static_cast<double>(r.evalCacheHits) / static_cast<double>(r.evalCacheProbes)) << "% (" << r.evalCacheHits << " / "
+              << r.evalCacheProbes << ")\n";
+  }
 }
 
 static std::optional<citadel::Color> parseColor(std::string_view s) {
@@ -416,26 +751,217 @@ static void cmdSelfplay(int argc, char** argv) {
   maybeWritePgnToFile(pgnPath, append, "Citadel Self-Play", "Citadel", "Citadel", startFen, resultTok, term, history, startPos);
 }
 
+// Sharded datagen: one output file per worker plus a text manifest, rewritten at checkpoints so
+// an interrupted run can be resumed (shards are truncated back to the last committed game).
+struct DatagenShard {
+  std::string path;
+  std::uint64_t quota = 0; // samples this shard should hold
+  std::uint64_t done = 0;  // samples committed (flushed) so far
+  std::uint64_t bytes = 0; // committed file size
+  std::uint64_t games = 0;
+};
+
+struct DatagenManifest {
+  citadel::DataFormat format = citadel::DataFormat::Text;
+  int seed = 0;
+  int generation = 0; // incremented by every --resume so resumed workers play new games
+  bool complete = false;
+  std::vector<DatagenShard> shards;
+};
+
+static std::string shardPath(const std::string& out, int index) {
+  char num[16];
+  std::snprintf(num, sizeof(num), ".%03d", index);
+  const std::size_t slash = out.find_last_of("/\\");
+  const std::size_t dot = out.find_last_of('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return out + num;
+  return out.substr(0, dot) + num + out.substr(dot);
+}
+
+static void writeDatagenManifest(const std::string& path, const DatagenManifest& m) {
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream f(tmp, std::ios::trunc);
+    if (!f) throw std::runtime_error("datagen: failed to write manifest " + tmp);
+    f << "# Citadel datagen manifest\n";
+    f << "format=" << citadel::dataFormatName(m.format) << "\n";
+    f << "seed=" << m.seed << "\n";
+    f << "generation=" << m.generation << "\n";
+    f << "complete=" << (m.complete ? 1 : 0) << "\n";
+    for (const auto& s : m.shards) {
+      f << "shard " << s.path << " quota=" << s.quota << " done=" << s.done << " bytes=" << s.bytes << " games=" << s.games << "\n";
+    }
+    if (!f.flush()) throw std::runtime_error("datagen: failed to write manifest " + tmp);
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) throw std::runtime_error("datagen: failed to replace manifest " + path);
+}
+
+static DatagenManifest readDatagenManifest(const std::string& path) {
+  std::ifstream f(path);
+  if (!f) throw std::runtime_error("datagen: no manifest to resume from: " + path);
+  DatagenManifest m;
+  std::string line;
+  while (std::getline(f, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream iss(line);
+    std::string key;
+    iss >> key;
+    if (key == "shard") {
+      DatagenShard s;
+      iss >> s.path;
+      std::string kv;
+      while (iss >> kv) {
+        const std::size_t eq = kv.find('=');
+        if (eq == std::string::npos) continue;
+        const std::uint64_t v = std::strtoull(kv.c_str() + eq + 1, nullptr, 10);
+        const std::string k = kv.substr(0, eq);
+        if (k == "quota") s.quota = v;
+        else if (k == "done") s.done = v;
+        else if (k == "bytes") s.bytes = v;
+        else if (k == "games") s.games = v;
+      }
+      m.shards.push_back(s);
+      continue;
+    }
+    const std::size_t eq = key.find('=');
+    if (eq == std::string::npos) continue;
+    const std::string k = key.substr(0, eq);
+    const std::string v = key.substr(eq + 1);
+    if (k == "format") {
+      const auto fmt = citadel::parseDataFormat(v);
+      if (!fmt) throw std::runtime_error("datagen: manifest has unknown format '" + v + "'");
+      m.format = *fmt;
+    } else if (k == "seed") {
+      m.seed = std::atoi(v.c_str());
+    } else if (k == "generation") {
+      m.generation = std::atoi(v.c_str());
+    } else if (k == "complete") {
+      m.complete = v == "1";
+    }
+  }
+  if (m.shards.empty()) throw std::runtime_error("datagen: manifest lists no shards: " + path);
+  return m;
+}
+
+// Game adjudication of datagen, spsa and match (0 disables a rule): |score| >= win for winPlies
+// plies in a row is a win for the side ahead; |score| <= draw for drawPlies plies with no
+// catapult left is a draw.
+struct AdjudicationSettings {
+  int win = 1500;
+  int winPlies = 8;
+  int draw = 20;
+  int drawPlies = 16;
+};
+
+static AdjudicationSettings adjudicationFromArgs(int argc, char** argv) {
+  AdjudicationSettings a;
+  a.win = intArg(argc, argv, "--adj-win", a.win);
+  a.winPlies = intArg(argc, argv, "--adj-win-plies", a.winPlies);
+  a.draw = intArg(argc, argv, "--adj-draw", a.draw);
+  a.drawPlies = intArg(argc, argv, "--adj-draw-plies", a.drawPlies);
+  return a;
+}
+
+class Adjudicator {
+public:
+  explicit Adjudicator(const AdjudicationSettings& s) : s_(s) {}
+
+  // Feeds the search score (White's view) of the searched position `pos`, before its move.
+  void update(const Position& pos, int whiteScore) {
+    if (s_.win > 0 && std::abs(whiteScore) >= s_.win) {
+      winStreak_ = (whiteScore > 0) ? std::max(winStreak_, 0) + 1 : std::min(winStreak_, 0) - 1;
+    } else {
+      winStreak_ = 0;
+    }
+    const bool noCatapults =
+        pos.pieceCount(citadel::Color::White, citadel::PieceType::Catapult) + pos.pieceCount(citadel::Color::Black, citadel::PieceType::Catapult) == 0;
+    drawStreak_ = (s_.draw > 0 && std::abs(whiteScore) <= s_.draw && noCatapults) ? drawStreak_ + 1 : 0;
+  }
+
+  // The adjudicated result (White's view) once a rule applies.
+  [[nodiscard]] std::optional<std::int8_t> verdict() const {
+    if (s_.winPlies > 0 && std::abs(winStreak_) >= s_.winPlies) return (winStreak_ > 0) ? citadel::kResultWhiteWin : citadel::kResultBlackWin;
+    if (s_.drawPlies > 0 && drawStreak_ >= s_.drawPlies) return citadel::kResultDraw;
+    return std::nullopt;
+  }
+
+private:
+  AdjudicationSettings s_;
+  int winStreak_ = 0; // signed: > 0 White ahead, < 0 Black ahead
+  int drawStreak_ = 0;
+};
+
 static void cmdDatagen(int argc, char** argv) {
-  const int depth = intArg(argc, argv, "--depth", 3);
+  // --nodes gives every search the same node budget (and lifts the default depth cap), so the
+  // cost per sample no longer depends on how tactical the position is.
+  const std::uint64_t nodeBudget = std::strtoull(argValue(argc, argv, "--nodes").value_or("0").c_str(), nullptr, 10);
+  const int depth = intArg(argc, argv, "--depth", nodeBudget ? 64 : 3);
   const int maxPlies = intArg(argc, argv, "--maxplies", 200);
-  const int samples = intArg(argc, argv, "--samples", 10'000);
+  std::uint64_t samples = std::strtoull(argValue(argc, argv, "--samples").value_or("10000").c_str(), nullptr, 10);
   const int randomizeStart = intArg(argc, argv, "--randomize-start", 6);
+  const AdjudicationSettings adj = adjudicationFromArgs(argc, argv);
+  // Optional duplicate filter shared by all workers (Position::hash() keys, bounded memory).
+  const int dedupMB = intArg(argc, argv, "--dedup", 0);
+  std::unique_ptr<citadel::HashFilter> dedup;
+  if (dedupMB > 0) dedup = std::make_unique<citadel::HashFilter>(static_cast<std::size_t>(dedupMB));
   int threads = intArg(argc, argv, "--threads", 1);
   double randomMoveProb = doubleArg(argc, argv, "--random-move-prob", 0.05);
   if (randomMoveProb < 0.0) randomMoveProb = 0.0;
   if (randomMoveProb > 1.0) randomMoveProb = 1.0;
 
   const bool append = hasFlag(argc, argv, "--append");
+  const bool resume = hasFlag(argc, argv, "--resume");
+  const bool sharded = resume || hasFlag(argc, argv, "--shards");
+  const int checkpointSecs = std::max(1, intArg(argc, argv, "--checkpoint", 60));
   const auto outPath = argValue(argc, argv, "--out");
   if (!outPath) throw std::runtime_error("datagen: missing required --out <file>");
+  if (append && sharded) throw std::runtime_error("datagen: --append does not apply to sharded output (use --resume)");
+  const std::string manifestPath = *outPath + ".manifest";
+
+  const auto formatArg = argValue(argc, argv, "--format");
+  const auto parsedFormat = citadel::parseDataFormat(formatArg.value_or("text"));
+  if (!parsedFormat) throw std::runtime_error("datagen: unknown --format '" + *formatArg + "' (text|bin|chain)");
+  citadel::DataFormat format = *parsedFormat;
 
   const auto fenFilePath = argValue(argc, argv, "--fenfile");
 
   int seed = intArg(argc, argv, "--seed", 0);
   if (seed == 0) seed = static_cast<int>(std::time(nullptr));
 
-  if (samples <= 0) throw std::runtime_error("datagen: --samples must be > 0");
+  if (threads <= 0) {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+  }
+
+  // A resumed run takes its shape (format, seed, shards and their quotas) from the manifest; the
+  // search settings are taken from the command line as usual.
+  DatagenManifest manifest;
+  if (resume) {
+    manifest = readDatagenManifest(manifestPath);
+    if (manifest.complete) {
+      std::cerr << "datagen: " << manifestPath << " is already complete, nothing to resume\n";
+      return;
+    }
+    if (formatArg && manifest.format != format) throw std::runtime_error("datagen: --format differs from the manifest being resumed");
+    format = manifest.format;
+    seed = manifest.seed;
+    ++manifest.generation;
+    threads = static_cast<int>(manifest.shards.size());
+    samples = 0;
+    for (const auto& s : manifest.shards) samples += s.quota;
+  } else if (sharded) {
+    manifest.format = format;
+    manifest.seed = seed;
+    for (int t = 0; t < threads; ++t) {
+      DatagenShard s;
+      s.path = shardPath(*outPath, t);
+      s.quota = samples / static_cast<std::uint64_t>(threads) + (static_cast<std::uint64_t>(t) < samples % static_cast<std::uint64_t>(threads) ? 1 : 0);
+      manifest.shards.push_back(s);
+    }
+  }
+  const bool binary = format != citadel::DataFormat::Text;
+
+  if (samples == 0) throw std::runtime_error("datagen: --samples must be > 0");
   if (depth <= 0) throw std::runtime_error("datagen: --depth must be > 0");
   if (maxPlies <= 0) throw std::runtime_error("datagen: --maxplies must be > 0");
 
@@ -444,11 +970,6 @@ static void cmdDatagen(int argc, char** argv) {
 
   EvalContext ec = loadEvalForCommand(argc, argv);
 
-  if (threads <= 0) {
-    threads = static_cast<int>(std::thread::hardware_concurrency());
-    if (threads <= 0) threads = 1;
-  }
-
   auto trimCopy = [](std::string_view sv) -> std::string {
     while (!sv.empty() && std::isspace(static_cast<unsigned char>(sv.front()))) sv.remove_prefix(1);
     while (!sv.empty() && std::isspace(static_cast<unsigned char>(sv.back()))) sv.remove_suffix(1);
@@ -471,49 +992,166 @@ static void cmdDatagen(int argc, char** argv) {
     if (startFens.empty()) throw std::runtime_error("datagen: fenfile contains no FENs: " + *fenFilePath);
   }
 
+  // File header: the binary DataFileHeader, or the '#' comment block of text files.
+  auto fileHeader = [&]() {
+    std::string header;
+    if (binary) {
+      citadel::appendDataFileHeader(header, format);
+      return header;
+    }
+    std::ostringstream h;
+    h << "# Citadel NNUE training data\n";
+    h << "# Format: <FEN> | <stm> <eval> <result>\n";
+    h << "# eval is centipawn-like from side-to-move (stm) perspective.\n";
+    h << "# result is the game outcome from White's perspective: 1 win, 0 draw, -1 loss.\n";
+    h << "# depth=" << depth << " nodes=" << nodeBudget << " maxplies=" << maxPlies << " samples=" << samples << " seed=" << seed
+      << " randomMoveProb=" << randomMoveProb << " randomizeStart=" << randomizeStart << " threads=" << threads << "\n";
+    h << "# adjudication win=" << adj.win << "x" << adj.winPlies << " draw=" << adj.draw << "x" << adj.drawPlies << "\n";
+    h << "# base_fen=" << baseFen << "\n";
+    if (fenFilePath) h << "# fenfile=" << *fenFilePath << " count=" << startFens.size() << "\n";
+    h << "# eval_backend=" << ((ec.backend == citadel::EvalBackend::NNUE && ec.nnuePtr()) ? "NNUE" : "HCE") << "\n";
+    if (ec.backend == citadel::EvalBackend::NNUE) h << "# nnue_file=" << ec.nnueFile << "\n";
+    return h.str();
+  };
+
+  const std::ios::openmode mode = binary ? std::ios::binary : std::ios::openmode{};
+
+  // Single-file output: workers share one stream and draw sample tickets from one counter.
   std::ofstream out;
-  out.open(*outPath, append ? std::ios::out | std::ios::app : std::ios::out | std::ios::trunc);
-  if (!out) throw std::runtime_error("datagen: failed to open output file");
+  if (!sharded) {
+    // Appending to an empty or missing file still needs the header.
+    bool writeHeader = !append;
+    if (append) {
+      std::ifstream probe(*outPath, std::ios::binary | std::ios::ate);
+      writeHeader = !probe || probe.tellg() <= 0;
+      // Records of another format would corrupt the file.
+      if (!writeHeader) {
+        const citadel::DataFormat existing = citadel::TrainingDataReader(*outPath).format();
+        if (existing != format) {
+          throw std::runtime_error(std::string("datagen: cannot append --format ") + citadel::dataFormatName(format) + " to " + *outPath + " (" +
+                                   citadel::dataFormatName(existing) + ")");
+        }
+      }
+    }
+    out.open(*outPath, mode | (append ? std::ios::out | std::ios::app : std::ios::out | std::ios::trunc));
+    if (!out) throw std::runtime_error("datagen: failed to open output file");
+    if (writeHeader) out << fileHeader();
+  }
 
-  if (!append) {
-    out << "# Citadel NNUE training data\n";
-    out << "# Format: <FEN> | <stm> <eval>\n";
-    out << "# eval is centipawn-like from side-to-move (stm) perspective.\n";
-    out << "# depth=" << depth << " maxplies=" << maxPlies << " samples=" << samples << " seed=" << seed << " randomMoveProb=" << randomMoveProb
-        << " randomizeStart=" << randomizeStart << " threads=" << threads << "\n";
-    out << "# base_fen=" << baseFen << "\n";
-    if (fenFilePath) out << "# fenfile=" << *fenFilePath << " count=" << startFens.size() << "\n";
-    out << "# eval_backend=" << ((ec.backend == citadel::EvalBackend::NNUE && ec.nnuePtr()) ? "NNUE" : "HCE") << "\n";
-    if (ec.backend == citadel::EvalBackend::NNUE) out << "# nnue_file=" << ec.nnueFile << "\n";
+  // Sharded output: each worker owns a file and a fixed quota, so nothing is shared per sample.
+  // A shard being resumed is cut back to the size recorded at the last checkpoint, which always
+  // ends on a game boundary.
+  std::vector<std::ofstream> shardOut(sharded ? static_cast<std::size_t>(threads) : 0);
+  for (std::size_t t = 0; t < shardOut.size(); ++t) {
+    DatagenShard& s = manifest.shards[t];
+    if (resume && s.bytes > 0) {
+      // Only ever cut back: a shard shorter than its checkpoint lost data, and extending it
+      // would pad it with zeros.
+      std::error_code ec2;
+      const std::uintmax_t onDisk = std::filesystem::file_size(s.path, ec2);
+      if (ec2) throw std::runtime_error("datagen: cannot resume shard " + s.path + ": " + ec2.message());
+      if (onDisk < s.bytes) {
+        throw std::runtime_error("datagen: cannot resume shard " + s.path + ": " + std::to_string(onDisk) + " bytes on disk, manifest records " +
+                                 std::to_string(s.bytes));
+      }
+      std::filesystem::resize_file(s.path, s.bytes, ec2);
+      if (ec2) throw std::runtime_error("datagen: cannot truncate shard " + s.path + ": " + ec2.message());
+      shardOut[t].open(s.path, mode | std::ios::out | std::ios::app);
+    } else {
+      shardOut[t].open(s.path, mode | std::ios::out | std::ios::trunc);
+    }
+    if (!shardOut[t]) throw std::runtime_error("datagen: failed to open shard " + s.path);
+    if (s.bytes == 0) {
+      const std::string header = fileHeader();
+      // On disk before the manifest below records it.
+      shardOut[t] << header;
+      if (!shardOut[t].flush()) throw std::runtime_error("datagen: write failed on shard " + s.path);
+      s.bytes = header.size();
+    }
+  }
+  std::mutex manifestMu; // guards manifest.shards progress fields
+  if (sharded) writeDatagenManifest(manifestPath, manifest);
+
+  // The duplicate filter starts with the samples already on disk (resumed shards, or the file
+  // appended to), so earlier runs' positions are not written again.
+  if (dedup) {
+    std::vector<std::string> existing;
+    if (resume) {
+      for (const auto& sh : manifest.shards) existing.push_back(sh.path);
+    } else if (append && !sharded) {
+      existing.push_back(*outPath);
+    }
+    std::uint64_t seeded = 0;
+    for (const auto& path : existing) {
+      citadel::TrainingDataReader reader(path);
+      citadel::PackedPosition pp;
+      while (reader.next(pp)) {
+        dedup->insert(citadel::unpackPosition(pp).hash());
+        ++seeded;
+      }
+    }
+    if (seeded > 0) std::cerr << "datagen: duplicate filter seeded with " << seeded << " existing samples\n";
   }
 
   const bool useTT = (threads == 1); // TT is single-threaded today; disable for parallel datagen.
 
-  std::atomic<int> nextSample{0};
-  std::atomic<int> gameCount{0};
-  std::atomic<int> invalidStart{0};
-  std::atomic<int> lastReport{0};
+  std::atomic<std::uint64_t> nextSample{0};
+  std::atomic<int> running{threads};
+
+  // Statistics are counted per worker and added to the totals at each flush, so nothing shared
+  // is touched per ply.
+  struct Tally {
+    std::uint64_t samples = 0;
+    std::uint64_t games = 0;
+    std::uint64_t plies = 0;
+    std::uint64_t duplicates = 0;
+    std::uint64_t naturalEnds = 0;
+    std::uint64_t adjudicatedWins = 0;
+    std::uint64_t adjudicatedDraws = 0;
+    std::uint64_t maxPlyDraws = 0;
+    std::uint64_t invalidStarts = 0;
+
+    void add(const Tally& o) {
+      samples += o.samples;
+      games += o.games;
+      plies += o.plies;
+      duplicates += o.duplicates;
+      naturalEnds += o.naturalEnds;
+      adjudicatedWins += o.adjudicatedWins;
+      adjudicatedDraws += o.adjudicatedDraws;
+      maxPlyDraws += o.maxPlyDraws;
+      invalidStarts += o.invalidStarts;
+    }
+  };
+  std::mutex totalsMu; // guards totals and lastReport
+  Tally totals;
+
+  std::uint64_t resumedSamples = 0;
+  for (const auto& s : manifest.shards) resumedSamples += s.done;
+  std::uint64_t lastReport = (resumedSamples / 5000) * 5000;
 
   std::mutex outMu;
-  std::mutex errMu;
-
-  auto reportProgress = [&]() {
-    const int w = std::min(nextSample.load(std::memory_order_relaxed), samples);
-    const int milestone = (w / 5000) * 5000;
-    int prev = lastReport.load(std::memory_order_relaxed);
-    if (milestone > prev && lastReport.compare_exchange_strong(prev, milestone)) {
-      std::lock_guard<std::mutex> lk(errMu);
+
+  auto publish = [&](Tally& local) {
+    std::lock_guard<std::mutex> lk(totalsMu);
+    totals.add(local);
+    local = Tally{};
+    const std::uint64_t milestone = (std::min(resumedSamples + totals.samples, samples) / 5000) * 5000;
+    if (milestone > lastReport) {
+      lastReport = milestone;
       std::cerr << "datagen: wrote " << milestone << " / " << samples << " samples\n";
     }
   };
 
   auto worker = [&](int tid) {
-    const std::uint32_t s = static_cast<std::uint32_t>(seed) ^ (0x9E3779B9u * static_cast<std::uint32_t>(tid + 1));
+    std::uint32_t s = static_cast<std::uint32_t>(seed) ^ (0x9E3779B9u * static_cast<std::uint32_t>(tid + 1));
+    s ^= 0x85EBCA6Bu * static_cast<std::uint32_t>(manifest.generation); // new games after a resume
     std::mt19937 rng(s);
     std::uniform_real_distribution<double> uni01(0.0, 1.0);
 
     citadel::SearchOptions sopt;
     sopt.limits.depth = depth;
+    sopt.limits.nodeLimit = nodeBudget;
     sopt.evalBackend = ec.backend;
     sopt.nnue = ec.nnuePtr();
     sopt.useTT = useTT;
@@ -521,22 +1159,67 @@ static void cmdDatagen(int argc, char** argv) {
     std::string buffer;
     buffer.reserve(1 << 20);
 
-    int localGames = 0;
-    while (nextSample.load(std::memory_order_relaxed) < samples) {
-      ++localGames;
-
+    // Sharded workers count against their own quota; `done` includes samples still buffered.
+    const std::size_t shard = static_cast<std::size_t>(tid);
+    std::uint64_t quota = 0;
+    std::uint64_t done = 0;
+    std::uint64_t bufferedSamples = 0;
+    int bufferedGames = 0;
+    Tally tally;
+    if (sharded) {
+      quota = manifest.shards[shard].quota;
+      done = manifest.shards[shard].done;
+    }
+    auto budgetLeft = [&]() { return sharded ? done < quota : nextSample.load(std::memory_order_relaxed) < samples; };
+    auto takeSample = [&]() {
+      if (!sharded) return nextSample.fetch_add(1, std::memory_order_relaxed) < samples;
+      if (done >= quota) return false;
+      ++done;
+      return true;
+    };
+    auto lastFlush = std::chrono::steady_clock::now();
+    auto flush = [&]() {
+      if (!sharded) {
+        std::lock_guard<std::mutex> lk(outMu);
+        out << buffer;
+      } else {
+        // Only whole games reach the buffer, so the recorded size is always a safe resume point.
+        shardOut[shard] << buffer;
+        shardOut[shard].flush();
+        if (!shardOut[shard]) throw std::runtime_error("datagen: write failed on " + manifest.shards[shard].path);
+        std::lock_guard<std::mutex> lk(manifestMu);
+        DatagenShard& m = manifest.shards[shard];
+        m.bytes += buffer.size();
+        m.done += bufferedSamples;
+        m.games += static_cast<std::uint64_t>(bufferedGames);
+      }
+      buffer.clear();
+      bufferedSamples = 0;
+      bufferedGames = 0;
+      lastFlush = std::chrono::steady_clock::now();
+      publish(tally);
+    };
+
+    // Every sample carries the game result, so a game's samples are held until it ends.
+    std::vector<std::string> gameText;
+    std::vector<citadel::PackedPosition> gamePacked;
+    std::vector<citadel::ChainEntry> gameChain;
+    citadel::PackedPosition chainStart;
+
+    while (budgetLeft()) {
       Position pos = base;
       if (!startFens.empty()) {
         const std::size_t idx = static_cast<std::size_t>(rng() % startFens.size());
         try {
           pos = Position::fromFEN(startFens[idx]);
         } catch (const std::exception&) {
-          invalidStart.fetch_add(1, std::memory_order_relaxed);
+          ++tally.invalidStarts;
           continue;
         }
       }
 
       // Randomize the start a bit to diversify openings.
+      int startPly = 0;
       for (int i = 0; i < randomizeStart && !pos.gameOver(); ++i) {
         MoveList moves;
         pos.generateMoves(moves);
@@ -544,25 +1227,50 @@ static void cmdDatagen(int argc, char** argv) {
         const std::uint32_t mi = static_cast<std::uint32_t>(rng() % moves.size);
         citadel::Undo u;
         pos.makeMove(moves.buf[mi], u);
+        ++startPly;
       }
 
-      for (int ply = 0; ply < maxPlies && !pos.gameOver(); ++ply) {
-        if (nextSample.load(std::memory_order_relaxed) >= samples) break;
+      gameText.clear();
+      gamePacked.clear();
+      gameChain.clear();
+      chainStart = citadel::packPosition(pos, 0, citadel::kResultUnknown, startPly);
+      std::uint64_t gameSamples = 0;
+
+      // Once the sample budget is used up the game is still played out (without sampling) so
+      // that its samples get a real result.
+      bool sampling = true;
+      std::optional<std::int8_t> adjudicated;
+      Adjudicator adjudicator(adj);
+
+      int ply = 0;
+      for (; ply < maxPlies && !pos.gameOver(); ++ply) {
+        if (sampling && !budgetLeft()) sampling = false;
+        if (!sampling && gameSamples == 0) break;
 
         const auto r = citadel::searchBestMove(pos, sopt);
         if (r.best.from == citadel::SQ_NONE) break;
+        ++tally.plies;
+
+        // A position already written (by any worker) is played through but not sampled again.
+        // It is marked as seen only once it holds a sample ticket, i.e. will be written; two
+        // workers racing on the same position may both write it.
+        bool sampleThis = sampling;
+        if (sampleThis && dedup && dedup->contains(pos.hash())) {
+          ++tally.duplicates;
+          sampleThis = false;
+        }
+        if (sampleThis && !takeSample()) sampling = sampleThis = false;
+        if (sampleThis && dedup) dedup->insert(pos.hash());
+        if (sampleThis) ++gameSamples;
+
+        if (sampleThis && format == citadel::DataFormat::Packed) {
+          gamePacked.push_back(citadel::packPosition(pos, r.score, citadel::kResultUnknown, startPly + ply));
+        } else if (sampleThis && format == citadel::DataFormat::Text) {
+          const char stm = (pos.turn() == citadel::Color::White) ? 'w' : 'b';
+          gameText.push_back(pos.toFEN() + " | " + stm + ' ' + std::to_string(r.score));
+        }
 
-        const int ticket = nextSample.fetch_add(1, std::memory_order_relaxed);
-        if (ticket >= samples) break;
-
-        const std::string fen = pos.toFEN();
-        const char stm = (pos.turn() == citadel::Color::White) ? 'w' : 'b';
-        buffer += fen;
-        buffer += " | ";
-        buffer.push_back(stm);
-        buffer.push_back(' ');
-        buffer += std::to_string(r.score);
-        buffer.push_back('\n');
+        adjudicator.update(pos, (pos.turn() == citadel::Color::White) ? r.score : -r.score);
 
         // Choose next move: mostly bestmove, occasionally random.
         Move chosen = r.best;
@@ -572,38 +1280,1622 @@ static void cmdDatagen(int argc, char** argv) {
           if (!moves.empty()) chosen = moves.buf[static_cast<std::uint32_t>(rng() % moves.size)];
         }
 
+        if (sampling && format == citadel::DataFormat::Chain) {
+          citadel::ChainEntry e;
+          e.moveIndex = static_cast<std::uint16_t>(citadel::moveIndexOf(pos, chosen));
+          e.eval = sampleThis ? static_cast<std::int16_t>(std::clamp(r.score, -32767, 32767)) : citadel::kChainNoSample;
+          gameChain.push_back(e);
+        }
+
         citadel::Undo u;
         pos.makeMove(chosen, u);
 
-        if (buffer.size() >= (1 << 20)) {
-          std::lock_guard<std::mutex> lk(outMu);
-          out << buffer;
-          buffer.clear();
+        // Adjudicate after the sampled move so the chain stays replayable.
+        adjudicated = adjudicator.verdict();
+        if (adjudicated) {
+          if (*adjudicated == citadel::kResultDraw) ++tally.adjudicatedDraws;
+          else ++tally.adjudicatedWins;
+          break;
         }
+      }
 
-        reportProgress();
+      // Result from White's view: natural end, adjudication, or a draw at the ply limit.
+      std::int8_t result = citadel::kResultDraw;
+      if (adjudicated) {
+        result = *adjudicated;
+      } else if (const auto w = pos.winner()) {
+        result = (*w == citadel::Color::White) ? citadel::kResultWhiteWin : citadel::kResultBlackWin;
+        ++tally.naturalEnds;
+      } else if (ply >= maxPlies) {
+        ++tally.maxPlyDraws;
       }
-    }
 
-    if (!buffer.empty()) {
-      std::lock_guard<std::mutex> lk(outMu);
-      out << buffer;
+      for (const auto& l : gameText) {
+        buffer += l;
+        buffer.push_back(' ');
+        buffer += std::to_string(result);
+        buffer.push_back('\n');
+      }
+      if (binary) {
+        for (auto& pp : gamePacked) {
+          pp.result = result;
+          citadel::appendPacked(buffer, pp);
+        }
+        if (!gameChain.empty()) {
+          chainStart.result = result;
+          citadel::appendChainGame(buffer, chainStart, gameChain);
+        }
+      }
+      bufferedSamples += gameSamples;
+      ++bufferedGames;
+      tally.samples += gameSamples;
+      ++tally.games;
+
+      if (buffer.size() >= (1 << 20) || (sharded && std::chrono::steady_clock::now() - lastFlush >= std::chrono::seconds(checkpointSecs))) flush();
     }
 
-    gameCount.fetch_add(localGames, std::memory_order_relaxed);
+    if (!buffer.empty() || bufferedGames > 0 || tally.invalidStarts > 0) flush();
   };
 
+  // A worker that throws (e.g. disk full) stops the run; what it flushed stays resumable.
+  std::exception_ptr workerError;
+  std::mutex workerErrorMu;
   std::vector<std::thread> pool;
   pool.reserve(static_cast<std::size_t>(threads));
-  for (int t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+  for (int t = 0; t < threads; ++t) {
+    pool.emplace_back([&, t]() {
+      try {
+        worker(t);
+      } catch (...) {
+        std::lock_guard<std::mutex> lk(workerErrorMu);
+        if (!workerError) workerError = std::current_exception();
+      }
+      running.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  // Checkpoints: the manifest only ever lists flushed, whole-game byte counts.
+  if (sharded) {
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    while (running.load(std::memory_order_acquire) > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      if (std::chrono::steady_clock::now() - lastCheckpoint < std::chrono::seconds(checkpointSecs)) continue;
+      std::lock_guard<std::mutex> lk(manifestMu);
+      writeDatagenManifest(manifestPath, manifest);
+      lastCheckpoint = std::chrono::steady_clock::now();
+    }
+  }
   for (auto& th : pool) th.join();
 
-  const int wrote = std::min(nextSample.load(std::memory_order_relaxed), samples);
-  const int games = gameCount.load(std::memory_order_relaxed);
-  const int badStarts = invalidStart.load(std::memory_order_relaxed);
+  if (sharded) {
+    manifest.complete = !workerError;
+    writeDatagenManifest(manifestPath, manifest);
+  }
+  if (workerError) std::rethrow_exception(workerError);
+
+  const std::uint64_t wrote = std::min(resumedSamples + totals.samples, samples);
+  // A resumed run reports the games of all its generations, as its manifest does.
+  std::uint64_t games = totals.games;
+  if (sharded) {
+    games = 0;
+    for (const auto& sh : manifest.shards) games += sh.games;
+  }
+
+  std::cerr << "datagen: done. wrote " << wrote << " samples to " << (sharded ? manifestPath : *outPath) << " (games " << games << ", threads "
+            << threads << ")\n";
+  if (resume) std::cerr << "datagen: resumed generation " << manifest.generation << " from " << resumedSamples << " samples\n";
+  std::cerr << "datagen: game ends: natural " << totals.naturalEnds << ", adjudicated win " << totals.adjudicatedWins << ", adjudicated draw "
+            << totals.adjudicatedDraws << ", max plies " << totals.maxPlyDraws << "; searched plies " << totals.plies << "\n";
+  if (dedup) {
+    const std::uint64_t dups = totals.duplicates;
+    const double rate = 100.0 * static_cast<double>(dups) / static_cast<double>(std::max<std::uint64_t>(dups + wrote - resumedSamples, 1));
+    std::cerr << "datagen: duplicates skipped " << dups << " (" << std::fixed << std::setprecision(1) << rate << "% of sampled positions, filter "
+              << dedupMB << " MB)\n";
+  }
+  if (totals.invalidStarts > 0) std::cerr << "datagen: warning: " << totals.invalidStarts << " invalid start FENs skipped\n";
+}
+
+// Re-searches every sample of an existing datagen file with new settings (depth, node budget,
+// net) and writes the same file with only the evals replaced: order, game results, comments and
+// chain move sequences are kept. Samples are scored in batches spread over the worker threads.
+static void cmdRelabel(int argc, char** argv) {
+  const auto inPath = argValue(argc, argv, "--in");
+  const auto outPath = argValue(argc, argv, "--out");
+  if (!inPath || !outPath) throw std::runtime_error("relabel: missing required --in <file> / --out <file>");
+  {
+    std::error_code ec2;
+    if (std::filesystem::equivalent(*inPath, *outPath, ec2)) throw std::runtime_error("relabel: --out must differ from --in");
+  }
+
+  const std::uint64_t nodeBudget = std::strtoull(argValue(argc, argv, "--nodes").value_or("0").c_str(), nullptr, 10);
+  const int depth = intArg(argc, argv, "--depth", nodeBudget ? 64 : 6);
+  if (depth <= 0) throw std::runtime_error("relabel: --depth must be > 0");
+  int threads = intArg(argc, argv, "--threads", 1);
+  if (threads <= 0) {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+  }
+
+  // Binary datagen files start with the DataFileHeader magic; anything else is read as text.
+  bool binary = false;
+  {
+    std::ifstream probe(*inPath, std::ios::binary);
+    if (!probe) throw std::runtime_error("relabel: failed to open " + *inPath);
+    char magic[4] = {};
+    probe.read(magic, sizeof(magic));
+    const citadel::DataFileHeader expect;
+    binary = probe.gcount() == 4 && std::equal(expect.magic.begin(), expect.magic.end(), magic);
+  }
+
+  EvalContext ec = loadEvalForCommand(argc, argv);
+  const bool useNnue = ec.backend == citadel::EvalBackend::NNUE && ec.nnuePtr();
+
+  // Scores positions[i] into scores[i] (side to move's view); a position without a legal move
+  // keeps its old score.
+  std::vector<Position> positions;
+  std::vector<int> scores;
+  std::atomic<std::uint64_t> totalNodes{0};
+  auto scoreBatch = [&]() {
+    scores.assign(positions.size(), 0);
+    std::vector<char> keep(positions.size(), 0);
+    std::atomic<std::size_t> next{0};
+    auto work = [&]() {
+      citadel::SearchOptions sopt;
+      sopt.limits.depth = depth;
+      sopt.limits.nodeLimit = nodeBudget;
+      sopt.evalBackend = ec.backend;
+      sopt.nnue = ec.nnuePtr();
+      // Every label from a fresh search, so the output does not depend on the thread count (the
+      // TT is global, and would carry entries from one sample to the next).
+      sopt.useTT = false;
+      std::uint64_t nodes = 0;
+      for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed); i < positions.size(); i = next.fetch_add(1, std::memory_order_relaxed)) {
+        Position p = positions[i];
+        if (p.gameOver()) {
+          keep[i] = 1;
+          continue;
+        }
+        const auto r = citadel::searchBestMove(p, sopt);
+        nodes += r.nodes;
+        if (r.best.from == citadel::SQ_NONE) keep[i] = 1;
+        else scores[i] = r.score;
+      }
+      totalNodes.fetch_add(nodes, std::memory_order_relaxed);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& th : pool) th.join();
+    return keep;
+  };
+
+  std::ofstream out(*outPath, binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+  if (!out) throw std::runtime_error("relabel: failed to open output file");
+
+  constexpr std::size_t kBatch = 1u << 14;
+  std::uint64_t relabeled = 0;
+  std::uint64_t kept = 0;
+  std::uint64_t absDelta = 0;
+  std::uint64_t deltaCount = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+
+  auto tally = [&](int before, int after, bool keepOld) {
+    if (keepOld) {
+      ++kept;
+      return;
+    }
+    ++relabeled;
+    // Mate scores (stored clamped to +-32767 in binary files) would swamp the average.
+    if (std::abs(before) < 32767 && std::abs(after) < 32767) {
+      absDelta += static_cast<std::uint64_t>(std::abs(after - before));
+      ++deltaCount;
+    }
+  };
+  auto progress = [&]() { std::cerr << "relabel: " << (relabeled + kept) << " samples\n"; };
+
+  if (!binary) {
+    std::ifstream in(*inPath);
+    std::vector<std::string> lines;
+    std::vector<std::size_t> sampleLine;
+    std::vector<citadel::TextSample> samples;
+    bool sawSample = false;
+    std::uint64_t lineNo = 0;
+    bool eof = false;
+    while (!eof) {
+      lines.clear();
+      sampleLine.clear();
+      samples.clear();
+      positions.clear();
+      std::string line;
+      while (samples.size() < kBatch && !(eof = !std::getline(in, line))) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        auto s = citadel::parseTextSample(line);
+        if (!s) {
+          if (!line.empty() && line.front() != '#') throw std::runtime_error("relabel: bad sample at line " + std::to_string(lineNo) + " of " + *inPath);
+          lines.push_back(line);
+          continue;
+        }
+        if (!sawSample) {
+          // Metadata comments are kept; the relabel settings are recorded after them.
+          std::ostringstream h;
+          h << "# relabel depth=" << depth << " nodes=" << nodeBudget << " eval_backend=" << (useNnue ? "NNUE" : "HCE");
+          if (useNnue) h << " nnue_file=" << ec.nnueFile;
+          lines.push_back(h.str());
+          sawSample = true;
+        }
+        positions.push_back(Position::fromFEN(s->fen));
+        sampleLine.push_back(lines.size());
+        samples.push_back(std::move(*s));
+        lines.emplace_back();
+      }
+      const auto keep = scoreBatch();
+      for (std::size_t i = 0; i < samples.size(); ++i) {
+        tally(samples[i].eval, scores[i], keep[i]);
+        if (!keep[i]) samples[i].eval = scores[i];
+        lines[sampleLine[i]] = citadel::formatTextSample(samples[i]);
+      }
+      for (const auto& l : lines) out << l << '\n';
+      if (!samples.empty()) progress();
+    }
+  } else {
+    citadel::TrainingDataReader reader(*inPath);
+    std::string header;
+    citadel::appendDataFileHeader(header, reader.format());
+    out << header;
+
+    std::string buffer;
+    if (reader.format() == citadel::DataFormat::Packed) {
+      std::vector<citadel::PackedPosition> records;
+      citadel::PackedPosition pp;
+      bool more = true;
+      while (more) {
+        records.clear();
+        positions.clear();
+        while (records.size() < kBatch && (more = reader.next(pp))) {
+          records.push_back(pp);
+          positions.push_back(citadel::unpackPosition(pp));
+        }
+        const auto keep = scoreBatch();
+        buffer.clear();
+        for (std::size_t i = 0; i < records.size(); ++i) {
+          tally(records[i].eval, scores[i], keep[i]);
+          if (!keep[i]) records[i].eval = static_cast<std::int16_t>(std::clamp(scores[i], -32767, 32767));
+          citadel::appendPacked(buffer, records[i]);
+        }
+        out << buffer;
+        if (!records.empty()) progress();
+      }
+    } else {
+      // Chain: the games are replayed to get the sampled positions, and written back with the
+      // same move indices and sample markers.
+      struct Game {
+        citadel::PackedPosition start;
+        std::vector<citadel::ChainEntry> entries;
+      };
+      std::vector<Game> games;
+      std::vector<std::pair<std::size_t, std::size_t>> slots; // (game, entry) per position
+      bool more = true;
+      while (more) {
+        games.clear();
+        slots.clear();
+        positions.clear();
+        Game g;
+        while (positions.size() < kBatch && (more = reader.nextGame(g.start, g.entries))) {
+          Position pos = citadel::unpackPosition(g.start);
+          for (std::size_t e = 0; e < g.entries.size(); ++e) {
+            if (g.entries[e].eval != citadel::kChainNoSample) {
+              positions.push_back(pos);
+              slots.emplace_back(games.size(), e);
+            }
+            if (e + 1 == g.entries.size()) break;
+            MoveList moves;
+            pos.generateMoves(moves);
+            if (g.entries[e].moveIndex >= moves.size) throw std::runtime_error("relabel: move index out of range in " + *inPath);
+            citadel::Undo u;
+            pos.makeMove(moves.buf[g.entries[e].moveIndex], u);
+          }
+          games.push_back(g);
+        }
+        const auto keep = scoreBatch();
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          citadel::ChainEntry& e = games[slots[i].first].entries[slots[i].second];
+          tally(e.eval, scores[i], keep[i]);
+          if (!keep[i]) e.eval = static_cast<std::int16_t>(std::clamp(scores[i], -32767, 32767));
+        }
+        buffer.clear();
+        for (const auto& game : games) citadel::appendChainGame(buffer, game.start, game.entries);
+        out << buffer;
+        if (!slots.empty()) progress();
+      }
+    }
+  }
+
+  out.flush();
+  if (!out) throw std::runtime_error("relabel: write failed on " + *outPath);
+
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  const std::uint64_t total = relabeled + kept;
+  std::cerr << "relabel: done. " << total << " samples (" << relabeled << " rescored, " << kept << " kept) to " << *outPath << " in " << std::fixed
+            << std::setprecision(1) << secs << " s (" << static_cast<std::uint64_t>(static_cast<double>(total) / std::max(secs, 1e-9)) << " samples/s, nodes "
+            << totalNodes.load() << ", threads " << threads << ")\n";
+  if (deltaCount > 0) {
+    std::cerr << "relabel: mean |eval change| " << std::setprecision(1) << static_cast<double>(absDelta) / static_cast<double>(deltaCount)
+              << " over " << deltaCount << " non-mate samples\n";
+  }
+}
+
+// `data` subcommands: statistics, merging and an external-memory shuffle of datagen files.
+// Inputs are positional (up to the first option) and may be text, bin or chain files, or a
+// sharded datagen run's manifest, which stands for all of its shards.
+
+static std::vector<std::string> dataInputsFromArgs(int argc, char** argv) {
+  std::vector<std::string> inputs;
+  for (int i = 3; i < argc && std::string_view(argv[i]).substr(0, 2) != "--"; ++i) {
+    const std::string arg = argv[i];
+    if (arg.size() < 9 || arg.compare(arg.size() - 9, 9, ".manifest") != 0) {
+      inputs.push_back(arg);
+      continue;
+    }
+    // Shard paths are recorded as datagen saw them; fall back to the manifest's directory.
+    const std::filesystem::path dir = std::filesystem::path(arg).parent_path();
+    for (const auto& s : readDatagenManifest(arg).shards) {
+      if (!std::filesystem::exists(s.path) && std::filesystem::exists(dir / std::filesystem::path(s.path).filename())) {
+        inputs.push_back((dir / std::filesystem::path(s.path).filename()).string());
+      } else {
+        inputs.push_back(s.path);
+      }
+    }
+  }
+  if (inputs.empty()) throw std::runtime_error("data: no input files given");
+  return inputs;
+}
+
+static void checkDataOutput(const std::vector<std::string>& inputs, const std::string& out) {
+  for (const auto& in : inputs) {
+    std::error_code ec;
+    if (std::filesystem::equivalent(in, out, ec)) throw std::runtime_error("data: --out must not be one of the inputs: " + out);
+  }
+}
 
-  std::cerr << "datagen: done. wrote " << wrote << " samples to " << *outPath << " (games " << games << ", threads " << threads << ")\n";
-  if (badStarts > 0) std::cerr << "datagen: warning: " << badStarts << " invalid start FENs skipped\n";
+static int dataThreadsArg(int argc, char** argv) {
+  int threads = intArg(argc, argv, "--threads", 0);
+  if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(threads, 1);
+}
+
+// Output of merge/shuffle: bin or text records, converted on several threads.
+class DataWriter {
+public:
+  DataWriter(const std::string& path, citadel::DataFormat format, int threads) : path_(path), format_(format), threads_(threads) {
+    out_.open(path, format == citadel::DataFormat::Text ? std::ios::trunc : std::ios::binary | std::ios::trunc);
+    if (!out_) throw std::runtime_error("data: failed to open output file " + path);
+    std::string header;
+    if (format == citadel::DataFormat::Text) {
+      header = "# Citadel NNUE training data\n# Format: <FEN> | <stm> <eval> <result>\n";
+    } else {
+      citadel::appendDataFileHeader(header, format);
+    }
+    out_ << header;
+  }
+
+  void write(const citadel::PackedPosition* pp, std::size_t n) {
+    if (format_ == citadel::DataFormat::Packed) {
+      out_.write(reinterpret_cast<const char*>(pp), static_cast<std::streamsize>(n * sizeof(citadel::PackedPosition)));
+    } else {
+      // FEN formatting dominates text output, so each slice renders into its own buffer.
+      std::vector<std::string> parts(static_cast<std::size_t>(threads_));
+      citadel::parallelFor(n, threads_, [&](std::size_t slice, std::size_t begin, std::size_t end) {
+        std::string& buf = parts[slice];
+        for (std::size_t i = begin; i < end; ++i) {
+          citadel::TextSample s;
+          s.fen = citadel::unpackPosition(pp[i]).toFEN();
+          s.stm = pp[i].turn();
+          s.eval = pp[i].eval;
+          s.result = pp[i].result;
+          buf += citadel::formatTextSample(s);
+          buf.push_back('\n');
+        }
+      }, 1024);
+      for (const auto& p : parts) out_ << p;
+    }
+    written_ += n;
+  }
+
+  void finish() {
+    out_.flush();
+    if (!out_) throw std::runtime_error("data: write failed on " + path_);
+  }
+
+  [[nodiscard]] std::uint64_t written() const { return written_; }
+
+private:
+  std::ofstream out_;
+  std::string path_;
+  citadel::DataFormat format_;
+  int threads_;
+  std::uint64_t written_ = 0;
+};
+
+struct DataStats {
+  // Eval buckets (side to move, cp) split at these edges; |eval| >= kMateEval counts as a mate.
+  static constexpr std::array<int, 12> kEvalEdges{-1000, -500, -250, -100, -50, -10, 10, 50, 100, 250, 500, 1000};
+  static constexpr int kMateEval = 30000;
+  static constexpr int kPhaseBins = 8;
+  static constexpr int kWallBins = 16; // total wall HP of both sides, last bin is "15+"
+
+  std::uint64_t samples = 0;
+  std::array<std::uint64_t, 4> results{}; // Black win, draw, White win, unknown
+  std::array<std::uint64_t, 2> stm{};
+  std::array<std::uint64_t, kPhaseBins> phase{};
+  std::array<std::uint64_t, kEvalEdges.size() + 1> eval{};
+  std::uint64_t mates = 0;
+  double evalSum = 0.0;
+  double evalSq = 0.0;
+  std::array<std::uint64_t, kWallBins> walls{};
+  std::uint64_t duplicates = 0;
+
+  DataStats& operator+=(const DataStats& o) {
+    samples += o.samples;
+    for (std::size_t i = 0; i < results.size(); ++i) results[i] += o.results[i];
+    for (std::size_t i = 0; i < stm.size(); ++i) stm[i] += o.stm[i];
+    for (std::size_t i = 0; i < phase.size(); ++i) phase[i] += o.phase[i];
+    for (std::size_t i = 0; i < eval.size(); ++i) eval[i] += o.eval[i];
+    for (std::size_t i = 0; i < walls.size(); ++i) walls[i] += o.walls[i];
+    mates += o.mates;
+    evalSum += o.evalSum;
+    evalSq += o.evalSq;
+    duplicates += o.duplicates;
+    return *this;
+  }
+
+  void add(const citadel::PackedPosition& pp, citadel::HashFilter& seen) {
+    ++samples;
+    results[pp.result == citadel::kResultUnknown ? 3 : static_cast<std::size_t>(pp.result + 1)]++;
+    stm[pp.turn() == citadel::Color::White ? 0 : 1]++;
+
+    // Phase as the HCE computes it: 0 = all 34 non-sovereign pieces on the board, 256 = none.
+    int pieces = 0;
+    int wallHp = 0;
+    for (std::uint8_t s = 0; s < citadel::SQ_N; ++s) {
+      const int v = std::abs(pp.rawAt(s));
+      if (v >= 1 && v <= 6 && v - 1 != static_cast<int>(citadel::PieceType::Sovereign)) ++pieces;
+      else if (v >= 7) wallHp += v - 6;
+    }
+    const int ph = (std::max(34 - pieces, 0) * 256 + 17) / 34;
+    phase[static_cast<std::size_t>(std::min(ph * kPhaseBins / 256, kPhaseBins - 1))]++;
+    walls[static_cast<std::size_t>(std::min(wallHp, kWallBins - 1))]++;
+
+    if (std::abs(pp.eval) >= kMateEval) {
+      ++mates;
+    } else {
+      evalSum += pp.eval;
+      evalSq += static_cast<double>(pp.eval) * pp.eval;
+    }
+    eval[static_cast<std::size_t>(std::upper_bound(kEvalEdges.begin(), kEvalEdges.end(), pp.eval) - kEvalEdges.begin())]++;
+
+    // Same position = same board, side to move and rights; the labels may differ.
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(&pp);
+    for (std::size_t i = 0; i < offsetof(citadel::PackedPosition, result); ++i) h = (h ^ bytes[i]) * 0x100000001b3ull;
+    if (!seen.insert(h)) ++duplicates;
+  }
+};
+
+static void printHistogram(std::string_view title, const std::vector<std::pair<std::string, std::uint64_t>>& rows, std::uint64_t total) {
+  std::uint64_t peak = 1;
+  for (const auto& r : rows) peak = std::max(peak, r.second);
+  std::cout << title << "\n";
+  for (const auto& [label, n] : rows) {
+    const double pct = total ? 100.0 * static_cast<double>(n) / static_cast<double>(total) : 0.0;
+    std::cout << "  " << std::setw(14) << label << " " << std::setw(10) << n << " " << std::fixed << std::setprecision(1) << std::setw(5) << pct << "% "
+              << std::string(static_cast<std::size_t>(40 * n / peak), '#') << "\n";
+  }
+}
+
+static void cmdDataStats(int argc, char** argv) {
+  const auto inputs = dataInputsFromArgs(argc, argv);
+  const int threads = dataThreadsArg(argc, argv);
+  const int dedupMB = std::max(1, intArg(argc, argv, "--dedup", 64));
+  citadel::HashFilter seen(static_cast<std::size_t>(dedupMB));
+
+  DataStats total;
+  std::array<int, 3> files{};
+  std::vector<DataStats> local(static_cast<std::size_t>(threads));
+  auto accumulate = [&](const citadel::PackedPosition* pp, std::size_t n) {
+    citadel::parallelFor(n, threads, [&](std::size_t slice, std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) local[slice].add(pp[i], seen);
+    }, 1024);
+  };
+
+  for (const auto& path : inputs) {
+    citadel::TrainingDataReader reader(path);
+    files[static_cast<std::size_t>(reader.format())]++;
+    if (reader.format() == citadel::DataFormat::Packed) {
+      // Packed records are used in place from the mapping.
+      citadel::MappedFile map;
+      if (!map.open(path)) throw std::runtime_error("data: " + map.lastError());
+      map.adviseSequential();
+      const std::size_t bytes = map.size() - sizeof(citadel::DataFileHeader);
+      if (bytes % sizeof(citadel::PackedPosition) != 0) throw std::runtime_error("data: truncated record in " + path);
+      accumulate(reinterpret_cast<const citadel::PackedPosition*>(map.data() + sizeof(citadel::DataFileHeader)), bytes / sizeof(citadel::PackedPosition));
+      continue;
+    }
+    std::vector<citadel::PackedPosition> batch;
+    while (reader.nextBatch(batch, 1u << 16, threads) > 0) accumulate(batch.data(), batch.size());
+  }
+  for (const auto& l : local) total += l;
+
+  const std::uint64_t n = total.samples;
+  std::cout << "Samples        : " << n << " in " << inputs.size() << " files (text " << files[0] << ", bin " << files[1] << ", chain " << files[2] << ")\n";
+  if (n == 0) return;
+  auto pct = [&](std::uint64_t k) {
+    std::ostringstream s;
+    s << k << " (" << std::fixed << std::setprecision(1) << 100.0 * static_cast<double>(k) / static_cast<double>(n) << "%)";
+    return s.str();
+  };
+  std::cout << "Results (White): win " << pct(total.results[2]) << ", draw " << pct(total.results[1]) << ", loss " << pct(total.results[0]) << ", unknown "
+            << pct(total.results[3]) << "\n";
+  std::cout << "Side to move   : white " << pct(total.stm[0]) << ", black " << pct(total.stm[1]) << "\n";
+  std::cout << "Duplicates     : " << pct(total.duplicates) << " (same board, side to move and rights; filter " << dedupMB << " MB)\n";
+
+  const std::uint64_t scored = n - total.mates;
+  const double mean = scored ? total.evalSum / static_cast<double>(scored) : 0.0;
+  const double var = scored ? total.evalSq / static_cast<double>(scored) - mean * mean : 0.0;
+  std::cout << "Eval (stm cp)  : mean " << std::fixed << std::setprecision(1) << mean << ", stddev " << std::sqrt(std::max(var, 0.0)) << ", mate scores "
+            << pct(total.mates) << "\n";
+
+  std::vector<std::pair<std::string, std::uint64_t>> rows;
+  for (int b = 0; b < DataStats::kPhaseBins; ++b) {
+    rows.emplace_back(std::to_string(b * 256 / DataStats::kPhaseBins) + "-" + std::to_string((b + 1) * 256 / DataStats::kPhaseBins), total.phase[static_cast<std::size_t>(b)]);
+  }
+  printHistogram("Phase (0 opening .. 256 no pieces left):", rows, n);
+
+  rows.clear();
+  const auto& edges = DataStats::kEvalEdges;
+  for (std::size_t b = 0; b < total.eval.size(); ++b) {
+    std::string label = (b == 0) ? "< " + std::to_string(edges[0])
+                        : (b == edges.size()) ? ">= " + std::to_string(edges.back())
+                                              : std::to_string(edges[b - 1]) + ".." + std::to_string(edges[b] - 1);
+    rows.emplace_back(label, total.eval[b]);
+  }
+  printHistogram("Eval distribution:", rows, n);
+
+  rows.clear();
+  for (int b = 0; b < DataStats::kWallBins; ++b) {
+    rows.emplace_back(std::to_string(b) + (b + 1 == DataStats::kWallBins ? "+" : ""), total.walls[static_cast<std::size_t>(b)]);
+  }
+  printHistogram("Wall tokens on the board (HP, both sides):", rows, n);
+}
+
+// Output format of merge/shuffle: --format, else the inputs' common format (bin if they differ).
+static citadel::DataFormat dataOutputFormat(int argc, char** argv, const std::vector<std::string>& inputs) {
+  if (auto f = argValue(argc, argv, "--format")) {
+    const auto parsed = citadel::parseDataFormat(*f);
+    if (!parsed) throw std::runtime_error("data: unknown --format '" + *f + "' (text|bin|chain)");
+    return *parsed;
+  }
+  std::optional<citadel::DataFormat> common;
+  for (const auto& path : inputs) {
+    const auto f = citadel::TrainingDataReader(path).format();
+    if (common && *common != f) return citadel::DataFormat::Packed;
+    common = f;
+  }
+  return *common;
+}
+
+static void cmdDataMerge(int argc, char** argv) {
+  const auto inputs = dataInputsFromArgs(argc, argv);
+  const auto outPath = argValue(argc, argv, "--out");
+  if (!outPath) throw std::runtime_error("data merge: missing required --out <file>");
+  checkDataOutput(inputs, *outPath);
+  const int threads = dataThreadsArg(argc, argv);
+  const citadel::DataFormat format = dataOutputFormat(argc, argv, inputs);
+
+  std::uint64_t written = 0;
+  if (format == citadel::DataFormat::Chain) {
+    // Chains are concatenated game by game, which only works if every input is a chain.
+    std::ofstream out(*outPath, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("data merge: failed to open output file " + *outPath);
+    std::string buf;
+    citadel::appendDataFileHeader(buf, format);
+    for (const auto& path : inputs) {
+      citadel::TrainingDataReader reader(path);
+      if (reader.format() != citadel::DataFormat::Chain) throw std::runtime_error("data merge: chain output needs chain inputs: " + path);
+      citadel::PackedPosition start;
+      std::vector<citadel::ChainEntry> entries;
+      while (reader.nextGame(start, entries)) {
+        citadel::appendChainGame(buf, start, entries);
+        for (const auto& e : entries) written += (e.eval != citadel::kChainNoSample);
+        if (buf.size() >= (1u << 20)) {
+          out << buf;
+          buf.clear();
+        }
+      }
+    }
+    out << buf;
+    out.flush();
+    if (!out) throw std::runtime_error("data merge: write failed on " + *outPath);
+  } else {
+    DataWriter out(*outPath, format, threads);
+    std::vector<citadel::PackedPosition> batch;
+    for (const auto& path : inputs) {
+      citadel::TrainingDataReader reader(path);
+      while (reader.nextBatch(batch, 1u << 16, threads) > 0) out.write(batch.data(), batch.size());
+    }
+    out.finish();
+    written = out.written();
+  }
+  std::cerr << "data merge: wrote " << written << " samples from " << inputs.size() << " files to " << *outPath << " (" << citadel::dataFormatName(format) << ")\n";
+}
+
+// Two-pass external shuffle. Pass 1 cuts the input into runs that fit the memory budget,
+// shuffles each in memory and spills it as a packed file. Pass 2 maps the runs and draws the
+// next record from a run chosen with probability proportional to the records it has left,
+// which (with the shuffled runs) makes every output order equally likely.
+static void cmdDataShuffle(int argc, char** argv) {
+  const auto inputs = dataInputsFromArgs(argc, argv);
+  const auto outPath = argValue(argc, argv, "--out");
+  if (!outPath) throw std::runtime_error("data shuffle: missing required --out <file>");
+  checkDataOutput(inputs, *outPath);
+  const int threads = dataThreadsArg(argc, argv);
+  const citadel::DataFormat format = dataOutputFormat(argc, argv, inputs);
+  if (format == citadel::DataFormat::Chain) throw std::runtime_error("data shuffle: chain files keep games in order; use --format bin or text");
+  const int memoryMB = std::max(1, intArg(argc, argv, "--memory", 512));
+  const std::size_t runRecords = std::max<std::size_t>(static_cast<std::size_t>(memoryMB) * 1024 * 1024 / sizeof(citadel::PackedPosition), 1);
+  std::uint64_t seed = std::strtoull(argValue(argc, argv, "--seed").value_or("0").c_str(), nullptr, 10);
+  if (seed == 0) seed = static_cast<std::uint64_t>(std::time(nullptr));
+  std::mt19937_64 rng(seed);
+
+  std::filesystem::path tmpDir = argValue(argc, argv, "--tmpdir").value_or(std::filesystem::path(*outPath).parent_path().string());
+  if (tmpDir.empty()) tmpDir = ".";
+  const std::string runStem = (tmpDir / std::filesystem::path(*outPath).filename()).string() + ".run.";
+
+  // Pass 1.
+  std::vector<std::string> runs;
+  std::vector<std::uint64_t> runSizes;
+  std::vector<citadel::PackedPosition> chunk;
+  chunk.reserve(runRecords);
+  std::vector<citadel::PackedPosition> batch;
+  std::size_t input = 0;
+  std::unique_ptr<citadel::TrainingDataReader> reader;
+  auto fillChunk = [&]() {
+    chunk.clear();
+    while (chunk.size() < runRecords) {
+      if (!reader) {
+        if (input == inputs.size()) break;
+        reader = std::make_unique<citadel::TrainingDataReader>(inputs[input++]);
+      }
+      if (reader->nextBatch(batch, std::min<std::size_t>(runRecords - chunk.size(), 1u << 16), threads) == 0) {
+        reader.reset();
+        continue;
+      }
+      chunk.insert(chunk.end(), batch.begin(), batch.end());
+    }
+    std::shuffle(chunk.begin(), chunk.end(), rng);
+    return !chunk.empty();
+  };
+
+  DataWriter out(*outPath, format, threads);
+  fillChunk();
+  if (chunk.size() < runRecords) {
+    // Everything fit in memory: no spill.
+    out.write(chunk.data(), chunk.size());
+  } else {
+    do {
+      const std::string path = runStem + std::to_string(runs.size());
+      std::ofstream run(path, std::ios::binary | std::ios::trunc);
+      std::string header;
+      citadel::appendDataFileHeader(header, citadel::DataFormat::Packed);
+      run << header;
+      run.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size() * sizeof(citadel::PackedPosition)));
+      if (!run.flush()) throw std::runtime_error("data shuffle: failed to write run file " + path);
+      runs.push_back(path);
+      runSizes.push_back(chunk.size());
+      std::cerr << "data shuffle: run " << runs.size() << " (" << chunk.size() << " samples)\n";
+    } while (fillChunk());
+    std::vector<citadel::PackedPosition>().swap(chunk);
+
+    // Pass 2. A Fenwick tree over the records left per run picks the run for each draw.
+    const std::size_t k = runs.size();
+    std::vector<std::unique_ptr<citadel::MappedFile>> maps;
+    for (const auto& path : runs) {
+      auto m = std::make_unique<citadel::MappedFile>();
+      if (!m->open(path)) throw std::runtime_error("data shuffle: " + m->lastError());
+      m->adviseSequential();
+      maps.push_back(std::move(m));
+    }
+    std::vector<std::uint64_t> tree(k + 1, 0);
+    auto treeAdd = [&](std::size_t i, std::int64_t d) {
+      for (++i; i <= k; i += i & (~i + 1)) tree[i] = static_cast<std::uint64_t>(static_cast<std::int64_t>(tree[i]) + d);
+    };
+    auto treeFind = [&](std::uint64_t target) { // run holding the target-th remaining record
+      std::size_t pos = 0;
+      for (std::size_t step = std::bit_floor(k); step > 0; step >>= 1) {
+        if (pos + step <= k && tree[pos + step] <= target) {
+          pos += step;
+          target -= tree[pos];
+        }
+      }
+      return pos;
+    };
+    std::uint64_t remaining = 0;
+    for (std::size_t i = 0; i < k; ++i) {
+      treeAdd(i, static_cast<std::int64_t>(runSizes[i]));
+      remaining += runSizes[i];
+    }
+    std::vector<std::uint64_t> cursor(k, 0);
+    std::vector<citadel::PackedPosition> outBatch;
+    outBatch.reserve(1u << 16);
+    for (; remaining > 0; --remaining) {
+      const std::size_t r = treeFind(rng() % remaining);
+      const auto* recs = reinterpret_cast<const citadel::PackedPosition*>(maps[r]->data() + sizeof(citadel::DataFileHeader));
+      outBatch.push_back(recs[cursor[r]++]);
+      treeAdd(r, -1);
+      if (outBatch.size() == outBatch.capacity()) {
+        out.write(outBatch.data(), outBatch.size());
+        outBatch.clear();
+      }
+    }
+    out.write(outBatch.data(), outBatch.size());
+    maps.clear();
+    for (const auto& path : runs) std::filesystem::remove(path);
+  }
+  out.finish();
+  std::cerr << "data shuffle: wrote " << out.written() << " samples to " << *outPath << " (" << citadel::dataFormatName(format) << ", " << runs.size()
+            << " runs, seed " << seed << ")\n";
+}
+
+static void cmdData(int argc, char** argv) {
+  const std::string sub = (argc > 2) ? argv[2] : "";
+  if (sub == "stats") return cmdDataStats(argc, argv);
+  if (sub == "merge") return cmdDataMerge(argc, argv);
+  if (sub == "shuffle") return cmdDataShuffle(argc, argv);
+  throw std::runtime_error("data: unknown subcommand '" + sub + "' (stats|merge|shuffle)");
+}
+
+// Trains an NNUE on datagen files and exports it in the format --nnuefile loads. Every epoch
+// streams the inputs through a shuffle buffer (run `data shuffle` first for a global shuffle)
+// and rewrites --out, so an interrupted run still leaves the last epoch's net.
+static void cmdTrain(int argc, char** argv) {
+  int npos = 2;
+  while (npos < argc && std::string_view(argv[npos]).substr(0, 2) != "--") ++npos;
+  if (npos == 2) throw std::runtime_error("train: no input files given");
+  std::vector<std::string> inputs;
+  for (int i = 2; i < npos; ++i) inputs.push_back(argv[i]);
+  const auto outPath = argValue(argc, argv, "--out");
+  if (!outPath) throw std::runtime_error("train: missing required --out <file.cnue>");
+
+  citadel::NnueTrainOptions opt;
+  opt.threads = intArg(argc, argv, "--threads", 0);
+  if (opt.threads <= 0) opt.threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  opt.learningRate = static_cast<float>(doubleArg(argc, argv, "--lr", 1e-3));
+  opt.lambda = static_cast<float>(std::clamp(doubleArg(argc, argv, "--lambda", 0.75), 0.0, 1.0));
+  opt.wdlScale = static_cast<float>(doubleArg(argc, argv, "--wdl-scale", 400.0));
+  opt.seed = std::strtoull(argValue(argc, argv, "--seed").value_or("1").c_str(), nullptr, 10);
+  const int epochs = intArg(argc, argv, "--epochs", 10);
+  const auto batchSize = static_cast<std::size_t>(std::max(1, intArg(argc, argv, "--batch", 16384)));
+  const auto bufferSize = std::max(batchSize, static_cast<std::size_t>(std::max(1, intArg(argc, argv, "--shuffle-buffer", 1 << 20))));
+  const double lrGamma = doubleArg(argc, argv, "--lr-gamma", 1.0);
+  if (epochs <= 0) throw std::runtime_error("train: --epochs must be > 0");
+  if (opt.learningRate <= 0.0f || opt.wdlScale <= 0.0f) throw std::runtime_error("train: --lr and --wdl-scale must be > 0");
+
+  std::vector<citadel::PackedPosition> val;
+  if (auto valPath = argValue(argc, argv, "--val")) {
+    citadel::TrainingDataReader reader(*valPath);
+    std::vector<citadel::PackedPosition> batch;
+    while (reader.nextBatch(batch, 1u << 16, opt.threads) > 0) val.insert(val.end(), batch.begin(), batch.end());
+    std::cerr << "train: " << val.size() << " validation samples\n";
+  }
+
+  citadel::NnueTrainer trainer(opt);
+  std::mt19937_64 rng(opt.seed);
+  std::vector<citadel::PackedPosition> buffer;
+  std::vector<citadel::PackedPosition> batch;
+  std::vector<citadel::PackedPosition> chunk;
+  std::vector<citadel::PackedPosition> trainCheck; // without --val: the last non-empty buffer's head
+
+  for (int epoch = 1; epoch <= epochs; ++epoch) {
+    const auto t0 = std::chrono::steady_clock::now();
+    double lossSum = 0.0;
+    std::uint64_t seen = 0;
+    std::size_t input = 0;
+    std::unique_ptr<citadel::TrainingDataReader> reader;
+    bool more = true;
+    while (more) {
+      // Refill the shuffle buffer from the inputs in order.
+      buffer.clear();
+      while (buffer.size() < bufferSize) {
+        if (!reader) {
+          if (input == inputs.size()) break;
+          reader = std::make_unique<citadel::TrainingDataReader>(inputs[input++]);
+        }
+        if (reader->nextBatch(chunk, std::min<std::size_t>(bufferSize - buffer.size(), 1u << 16), opt.threads) == 0) {
+          reader.reset();
+          continue;
+        }
+        buffer.insert(buffer.end(), chunk.begin(), chunk.end());
+      }
+      more = buffer.size() == bufferSize;
+      std::shuffle(buffer.begin(), buffer.end(), rng);
+      if (!buffer.empty() && val.empty()) trainCheck.assign(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(std::min<std::size_t>(buffer.size(), 1000)));
+
+      for (std::size_t i = 0; i < buffer.size(); i += batchSize) {
+        batch.assign(buffer.begin() + static_cast<std::ptrdiff_t>(i), buffer.begin() + static_cast<std::ptrdiff_t>(std::min(i + batchSize, buffer.size())));
+        lossSum += trainer.trainBatch(batch) * static_cast<double>(batch.size());
+        seen += batch.size();
+      }
+    }
+    if (seen == 0) throw std::runtime_error("train: the input files contain no samples");
+
+    trainer.exportNet(*outPath);
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cerr << "train: epoch " << epoch << "/" << epochs << " loss " << std::fixed << std::setprecision(6) << lossSum / static_cast<double>(seen);
+    if (!val.empty()) std::cerr << " val " << trainer.loss(val);
+    std::cerr << " lr " << std::setprecision(2) << std::scientific << trainer.learningRate() << std::fixed << " (" << seen << " samples, "
+              << static_cast<std::uint64_t>(static_cast<double>(seen) / std::max(secs, 1e-9)) << " samples/s, " << std::setprecision(1) << secs << " s)\n";
+    trainer.setLearningRate(static_cast<float>(trainer.learningRate() * lrGamma));
+  }
+
+  // The exported net must score exactly like the trainer's quantized forward pass.
+  citadel::NNUE net;
+  if (!net.loadFromFile(*outPath)) throw std::runtime_error("train: exported net does not load: " + net.lastError());
+  const std::vector<citadel::PackedPosition>& check = val.empty() ? trainCheck : val;
+  std::size_t mismatches = 0;
+  const std::size_t checked = std::min<std::size_t>(check.size(), 1000);
+  for (std::size_t i = 0; i < checked; ++i) {
+    const Position pos = citadel::unpackPosition(check[i]);
+    citadel::NNUE::Accumulator acc;
+    net.initAccumulator(pos, acc);
+    const int engine = net.evaluateStm(pos, acc);
+    const int white = trainer.predictWhite(check[i]);
+    mismatches += engine != (pos.turn() == citadel::Color::White ? white : -white);
+  }
+  std::cerr << "train: wrote " << *outPath << " (" << trainer.steps() << " steps; engine matches trainer on " << (checked - mismatches) << "/" << checked
+            << " samples)\n";
+  if (checked == 0) throw std::runtime_error("train: no samples to check the exported net on");
+  if (mismatches > 0) throw std::runtime_error("train: exported net disagrees with the trainer");
+}
+
+// Fits the HCE weights to datagen files. Every sample is traced once with the starting
+// weights; the --iterations full-batch Adam steps then only run over the traces. --out is
+// rewritten at every report, so an interrupted run keeps its progress.
+static void cmdTune(int argc, char** argv) {
+  int npos = 2;
+  while (npos < argc && std::string_view(argv[npos]).substr(0, 2) != "--") ++npos;
+  if (npos == 2) throw std::runtime_error("tune: no input files given");
+  const auto outPath = argValue(argc, argv, "--out");
+  if (!outPath) throw std::runtime_error("tune: missing required --out <params.txt>");
+
+  citadel::HceTuneOptions opt;
+  opt.threads = intArg(argc, argv, "--threads", 0);
+  if (opt.threads <= 0) opt.threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  opt.learningRate = doubleArg(argc, argv, "--lr", 1.0);
+  opt.lambda = std::clamp(doubleArg(argc, argv, "--lambda", 0.5), 0.0, 1.0);
+  opt.wdlScale = doubleArg(argc, argv, "--wdl-scale", 400.0);
+  const int iterations = intArg(argc, argv, "--iterations", 1000);
+  const int report = std::max(1, intArg(argc, argv, "--report", 50));
+  if (iterations <= 0) throw std::runtime_error("tune: --iterations must be > 0");
+  if (opt.learningRate <= 0.0 || opt.wdlScale <= 0.0) throw std::runtime_error("tune: --lr and --wdl-scale must be > 0");
+
+  // The traces are taken with the active weights, so the starting point becomes active first.
+  const auto startPath = argValue(argc, argv, "--params");
+  const citadel::HceParams start = startPath ? citadel::HceParams::load(*startPath) : citadel::HceParams::defaults();
+  citadel::setHceParams(start);
+  citadel::HceTuner tuner(start, opt);
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::vector<citadel::PackedPosition> batch;
+  for (int i = 2; i < npos; ++i) {
+    citadel::TrainingDataReader reader(argv[i]);
+    while (reader.nextBatch(batch, 1u << 16, opt.threads) > 0) tuner.addSamples(batch);
+  }
+  if (tuner.size() == 0) throw std::runtime_error("tune: the input files contain no samples");
+  std::cerr << "tune: traced " << tuner.size() << " samples in " << std::fixed << std::setprecision(1)
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() << " s (trace rounding error "
+            << std::setprecision(2) << tuner.traceError() << " cp), start loss " << std::setprecision(6) << tuner.loss() << "\n";
+
+  const auto t1 = std::chrono::steady_clock::now();
+  for (int it = 1; it <= iterations; ++it) {
+    const double loss = tuner.step();
+    if (it % report != 0 && it != iterations) continue;
+    tuner.params().save(*outPath);
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    std::cerr << "tune: iteration " << it << "/" << iterations << " loss " << std::setprecision(6) << loss << " (" << std::setprecision(1) << secs
+              << " s)\n";
+  }
+
+  const citadel::HceParams tuned = tuner.params();
+  std::cerr << "tune: final loss " << std::setprecision(6) << tuner.loss() << ", wrote " << *outPath << "\n";
+  for (std::size_t i = 0; i < tuned.value.size(); ++i) {
+    if (tuned.value[i] == start.value[i]) continue;
+    std::cerr << "  " << std::left << std::setw(24) << citadel::HceParams::name(i) << std::right << std::setw(6) << start.value[i] << " -> "
+              << tuned.value[i] << "\n";
+  }
+}
+
+// One side of a local engine-vs-engine game (spsa, match): the in-process search, or an engine
+// binary over UCI pipes when `command` is set. In-process searches run without the TT (global
+// and single-threaded), so any number of games can be played in parallel.
+struct LocalEngine {
+  std::string name = "Citadel";
+  citadel::SearchOptions opt; // eval backend and net of the in-process search
+  citadel::SearchParams params = citadel::SearchParams::defaults();
+  std::string command;
+  std::vector<std::pair<std::string, std::string>> uciOptions; // setoption name/value after "uci"
+
+  // Per-move limits (0 = unset) and the game clock (tcBaseMs != 0: base time plus tcIncMs per
+  // move). With neither the in-process search runs to its maximum depth; `match` defaults to
+  // depth 6.
+  int depth = 0;
+  std::uint64_t nodes = 0;
+  std::uint64_t movetimeMs = 0;
+  std::uint64_t tcBaseMs = 0;
+  std::uint64_t tcIncMs = 0;
+};
+
+// A LocalEngine bound to one game worker; owns the process of a UCI engine.
+class LocalPlayer {
+public:
+  struct Reply {
+    std::optional<Move> move; // nullopt: no move (see error; empty if there is no legal move)
+    int score = 0;            // side to move's view
+    std::string error;
+  };
+
+  explicit LocalPlayer(const LocalEngine& e) : e_(e) {}
+
+  [[nodiscard]] const LocalEngine& engine() const { return e_; }
+
+  // Before every game: (re)starts a UCI engine if needed. Throws std::runtime_error on failure.
+  void newGame() {
+    if (e_.command.empty()) return;
+    if (!uci_.alive()) {
+      if (!uci_.start(e_.command)) throw std::runtime_error("cannot start '" + e_.command + "': " + uci_.lastError());
+      uci_.send("uci");
+      if (!waitFor("uciok", 10'000)) throw std::runtime_error("'" + e_.command + "' did not answer uci");
+      for (const auto& [name, value] : e_.uciOptions) uci_.send("setoption name " + name + " value " + value);
+    }
+    uci_.send("ucinewgame");
+    uci_.send("isready");
+    if (!waitFor("readyok", 10'000)) throw std::runtime_error("'" + e_.command + "' did not answer isready");
+  }
+
+  // Best move in `pos`, reached by `moves` from `startFen`. Clock arguments as UCI go.
+  Reply go(const std::string& startFen, const std::vector<Move>& moves, Position& pos, std::int64_t wtime, std::int64_t btime, std::uint64_t winc,
+           std::uint64_t binc) {
+    Reply reply;
+    const bool white = pos.turn() == citadel::Color::White;
+    if (e_.command.empty()) {
+      citadel::SearchOptions opt = e_.opt;
+      opt.params = &e_.params;
+      opt.useTT = false;
+      opt.limits.depth = e_.depth ? e_.depth : 64;
+      opt.limits.nodeLimit = e_.nodes;
+      opt.limits.timeLimitMs = e_.movetimeMs;
+      if (e_.tcBaseMs) {
+        opt.limits.timeLeftMs = static_cast<std::uint64_t>(std::max<std::int64_t>(1, white ? wtime : btime));
+        opt.limits.incMs = white ? winc : binc;
+      }
+      const auto r = citadel::searchBestMove(pos, opt);
+      if (r.best.from != citadel::SQ_NONE) reply.move = r.best;
+      reply.score = r.score;
+      return reply;
+    }
+
+    std::string cmd = "position fen " + startFen;
+    if (!moves.empty()) cmd += " moves";
+    for (const Move& m : moves) cmd += " " + moveToUciToken(m);
+    uci_.send(cmd);
+    std::ostringstream go;
+    go << "go";
+    if (e_.tcBaseMs) go << " wtime " << std::max<std::int64_t>(1, wtime) << " btime " << std::max<std::int64_t>(1, btime) << " winc " << winc << " binc " << binc;
+    if (e_.depth) go << " depth " << e_.depth;
+    if (e_.nodes) go << " nodes " << e_.nodes;
+    if (e_.movetimeMs) go << " movetime " << e_.movetimeMs;
+    uci_.send(go.str());
+
+    // Engines limited by depth or nodes get unlimited time; clocked ones a grace period, then
+    // a stop.
+    int timeoutMs = -1;
+    if (e_.tcBaseMs) timeoutMs = static_cast<int>(std::max<std::int64_t>(0, white ? wtime : btime)) + 2000;
+    else if (e_.movetimeMs) timeoutMs = static_cast<int>(e_.movetimeMs) + 2000;
+    bool stopped = false;
+    while (true) {
+      const auto line = uci_.readLine(timeoutMs);
+      if (!line) {
+        if (!uci_.alive()) {
+          reply.error = "Disconnect";
+          return reply;
+        }
+        if (stopped) {
+          reply.error = "NoBestmove";
+          return reply;
+        }
+        uci_.send("stop");
+        stopped = true;
+        timeoutMs = 1000;
+        continue;
+      }
+      std::istringstream iss(*line);
+      std::string tok;
+      iss >> tok;
+      if (tok == "info") {
+        while (iss >> tok) {
+          if (tok != "score") continue;
+          std::string kind;
+          int v = 0;
+          if (iss >> kind >> v) reply.score = (kind == "mate") ? (v > 0 ? 100'000 : -100'000) : v;
+        }
+      } else if (tok == "bestmove") {
+        iss >> tok;
+        MoveList legal;
+        pos.generateMoves(legal);
+        if (legal.empty()) return reply;
+        reply.move = parseMoveToken(pos, tok);
+        if (!reply.move) reply.error = "IllegalMove";
+        return reply;
+      }
+    }
+  }
+
+private:
+  bool waitFor(std::string_view token, int timeoutMs) {
+    while (const auto line = uci_.readLine(timeoutMs)) {
+      if (*line == token) return true;
+    }
+    return false;
+  }
+
+  const LocalEngine& e_;
+  citadel::UciProcess uci_;
+};
+
+struct LocalGameSettings {
+  int maxPlies = 300;
+  AdjudicationSettings adj;
+  int timeMarginMs = 100; // clock overrun tolerated before a time forfeit
+};
+
+struct LocalGame {
+  std::int8_t result = citadel::kResultDraw; // White's view
+  std::string termination;
+  std::vector<Move> moves;
+};
+
+static LocalGame playLocalGame(const Position& start, LocalPlayer& white, LocalPlayer& black, const LocalGameSettings& gs) {
+  white.newGame();
+  black.newGame();
+  const std::string startFen = start.toFEN();
+  const LocalEngine& we = white.engine();
+  const LocalEngine& be = black.engine();
+  std::int64_t wtime = static_cast<std::int64_t>(we.tcBaseMs);
+  std::int64_t btime = static_cast<std::int64_t>(be.tcBaseMs);
+
+  LocalGame g;
+  Position pos = start;
+  Adjudicator adjudicator(gs.adj);
+  for (int ply = 0; ply < gs.maxPlies && !pos.gameOver(); ++ply) {
+    const bool whiteToMove = pos.turn() == citadel::Color::White;
+    LocalPlayer& player = whiteToMove ? white : black;
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto r = player.go(startFen, g.moves, pos, wtime, btime, we.tcIncMs, be.tcIncMs);
+    const auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    const std::int8_t loss = whiteToMove ? citadel::kResultBlackWin : citadel::kResultWhiteWin;
+    if (player.engine().tcBaseMs) {
+      std::int64_t& clock = whiteToMove ? wtime : btime;
+      clock -= spent;
+      if (clock < -gs.timeMarginMs) {
+        g.result = loss;
+        g.termination = "TimeForfeit";
+        return g;
+      }
+      clock += static_cast<std::int64_t>(player.engine().tcIncMs);
+    }
+    if (!r.move) {
+      if (!r.error.empty()) g.result = loss;
+      g.termination = r.error.empty() ? "NoMoves" : r.error;
+      return g;
+    }
+
+    adjudicator.update(pos, whiteToMove ? r.score : -r.score);
+    citadel::Undo u;
+    pos.makeMove(*r.move, u);
+    g.moves.push_back(*r.move);
+
+    if (pos.gameOver()) break;
+    if (const auto v = adjudicator.verdict()) {
+      g.result = *v;
+      g.termination = "Adjudication";
+      return g;
+    }
+  }
+
+  if (const auto w = pos.winner()) {
+    g.result = (*w == citadel::Color::White) ? citadel::kResultWhiteWin : citadel::kResultBlackWin;
+    g.termination = terminationString(pos, false, false);
+  } else {
+    g.termination = "MoveLimit";
+  }
+  return g;
+}
+
+// Start positions of local games: --openings <fenfile> (one FEN per line, '#' comments;
+// finished positions are skipped), else the start position; then --random-plies uniformly
+// random moves.
+class OpeningBook {
+public:
+  OpeningBook(int argc, char** argv, std::string_view cmd, int defaultRandomPlies, const std::optional<std::string>& defaultPath = std::nullopt) {
+    randomPlies_ = std::max(0, intArg(argc, argv, "--random-plies", defaultRandomPlies));
+    const auto path = argValue(argc, argv, "--openings") ? argValue(argc, argv, "--openings") : defaultPath;
+    if (path) {
+      std::ifstream f(*path);
+      if (!f) throw std::runtime_error(std::string(cmd) + ": failed to open " + *path);
+      std::string line;
+      while (std::getline(f, line)) {
+        const std::size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+        if (line.empty()) continue;
+        try {
+          Position pos = Position::fromFEN(line);
+          MoveList moves;
+          pos.generateMoves(moves);
+          if (!pos.gameOver() && !moves.empty()) fens_.push_back(pos);
+        } catch (const std::exception& e) {
+          throw std::runtime_error(std::string(cmd) + ": bad FEN in " + *path + ": " + e.what());
+        }
+      }
+      if (fens_.empty()) throw std::runtime_error(std::string(cmd) + ": no playable FENs in " + *path);
+    } else {
+      fens_.push_back(Position::initial());
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const { return fens_.size(); }
+
+  // Book position `index` (modulo the book size) followed by the random plies.
+  template <typename Rng>
+  Position at(std::size_t index, Rng& rng) const {
+    const Position& base = fens_[index % fens_.size()];
+    Position pos = base;
+    for (int i = 0; i < randomPlies_ && !pos.gameOver(); ++i) {
+      MoveList moves;
+      pos.generateMoves(moves);
+      if (moves.empty()) break;
+      citadel::Undo u;
+      pos.makeMove(moves.buf[static_cast<std::uint32_t>(rng() % moves.size)], u);
+    }
+    if (pos.gameOver()) return base; // a random line that ends the game: replay the book position
+    return pos;
+  }
+
+  template <typename Rng>
+  Position next(Rng& rng) const {
+    return at(static_cast<std::size_t>(rng() % fens_.size()), rng);
+  }
+
+private:
+  std::vector<Position> fens_;
+  int randomPlies_ = 0;
+};
+
+static LocalGameSettings localGameSettingsFromArgs(int argc, char** argv) {
+  LocalGameSettings gs;
+  gs.maxPlies = intArg(argc, argv, "--maxplies", gs.maxPlies);
+  gs.adj = adjudicationFromArgs(argc, argv);
+  gs.timeMarginMs = intArg(argc, argv, "--time-margin", gs.timeMarginMs);
+  if (gs.maxPlies <= 0) throw std::runtime_error("--maxplies must be > 0");
+  return gs;
+}
+
+// SPSA over the search parameters (fishtest schedule): every game pair plays theta + c_k * delta
+// against theta - c_k * delta from one opening with colours swapped, and moves theta along delta
+// by the score difference. Games run on --threads workers; --out is rewritten every --report pairs.
+static void cmdSpsa(int argc, char** argv) {
+  const auto outPath = argValue(argc, argv, "--out");
+  if (!outPath) throw std::runtime_error("spsa: missing required --out <params.txt>");
+  const int iterations = intArg(argc, argv, "--iterations", 1000);
+  const int report = std::max(1, intArg(argc, argv, "--report", 50));
+  int threads = intArg(argc, argv, "--threads", 1);
+  if (threads <= 0) threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  const double rEnd = doubleArg(argc, argv, "--r-end", 0.002);
+  const double alpha = doubleArg(argc, argv, "--alpha", 0.602);
+  const double gamma = doubleArg(argc, argv, "--gamma", 0.101);
+  const std::uint64_t nodeBudget = std::strtoull(argValue(argc, argv, "--nodes").value_or("3000").c_str(), nullptr, 10);
+  const int depth = intArg(argc, argv, "--depth", nodeBudget ? 64 : 6);
+  const std::uint64_t seed = std::strtoull(argValue(argc, argv, "--seed").value_or("1").c_str(), nullptr, 10);
+  if (iterations <= 0) throw std::runtime_error("spsa: --iterations must be > 0");
+  if (depth <= 0) throw std::runtime_error("spsa: --depth must be > 0");
+
+  const LocalGameSettings gs = localGameSettingsFromArgs(argc, argv);
+  const OpeningBook book(argc, argv, "spsa", 8);
+  EvalContext ec = loadEvalForCommand(argc, argv); // also applies --search-params, the starting point
+  const citadel::EvalBackend backend = ec.nnuePtr() ? citadel::EvalBackend::NNUE : citadel::EvalBackend::HCE;
+
+  // Tuned parameters: --tune a,b,c, else all that the selected backend uses.
+  std::vector<std::size_t> tuned;
+  if (auto list = argValue(argc, argv, "--tune")) {
+    std::istringstream ls(*list);
+    std::string n;
+    while (std::getline(ls, n, ',')) {
+      const std::size_t i = citadel::SearchParams::find(n);
+      if (i == citadel::SearchParams::Count) throw std::runtime_error("spsa: unknown parameter '" + n + "'");
+      if (!citadel::SearchParams::usedBy(i, backend)) std::cerr << "spsa: warning: " << n << " is not used by the selected eval\n";
+      tuned.push_back(i);
+    }
+  } else {
+    for (std::size_t i = 0; i < citadel::SearchParams::Count; ++i) {
+      if (citadel::SearchParams::usedBy(i, backend)) tuned.push_back(i);
+    }
+  }
+  if (tuned.empty()) throw std::runtime_error("spsa: no parameters to tune");
+
+  const citadel::SearchParams start = citadel::searchParams();
+  std::vector<double> theta(tuned.size());
+  for (std::size_t j = 0; j < tuned.size(); ++j) theta[j] = start.value[tuned[j]];
+
+  // k-th pair: c_k = c_end * (N / k)^gamma, a_k = a_end * ((A + N) / (A + k))^alpha with
+  // a_end = r_end * c_end^2, step R_k = a_k / c_k^2.
+  const double N = iterations;
+  const double A = 0.1 * N;
+  auto paramsFrom = [&](const std::vector<double>& t) {
+    citadel::SearchParams p = start;
+    for (std::size_t j = 0; j < tuned.size(); ++j) {
+      const auto& info = citadel::SearchParams::info(tuned[j]);
+      p.value[tuned[j]] = std::clamp(static_cast<int>(std::lround(t[j])), info.min, info.max);
+    }
+    return p;
+  };
+
+  LocalEngine base;
+  base.depth = depth;
+  base.nodes = nodeBudget;
+  base.opt.evalBackend = ec.backend;
+  base.opt.nnue = ec.nnuePtr();
+
+  std::cerr << "spsa: " << tuned.size() << " parameters, " << iterations << " game pairs, " << (nodeBudget ? "nodes " : "depth ")
+            << (nodeBudget ? nodeBudget : static_cast<std::uint64_t>(depth)) << ", eval " << (backend == citadel::EvalBackend::NNUE ? "nnue" : "hce")
+            << ", " << threads << " threads\n";
+
+  std::mutex mu; // guards everything below
+  std::mt19937_64 rng(seed);
+  int nextPair = 0;
+  int donePairs = 0;
+  int wins = 0, draws = 0, losses = 0; // of the theta+ engine
+  const auto t0 = std::chrono::steady_clock::now();
+  std::exception_ptr error;
+
+  auto worker = [&]() {
+    try {
+      while (true) {
+        LocalEngine plus = base;
+        LocalEngine minus = base;
+        std::vector<double> cK(tuned.size());
+        std::vector<int> delta(tuned.size());
+        Position opening;
+        int k = 0;
+        {
+          std::lock_guard<std::mutex> lk(mu);
+          if (nextPair == iterations || error) return;
+          k = ++nextPair;
+          std::vector<double> tp(theta), tm(theta);
+          for (std::size_t j = 0; j < tuned.size(); ++j) {
+            cK[j] = citadel::SearchParams::info(tuned[j]).step * std::pow(N / k, gamma);
+            delta[j] = (rng() & 1) ? 1 : -1;
+            tp[j] += cK[j] * delta[j];
+            tm[j] -= cK[j] * delta[j];
+          }
+          plus.params = paramsFrom(tp);
+          minus.params = paramsFrom(tm);
+          opening = book.next(rng);
+        }
+
+        LocalPlayer pp(plus);
+        LocalPlayer pm(minus);
+        const LocalGame g1 = playLocalGame(opening, pp, pm, gs);
+        const LocalGame g2 = playLocalGame(opening, pm, pp, gs);
+        const int r1 = g1.result;  // theta+ is White
+        const int r2 = -g2.result; // theta+ is Black
+        const int result = r1 + r2;
+
+        std::lock_guard<std::mutex> lk(mu);
+        for (const int r : {r1, r2}) {
+          if (r > 0) ++wins;
+          else if (r < 0) ++losses;
+          else ++draws;
+        }
+        const double aScale = std::pow((A + N) / (A + k), alpha);
+        for (std::size_t j = 0; j < tuned.size(); ++j) {
+          const auto& info = citadel::SearchParams::info(tuned[j]);
+          const double aK = rEnd * info.step * info.step * aScale;
+          theta[j] += aK / cK[j] * result * delta[j];
+          theta[j] = std::clamp(theta[j], static_cast<double>(info.min), static_cast<double>(info.max));
+        }
+        ++donePairs;
+        if (donePairs % report == 0 || donePairs == iterations) {
+          paramsFrom(theta).save(*outPath);
+          const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+          std::cerr << "spsa: pair " << donePairs << "/" << iterations << " theta+ W/D/L " << wins << "/" << draws << "/" << losses << " ("
+                    << std::fixed << std::setprecision(1) << secs << " s)\n";
+          for (std::size_t j = 0; j < tuned.size(); ++j) std::cerr << ' ' << citadel::SearchParams::info(tuned[j]).name << '=' << std::setprecision(1) << theta[j];
+          std::cerr << "\n";
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lk(mu);
+      if (!error) error = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+  worker();
+  for (auto& t : pool) t.join();
+  if (error) std::rethrow_exception(error);
+
+  const citadel::SearchParams result = paramsFrom(theta);
+  result.save(*outPath);
+  std::cerr << "spsa: wrote " << *outPath << " (load with --search-params or setoption name SearchParams)\n";
+  for (const std::size_t i : tuned) {
+    std::cerr << "  " << std::left << std::setw(20) << citadel::SearchParams::info(i).name << std::right << std::setw(6) << start.value[i] << " -> "
+              << result.value[i] << "\n";
+  }
+}
+
+// Parses an engine spec of `match`: comma-separated key=value pairs, cmd=<command line> last
+// (it may contain commas). Keys without a value in the spec keep the --depth/--nodes/... defaults.
+static LocalEngine parseEngineSpec(std::string_view spec, const LocalEngine& defaults, std::vector<std::unique_ptr<citadel::NNUE>>& nets) {
+  LocalEngine e = defaults;
+  bool limitSet = false;
+  auto parseTc = [&](const std::string& v) {
+    const std::size_t plus = v.find('+');
+    e.tcBaseMs = static_cast<std::uint64_t>(std::max(0.0, std::atof(v.substr(0, plus).c_str())) * 1000.0);
+    e.tcIncMs = (plus == std::string::npos) ? 0 : static_cast<std::uint64_t>(std::max(0.0, std::atof(v.substr(plus + 1).c_str())) * 1000.0);
+    if (!e.tcBaseMs) throw std::runtime_error("match: bad tc '" + v + "' (seconds[+increment])");
+  };
+
+  std::string backend = "nnue";
+  std::string nnueFile = DEFAULT_NNUE_FILE;
+  std::optional<std::string> paramsFile;
+  std::size_t pos = 0;
+  while (pos < spec.size()) {
+    std::size_t end = spec.find(',', pos);
+    const std::size_t eq = spec.find('=', pos);
+    if (eq == std::string_view::npos || (end != std::string_view::npos && eq > end)) {
+      throw std::runtime_error("match: bad engine spec item '" + std::string(spec.substr(pos, end - pos)) + "' (key=value)");
+    }
+    const std::string rawKey(spec.substr(pos, eq - pos));
+    const std::string key = toLowerCopy(rawKey);
+    if (key == "cmd") end = std::string_view::npos;
+    const std::string value(spec.substr(eq + 1, end == std::string_view::npos ? std::string_view::npos : end - eq - 1));
+    pos = (end == std::string_view::npos) ? spec.size() : end + 1;
+
+    if (key == "name") e.name = value;
+    else if (key == "eval") backend = toLowerCopy(value);
+    else if (key == "nnue") nnueFile = value;
+    else if (key == "params") paramsFile = value;
+    else if (key == "cmd") e.command = value;
+    else if (key.rfind("option.", 0) == 0) e.uciOptions.emplace_back(rawKey.substr(7), value);
+    else if (key == "depth" || key == "nodes" || key == "movetime" || key == "tc") {
+      if (!limitSet) {
+        e.depth = 0;
+        e.nodes = 0;
+        e.movetimeMs = 0;
+        e.tcBaseMs = e.tcIncMs = 0;
+        limitSet = true;
+      }
+      if (key == "depth") e.depth = std::atoi(value.c_str());
+      else if (key == "nodes") e.nodes = std::strtoull(value.c_str(), nullptr, 10);
+      else if (key == "movetime") e.movetimeMs = std::strtoull(value.c_str(), nullptr, 10);
+      else parseTc(value);
+    } else {
+      throw std::runtime_error("match: unknown engine spec key '" + key + "'");
+    }
+  }
+
+  if (e.command.empty()) {
+    const auto eb = parseEvalBackend(backend);
+    if (!eb) throw std::runtime_error("match: unknown eval '" + backend + "'");
+    e.opt.evalBackend = *eb;
+    if (*eb == citadel::EvalBackend::NNUE) {
+      auto net = std::make_unique<citadel::NNUE>();
+      if (!net->loadFromFile(nnueFile)) throw std::runtime_error("match: nnue load failed: " + net->lastError());
+      e.opt.nnue = net.get();
+      nets.push_back(std::move(net));
+    }
+    if (paramsFile) e.params = citadel::SearchParams::load(*paramsFile);
+  } else if (paramsFile) {
+    throw std::runtime_error("match: params= applies to in-process engines only (use option.<name>= for cmd= engines)");
+  }
+  // A bare "go" is an infinite search to UCI engines.
+  if (!e.depth && !e.nodes && !e.movetimeMs && !e.tcBaseMs) e.depth = 6;
+  return e;
+}
+
+// Results of a match from engine1's view, counted per game and per game pair (pentanomial: pair
+// score 0, 0.5, 1, 1.5, 2 out of 2).
+struct MatchStats {
+  int wins = 0, draws = 0, losses = 0;
+  std::array<int, 5> penta{};
+  static constexpr std::array<double, 5> kPairScore = {0.0, 0.25, 0.5, 0.75, 1.0};
+
+  [[nodiscard]] int pairs() const { return penta[0] + penta[1] + penta[2] + penta[3] + penta[4]; }
+
+  // Mean and variance of the per-pair score, as a fraction of the pair's 2 points.
+  [[nodiscard]] std::pair<double, double> meanVariance() const {
+    const double n = pairs();
+    double mean = 0.0, var = 0.0;
+    for (std::size_t i = 0; i < 5; ++i) mean += penta[i] * kPairScore[i];
+    mean /= n;
+    for (std::size_t i = 0; i < 5; ++i) var += penta[i] * (kPairScore[i] - mean) * (kPairScore[i] - mean);
+    return {mean, var / n};
+  }
+
+  // Generalized SPRT log-likelihood ratio of elo1 against elo0 (normal approximation on the
+  // pentanomial pair scores).
+  [[nodiscard]] double llr(double elo0, double elo1) const {
+    if (pairs() < 2) return 0.0;
+    const auto [mean, var] = meanVariance();
+    if (var <= 0.0) return 0.0;
+    const auto score = [](double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); };
+    const double s0 = score(elo0), s1 = score(elo1);
+    return pairs() * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * var);
+  }
+};
+
+static double eloFromScore(double s) {
+  s = std::clamp(s, 1e-6, 1.0 - 1e-6);
+  return 400.0 * std::log10(s / (1.0 - s));
+}
+
+static void printMatchReport(std::ostream& os, const MatchStats& st, const std::string& name1, const std::string& name2, bool sprt, double elo0, double elo1,
+                             double lower, double upper) {
+  const int n = st.pairs();
+  os << "match: " << name1 << " vs " << name2 << ": " << 2 * n << " games, W/D/L " << st.wins << "/" << st.draws << "/" << st.losses << ", penta ["
+     << st.penta[0] << ", " << st.penta[1] << ", " << st.penta[2] << ", " << st.penta[3] << ", " << st.penta[4] << "]\n";
+  if (n == 0) return;
+  const auto [mean, var] = st.meanVariance();
+  const double margin = 1.959964 * std::sqrt(var / n);
+  const double elo = eloFromScore(mean);
+  const double eloLo = eloFromScore(mean - margin);
+  const double eloHi = eloFromScore(mean + margin);
+  const double los = (var > 0.0) ? 0.5 * std::erfc(-(mean - 0.5) / std::sqrt(2.0 * var / n)) : (mean > 0.5 ? 1.0 : mean < 0.5 ? 0.0 : 0.5);
+  os << std::fixed << std::setprecision(1) << "match: elo " << elo << " +/- " << (eloHi - eloLo) / 2.0 << " (95% [" << eloLo << ", " << eloHi
+     << "]), score " << std::setprecision(2) << 100.0 * mean << "%, LOS " << std::setprecision(1) << 100.0 * los << "%\n";
+  if (sprt) {
+    const double l = st.llr(elo0, elo1);
+    os << "match: sprt elo0 " << elo0 << " elo1 " << elo1 << ": LLR " << std::setprecision(2) << l << " [" << lower << ", " << upper << "] "
+       << (l >= upper ? "H1 accepted" : l <= lower ? "H0 accepted" : "running") << "\n";
+  }
+  os.unsetf(std::ios::floatfield);
+}
+
+// match: engine1 against engine2, in pairs of games from the same opening with colours swapped.
+static void cmdMatch(int argc, char** argv) {
+  const auto spec1 = argValue(argc, argv, "--engine1");
+  const auto spec2 = argValue(argc, argv, "--engine2");
+  if (!spec1 || !spec2) throw std::runtime_error("match: missing required --engine1 <spec> / --engine2 <spec>");
+  int games = intArg(argc, argv, "--games", 100);
+  if (games <= 0) throw std::runtime_error("match: --games must be > 0");
+  const int pairCount = (games + 1) / 2;
+  int concurrency = intArg(argc, argv, "--concurrency", 1);
+  if (concurrency <= 0) concurrency = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  const int report = std::max(1, intArg(argc, argv, "--report", 10));
+  const std::uint64_t seed = std::strtoull(argValue(argc, argv, "--seed").value_or("1").c_str(), nullptr, 10);
+  const bool sprt = hasFlag(argc, argv, "--sprt");
+  const double elo0 = doubleArg(argc, argv, "--elo0", 0.0);
+  const double elo1 = doubleArg(argc, argv, "--elo1", 5.0);
+  const double alpha = doubleArg(argc, argv, "--alpha", 0.05);
+  const double beta = doubleArg(argc, argv, "--beta", 0.05);
+  if (sprt && (elo1 <= elo0 || alpha <= 0.0 || alpha >= 1.0 || beta <= 0.0 || beta >= 1.0)) {
+    throw std::runtime_error("match: SPRT needs elo0 < elo1 and alpha, beta in (0, 1)");
+  }
+  const double lower = std::log(beta / (1.0 - alpha));
+  const double upper = std::log((1.0 - beta) / alpha);
+
+  const LocalGameSettings gs = localGameSettingsFromArgs(argc, argv);
+  const OpeningBook book(argc, argv, "match", 0, std::string("fen.txt"));
+  if (auto v = argValue(argc, argv, "--hce-params")) citadel::setHceParams(citadel::HceParams::load(*v));
+  if (auto v = argValue(argc, argv, "--search-params")) citadel::setSearchParams(citadel::SearchParams::load(*v));
+
+  // Defaults of both specs.
+  LocalEngine defaults;
+  defaults.params = citadel::searchParams();
+  defaults.depth = intArg(argc, argv, "--depth", 0);
+  defaults.nodes = std::strtoull(argValue(argc, argv, "--nodes").value_or("0").c_str(), nullptr, 10);
+  defaults.movetimeMs = std::strtoull(argValue(argc, argv, "--movetime").value_or("0").c_str(), nullptr, 10);
+  if (auto tc = argValue(argc, argv, "--tc")) {
+    std::vector<std::unique_ptr<citadel::NNUE>> none;
+    const LocalEngine t = parseEngineSpec("eval=hce,tc=" + *tc, LocalEngine{}, none);
+    defaults.tcBaseMs = t.tcBaseMs;
+    defaults.tcIncMs = t.tcIncMs;
+  }
+
+  std::vector<std::unique_ptr<citadel::NNUE>> nets; // owns the nets of the in-process engines
+  LocalEngine e1 = parseEngineSpec(*spec1, defaults, nets);
+  LocalEngine e2 = parseEngineSpec(*spec2, defaults, nets);
+  if (e1.name == e2.name) {
+    e1.name += "-1";
+    e2.name += "-2";
+  }
+
+  std::ofstream pgn;
+  if (auto path = argValue(argc, argv, "--pgn")) {
+    pgn.open(*path, hasFlag(argc, argv, "--append") ? (std::ios::out | std::ios::app) : (std::ios::out | std::ios::trunc));
+    if (!pgn) throw std::runtime_error("match: failed to open PGN file for writing: " + *path);
+  }
+  const std::string date = todayPgnDate();
+  const std::string event = e1.name + " vs " + e2.name;
+
+  std::cerr << "match: " << event << ", " << 2 * pairCount << " games (" << book.size() << " openings), concurrency " << concurrency << "\n";
+
+  std::mutex mu; // guards everything below
+  std::mt19937_64 rng(seed);
+  int nextPair = 0;
+  MatchStats st;
+  bool decided = false;
+  std::exception_ptr error;
+
+  auto worker = [&]() {
+    try {
+      LocalPlayer p1(e1);
+      LocalPlayer p2(e2);
+      while (true) {
+        int pair = 0;
+        Position opening;
+        {
+          std::lock_guard<std::mutex> lk(mu);
+          if (nextPair == pairCount || decided || error) return;
+          pair = nextPair++;
+          opening = book.at(static_cast<std::size_t>(pair), rng);
+        }
+
+        const LocalGame ga = playLocalGame(opening, p1, p2, gs); // engine1 White
+        const LocalGame gb = playLocalGame(opening, p2, p1, gs); // engine2 White
+        const int ra = ga.result;
+        const int rb = -gb.result;
+
+        std::lock_guard<std::mutex> lk(mu);
+        for (const int r : {ra, rb}) {
+          if (r > 0) ++st.wins;
+          else if (r < 0) ++st.losses;
+          else ++st.draws;
+        }
+        ++st.penta[static_cast<std::size_t>(ra + rb + 2)];
+        if (pgn.is_open()) {
+          const std::string fen = opening.toFEN();
+          auto write = [&](const LocalGame& g, const LocalEngine& white, const LocalEngine& black, int round) {
+            const std::optional<citadel::Color> winner =
+                (g.result == citadel::kResultDraw) ? std::nullopt : std::optional(g.result > 0 ? citadel::Color::White : citadel::Color::Black);
+            writePgnGame(pgn, event, white.name, black.name, "local", date, std::to_string(round), fen,
+                         resultTokenFromWinner(winner, g.result == citadel::kResultDraw), g.termination, g.moves, opening);
+          };
+          write(ga, e1, e2, 2 * pair + 1);
+          write(gb, e2, e1, 2 * pair + 2);
+          pgn.flush();
+        }
+        if (sprt && st.pairs() >= 2) {
+          const double l = st.llr(elo0, elo1);
+          decided = l >= upper || l <= lower;
+        }
+        if (st.pairs() % report == 0 && !decided && st.pairs() != pairCount) printMatchReport(std::cerr, st, e1.name, e2.name, sprt, elo0, elo1, lower, upper);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lk(mu);
+      if (!error) error = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < concurrency; ++t) pool.emplace_back(worker);
+  worker();
+  for (auto& t : pool) t.join();
+  if (error) std::rethrow_exception(error);
+
+  if (pgn.is_open() && !pgn.flush()) throw std::runtime_error("match: PGN write failed");
+  printMatchReport(std::cout, st, e1.name, e2.name, sprt, elo0, elo1, lower, upper);
 }
 
 static std::string toLowerCopy(std::string_view sv) {
@@ -655,6 +2947,7 @@ static std::string uciInfoLine(const citadel::SearchInfo& info) {
   std::ostringstream oss;
   oss << "info depth " << info.depth;
   if (info.seldepth > 0) oss << " seldepth " << info.seldepth;
+  oss << " multipv " << info.multipv;
 
   oss << " score ";
   const int score = info.score;
@@ -989,7 +3282,11 @@ static void uciLoop() {
   citadel::NNUE nnue;
   std::string nnueFile;
 
+  std::uint64_t moveOverheadMs = 30;
+  int multiPV = 1;
+
   std::atomic_bool stop{false};
+  std::atomic_bool ponder{false};
   std::thread worker;
   std::mutex outMu;
 
@@ -1003,6 +3300,7 @@ static void uciLoop() {
     stop.store(true, std::memory_order_relaxed);
     if (worker.joinable()) worker.join();
     stop.store(false, std::memory_order_relaxed);
+    ponder.store(false, std::memory_order_relaxed);
   };
 
   nnueFile = DEFAULT_NNUE_FILE;
@@ -1029,8 +3327,19 @@ static void uciLoop() {
       send("id author Oscar");
       send("option name Hash type spin default " + std::to_string(citadel::transpositionTableSizeMB()) + " min 1 max 1024");
       send("option name Threads type spin default 1 min 1 max 1");
+      send("option name Move Overhead type spin default 30 min 0 max 5000");
+      send("option name Ponder type check default false");
+      send("option name MultiPV type spin default 1 min 1 max 64");
       send("option name Eval type combo default NNUE var HCE var NNUE");
       send(std::string("option name NnueFile type string default ") + DEFAULT_NNUE_FILE);
+      send("option name HceParams type string default <empty>");
+      send("option name TraceFile type string default <empty>");
+      send("option name SearchParams type string default <empty>");
+      for (std::size_t i = 0; i < citadel::SearchParams::Count; ++i) {
+        const auto& info = citadel::SearchParams::info(i);
+        send(std::string("option name ") + info.name + " type spin default " + std::to_string(citadel::searchParams().value[i]) + " min " +
+             std::to_string(info.min) + " max " + std::to_string(info.max));
+      }
       send("uciok");
       continue;
     }
@@ -1043,6 +3352,7 @@ static void uciLoop() {
     if (cmd == "ucinewgame") {
       stopSearch();
       citadel::clearTranspositionTable();
+      citadel::clearSearchHistory();
       pos = Position::initial();
       continue;
     }
@@ -1075,6 +3385,35 @@ static void uciLoop() {
           citadel::setTranspositionTableSizeMB(static_cast<std::size_t>(mb));
         }
       }
+      if (nameLower == "move overhead" && !value.empty()) {
+        const int ms = std::atoi(value.c_str());
+        if (ms >= 0) moveOverheadMs = static_cast<std::uint64_t>(ms);
+      }
+      if (nameLower == "multipv" && !value.empty()) {
+        multiPV = std::clamp(std::atoi(value.c_str()), 1, 64);
+      }
+      // Search tuning: one spin option per SearchParams entry, or a whole file from `citadel spsa`.
+      if (const std::size_t sp = citadel::SearchParams::find(name); sp != citadel::SearchParams::Count && !value.empty()) {
+        stopSearch();
+        const auto& info = citadel::SearchParams::info(sp);
+        citadel::SearchParams p = citadel::searchParams();
+        p.value[sp] = std::clamp(std::atoi(value.c_str()), info.min, info.max);
+        citadel::setSearchParams(p);
+      }
+      if (nameLower == "searchparams") {
+        stopSearch();
+        if (value.empty() || toLowerCopy(value) == "<empty>") {
+          citadel::setSearchParams(citadel::SearchParams::defaults());
+          send("info string search params: defaults");
+        } else {
+          try {
+            citadel::setSearchParams(citadel::SearchParams::load(value));
+            send("info string search params loaded: " + value);
+          } catch (const std::exception& e) {
+            send(std::string("info string ") + e.what());
+          }
+        }
+      }
       if (nameLower == "eval") {
         stopSearch();
         const std::string v = toLowerCopy(value);
@@ -1093,6 +3432,7 @@ static void uciLoop() {
           send("info string nnue cleared");
         } else {
           nnueFile = v;
+          citadel::clearEvalCache();
           if (!nnue.loadFromFile(nnueFile)) {
             send("info string nnue load failed: " + nnue.lastError());
           } else {
@@ -1100,6 +3440,34 @@ static void uciLoop() {
           }
         }
       }
+      // HCE weights written by `citadel tune`; <empty> restores the built-in ones.
+      if (nameLower == "hceparams") {
+        stopSearch();
+        if (value.empty() || toLowerCopy(value) == "<empty>") {
+          citadel::setHceParams(citadel::HceParams::defaults());
+          send("info string hce params: defaults");
+        } else {
+          try {
+            citadel::setHceParams(citadel::HceParams::load(value));
+            send("info string hce params loaded: " + value);
+          } catch (const std::exception& e) {
+            send(std::string("info string ") + e.what());
+          }
+        }
+      }
+      // Chrome trace_event timeline; the file is written when TraceFile changes or on quit.
+      if (nameLower == "tracefile") {
+        stopSearch();
+        citadel::traceClose();
+        if (!value.empty() && toLowerCopy(value) != "<empty>") {
+          if (citadel::traceOpen(value)) {
+            citadel::traceThreadName("uci");
+            send("info string trace: recording to " + value);
+          } else {
+            send("info string trace: cannot write " + value);
+          }
+        }
+      }
       continue;
     }
 
@@ -1181,9 +3549,12 @@ static void uciLoop() {
       std::uint64_t movetimeMs = 0;
       std::uint64_t nodeLimit = 0;
       bool infinite = false;
+      bool ponderGo = false;
 
       std::uint64_t wtime = 0, btime = 0, winc = 0, binc = 0;
       bool haveWtime = false, haveBtime = false, haveWinc = false, haveBinc = false;
+      int movesToGo = 0;
+      std::vector<Move> searchMoves;
 
       std::string tok;
       while (iss >> tok) {
@@ -1196,6 +3567,8 @@ static void uciLoop() {
           iss >> nodeLimit;
         } else if (k == "infinite") {
           infinite = true;
+        } else if (k == "ponder") {
+          ponderGo = true;
         } else if (k == "wtime") {
           iss >> wtime;
           haveWtime = true;
@@ -1208,19 +3581,40 @@ static void uciLoop() {
         } else if (k == "binc") {
           iss >> binc;
           haveBinc = true;
+        } else if (k == "movestogo") {
+          iss >> movesToGo;
+        } else if (k == "searchmoves") {
+          // Moves run until the first token that is not a legal move; re-scan the rest as options.
+          std::string rest;
+          while (iss >> tok) {
+            if (!rest.empty()) {
+              rest += ' ' + tok;
+              continue;
+            }
+            if (const auto m = parseMoveToken(pos, tok)) {
+              searchMoves.push_back(*m);
+            } else {
+              rest = tok;
+            }
+          }
+          iss.clear();
+          iss.str(rest);
         } else {
-          // ignore: ponder, mate, movestogo, etc.
+          // ignore: mate, etc.
         }
       }
 
       citadel::SearchLimits lim;
       lim.nodeLimit = nodeLimit;
+      lim.moveOverheadMs = moveOverheadMs;
 
       if (infinite) {
         lim.depth = 255;
         lim.timeLimitMs = 0;
       } else {
-        lim.depth = (depth > 0) ? depth : 6;
+        // Time-limited searches run until the clock says stop unless a depth is given.
+        const bool timed = (movetimeMs != 0) || haveWtime || haveBtime;
+        lim.depth = (depth > 0) ? depth : timed ? 255 : 6;
 
         if (movetimeMs != 0) {
           lim.timeLimitMs = movetimeMs;
@@ -1228,34 +3622,53 @@ static void uciLoop() {
           const std::uint64_t remaining = (pos.turn() == citadel::Color::White) ? (haveWtime ? wtime : 0) : (haveBtime ? btime : 0);
           const std::uint64_t inc = (pos.turn() == citadel::Color::White) ? (haveWinc ? winc : 0) : (haveBinc ? binc : 0);
 
-          // Very simple time management: spend ~1/30th of remaining + half the increment.
-          std::uint64_t budget = (remaining / 30) + (inc / 2);
-          if (budget < 10) budget = 10;
-          if (remaining > 50 && budget > remaining - 50) budget = remaining - 50;
-          lim.timeLimitMs = budget;
+          // Soft/hard limits are derived by the search's TimeManager.
+          lim.timeLeftMs = (remaining > 0) ? remaining : 1;
+          lim.incMs = inc;
+          lim.movesToGo = movesToGo;
         } else {
           lim.timeLimitMs = 0;
         }
       }
 
       stop.store(false, std::memory_order_relaxed);
+      // 'go ponder' searches the position after the expected reply; the time limits above only
+      // start to run once the GUI sends 'ponderhit'.
+      ponder.store(ponderGo, std::memory_order_relaxed);
 
       const citadel::EvalBackend evalForSearch = evalBackend;
-      worker = std::thread([&, lim, evalForSearch]() {
+      worker = std::thread([&, lim, evalForSearch, searchMoves]() {
+        citadel::traceThreadName("search");
         citadel::SearchOptions opt;
         opt.limits = lim;
+        opt.searchMoves = searchMoves;
         opt.stop = &stop;
+        opt.ponder = &ponder;
+        opt.keepHeuristics = true;
+        opt.multiPV = multiPV;
         opt.onInfo = [&](const citadel::SearchInfo& info) { send(uciInfoLine(info)); };
         opt.evalBackend = evalForSearch;
         opt.nnue = (evalForSearch == citadel::EvalBackend::NNUE && nnue.loaded()) ? &nnue : nullptr;
 
         const auto r = citadel::searchBestMove(pos, opt);
-        send("bestmove " + uciBestmoveToken(r.best));
+        if (r.evalCacheProbes > 0) {
+          send("info string evalcache hits " + std::to_string(r.evalCacheHits) + " probes " + std::to_string(r.evalCacheProbes) + " hitrate " +
+               std::to_string((r.evalCacheHits * 1000ull) / r.evalCacheProbes) + " permill");
+        }
+        std::string bm = "bestmove " + uciBestmoveToken(r.best);
+        if (r.ponder.to != citadel::SQ_NONE) bm += " ponder " + moveToUciToken(r.ponder);
+        send(bm);
       });
 
       continue;
     }
 
+    if (cmd == "ponderhit") {
+      // The expected reply was played: keep searching, now on our own clock.
+      ponder.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
     if (cmd == "stop") {
       stopSearch();
       continue;
@@ -1266,6 +3679,34 @@ static void uciLoop() {
       break;
     }
 
+    // bench [depth] [threads] [eval]; uses the current NNUE when eval is nnue.
+    if (cmd == "bench") {
+      stopSearch();
+      int depth = 6;
+      int threads = 1;
+      std::string evalTok;
+      iss >> depth >> threads >> evalTok;
+      citadel::EvalBackend eb = evalTok.empty() ? citadel::EvalBackend::HCE : parseEvalBackend(evalTok).value_or(citadel::EvalBackend::HCE);
+      if (eb == citadel::EvalBackend::NNUE && !nnue.loaded()) {
+        send("info string bench: nnue not loaded, using HCE");
+        eb = citadel::EvalBackend::HCE;
+      }
+      (void)runBench(std::max(depth, 1), threads, eb, (eb == citadel::EvalBackend::NNUE) ? &nnue : nullptr,
+                     [&](const std::string& l) { send("info string " + l); });
+      // The bench cleared the TT; the game's position history is unaffected.
+      continue;
+    }
+
+    // Counters of the last finished search (CITADEL_STATS builds only).
+    if (cmd == "stats") {
+      if constexpr (citadel::kSearchStatsEnabled) {
+        for (const auto& l : citadel::formatSearchStats(citadel::lastSearchStats())) send("info string " + l);
+      } else {
+        send("info string stats: not compiled in (rebuild with -DCITADEL_STATS)");
+      }
+      continue;
+    }
+
     // Common debug convenience used by some GUIs / users.
     if (cmd == "d") {
       send(std::string("info string ") + pos.toFEN());
@@ -1274,6 +3715,7 @@ static void uciLoop() {
   }
 
   stopSearch();
+  citadel::traceClose();
 }
 
 int main(int argc, char** argv) {
@@ -1295,6 +3737,10 @@ int main(int argc, char** argv) {
       cmdBestmove(argc, argv);
       return 0;
     }
+    if (cmd == "bench") {
+      cmdBench(argc, argv);
+      return 0;
+    }
     if (cmd == "play") {
       cmdPlay(argc, argv);
       return 0;
@@ -1307,6 +3753,30 @@ int main(int argc, char** argv) {
       cmdDatagen(argc, argv);
       return 0;
     }
+    if (cmd == "relabel") {
+      cmdRelabel(argc, argv);
+      return 0;
+    }
+    if (cmd == "data") {
+      cmdData(argc, argv);
+      return 0;
+    }
+    if (cmd == "train") {
+      cmdTrain(argc, argv);
+      return 0;
+    }
+    if (cmd == "tune") {
+      cmdTune(argc, argv);
+      return 0;
+    }
+    if (cmd == "match") {
+      cmdMatch(argc, argv);
+      return 0;
+    }
+    if (cmd == "spsa") {
+      cmdSpsa(argc, argv);
+      return 0;
+    }
     if (cmd == "review") {
       cmdReview(argc, argv);
       return 0;
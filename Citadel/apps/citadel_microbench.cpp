@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "citadel/nnue.hpp"
+#include "citadel/position.hpp"
+#include "citadel/search.hpp"
+
+using citadel::Move;
+using citadel::MoveList;
+using citadel::NNUE;
+using citadel::Position;
+using citadel::Undo;
+
+// Per-primitive timings (ns/op) over the positions of a FEN file. Each benchmark runs one
+// warm-up pass, then `reps` timed repetitions of at least `minMs` each; min and median are
+// reported (min is the low-noise number to compare between builds).
+
+static std::optional<std::string> argValue(int argc, char** argv, std::string_view key) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::string_view(argv[i]) == key) return std::string(argv[i + 1]);
+  }
+  return std::nullopt;
+}
+
+static int intArg(int argc, char** argv, std::string_view key, int def) {
+  if (auto v = argValue(argc, argv, key)) return std::atoi(v->c_str());
+  return def;
+}
+
+static void usage(std::string_view exe) {
+  std::cerr << "Usage:\n"
+            << "  " << exe << " [--fenfile <file>] [--nnuefile <path>] [--reps N] [--ms N] [--filter <substring>]\n"
+            << "       (defaults: fen.txt, 7 reps of >= 100 ms; NNUE benchmarks need --nnuefile)\n";
+}
+
+// Defeats dead-code elimination of benchmarked results.
+static volatile std::uint64_t g_sink = 0;
+
+struct BenchCase {
+  std::string name;
+  std::uint64_t opsPerPass = 0;
+  std::function<std::uint64_t()> pass; // one pass over the data set; returns a checksum
+};
+
+static void runCase(const BenchCase& bc, int reps, int minMs) {
+  using clock = std::chrono::steady_clock;
+
+  g_sink = g_sink + bc.pass(); // warm-up (caches, branch predictors, lazy tables)
+
+  std::vector<double> nsPerOp;
+  nsPerOp.reserve(static_cast<std::size_t>(reps));
+  for (int r = 0; r < reps; ++r) {
+    std::uint64_t passes = 0;
+    std::uint64_t sum = 0;
+    const auto t0 = clock::now();
+    auto t1 = t0;
+    do {
+      sum += bc.pass();
+      ++passes;
+      t1 = clock::now();
+    } while (std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() < minMs);
+    g_sink = g_sink + sum;
+
+    const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    nsPerOp.push_back(ns / static_cast<double>(passes * bc.opsPerPass));
+  }
+  std::sort(nsPerOp.begin(), nsPerOp.end());
+
+  std::cout << std::left << std::setw(28) << bc.name << std::right << std::setw(10) << bc.opsPerPass << std::fixed << std::setprecision(1)
+            << std::setw(12) << nsPerOp.front() << std::setw(12) << nsPerOp[nsPerOp.size() / 2] << "\n";
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 1 && (std::string_view(argv[1]) == "-h" || std::string_view(argv[1]) == "--help")) {
+      usage(argv[0]);
+      return 0;
+    }
+    const std::string fenFile = argValue(argc, argv, "--fenfile").value_or("fen.txt");
+    const int reps = std::max(1, intArg(argc, argv, "--reps", 7));
+    const int minMs = std::max(1, intArg(argc, argv, "--ms", 100));
+    const std::string filter = argValue(argc, argv, "--filter").value_or("");
+
+    std::vector<Position> positions;
+    {
+      std::ifstream f(fenFile);
+      if (!f) throw std::runtime_error("failed to open fenfile: " + fenFile);
+      std::string line;
+      while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        const std::string fen = line.substr(0, line.find(';')); // accept perft EPD files too
+        Position p = Position::fromFEN(fen);
+        if (!p.gameOver()) positions.push_back(std::move(p));
+      }
+    }
+    if (positions.empty()) throw std::runtime_error("no playable positions in " + fenFile);
+
+    NNUE nnue;
+    if (auto path = argValue(argc, argv, "--nnuefile")) {
+      if (!nnue.loadFromFile(*path)) throw std::runtime_error("nnue load failed: " + nnue.lastError());
+    }
+
+    // Shared fixtures: every legal move of every position, and (for the incremental-update
+    // benchmarks) the child positions with their Undo records.
+    struct Child {
+      std::size_t parent = 0;
+      Position after;
+      Undo undo;
+    };
+    std::vector<std::vector<Move>> moves(positions.size());
+    std::vector<Child> children;
+    std::uint64_t moveCount = 0;
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      MoveList ml;
+      positions[i].generateMoves(ml);
+      moves[i].assign(ml.buf.begin(), ml.buf.begin() + ml.size);
+      moveCount += ml.size;
+      // Every 4th child keeps the fixture small while covering all move types.
+      for (std::uint32_t k = 0; k < ml.size; k += 4) {
+        Child c;
+        c.parent = i;
+        c.after = positions[i];
+        c.after.makeMove(ml.buf[k], c.undo);
+        children.push_back(std::move(c));
+      }
+    }
+
+    std::vector<std::uint64_t> parentKeys(positions.size());
+    for (std::size_t i = 0; i < positions.size(); ++i) parentKeys[i] = citadel::searchHash(positions[i]);
+
+    std::vector<std::string> fens(positions.size());
+    for (std::size_t i = 0; i < positions.size(); ++i) fens[i] = positions[i].toFEN();
+
+    std::vector<NNUE::Accumulator> accs(nnue.loaded() ? positions.size() : 0);
+    for (std::size_t i = 0; i < accs.size(); ++i) nnue.initAccumulator(positions[i], accs[i]);
+
+    const std::uint64_t n = positions.size();
+    std::vector<BenchCase> cases;
+
+    cases.push_back({"generateMoves", n, [&]() {
+                       std::uint64_t s = 0;
+                       MoveList ml;
+                       for (auto& p : positions) {
+                         p.generateMoves(ml);
+                         s += ml.size;
+                       }
+                       return s;
+                     }});
+    cases.push_back({"countMoves", n, [&]() {
+                       std::uint64_t s = 0;
+                       for (auto& p : positions) s += p.countMoves();
+                       return s;
+                     }});
+    cases.push_back({"makeMove+undoMove", moveCount, [&]() {
+                       std::uint64_t s = 0;
+                       for (std::size_t i = 0; i < positions.size(); ++i) {
+                         Position& p = positions[i];
+                         for (const Move& m : moves[i]) {
+                           Undo u;
+                           p.makeMove(m, u);
+                           s += u.sqCount;
+                           p.undoMove(u);
+                         }
+                       }
+                       return s;
+                     }});
+    cases.push_back({"computeAttacks", n, [&]() {
+                       std::uint64_t s = 0;
+                       for (const auto& p : positions) s += p.computeAttacks(p.turn()).popcount();
+                       return s;
+                     }});
+    cases.push_back({"isSquareAttackedBy", n * citadel::SQ_N, [&]() {
+                       std::uint64_t s = 0;
+                       for (const auto& p : positions) {
+                         for (std::uint8_t sq = 0; sq < citadel::SQ_N; ++sq) s += p.isSquareAttackedBy(p.turn(), sq) ? 1u : 0u;
+                       }
+                       return s;
+                     }});
+    cases.push_back({"evalStatic (HCE)", n, [&]() {
+                       std::uint64_t s = 0;
+                       for (const auto& p : positions) s += static_cast<std::uint64_t>(citadel::evaluatePositionStm(p));
+                       return s;
+                     }});
+    cases.push_back({"searchHashAfterMake", children.size(), [&]() {
+                       std::uint64_t s = 0;
+                       for (const auto& c : children) s ^= citadel::searchHashAfterMake(parentKeys[c.parent], c.after, c.undo);
+                       return s;
+                     }});
+    cases.push_back({"toFEN", n, [&]() {
+                       std::uint64_t s = 0;
+                       for (const auto& p : positions) s += p.toFEN().size();
+                       return s;
+                     }});
+    cases.push_back({"fromFEN", n, [&]() {
+                       std::uint64_t s = 0;
+                       for (const auto& f : fens) s += Position::fromFEN(f).hash();
+                       return s;
+                     }});
+
+    if (nnue.loaded()) {
+      cases.push_back({"NNUE::initAccumulator", n, [&]() {
+                         std::uint64_t s = 0;
+                         NNUE::Accumulator acc;
+                         for (const auto& p : positions) {
+                           nnue.initAccumulator(p, acc);
+                           s += static_cast<std::uint64_t>(acc.v[0]);
+                         }
+                         return s;
+                       }});
+      // Includes the parent-accumulator copy, as in search.
+      cases.push_back({"NNUE::applyDeltaAfterMove", children.size(), [&]() {
+                         std::uint64_t s = 0;
+                         NNUE::Accumulator acc;
+                         for (const auto& c : children) {
+                           acc = accs[c.parent];
+                           nnue.applyDeltaAfterMove(acc, c.after, c.undo);
+                           s += static_cast<std::uint64_t>(acc.v[0]);
+                         }
+                         return s;
+                       }});
+      cases.push_back({"NNUE::evaluateStm", n, [&]() {
+                         std::uint64_t s = 0;
+                         for (std::size_t i = 0; i < positions.size(); ++i) s += static_cast<std::uint64_t>(nnue.evaluateStm(positions[i], accs[i]));
+                         return s;
+                       }});
+    }
+
+    std::cout << positions.size() << " positions, " << moveCount << " moves, " << children.size() << " children; " << reps << " reps of >= " << minMs
+              << " ms\n";
+    std::cout << std::left << std::setw(28) << "primitive" << std::right << std::setw(10) << "ops/pass" << std::setw(12) << "ns/op min" << std::setw(12)
+              << "ns/op med" << "\n";
+    for (const auto& bc : cases) {
+      if (!filter.empty() && bc.name.find(filter) == std::string::npos) continue;
+      runCase(bc, reps, minMs);
+    }
+    if (!nnue.loaded()) std::cout << "(NNUE benchmarks skipped: pass --nnuefile <path>)\n";
+    return 0;
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+}
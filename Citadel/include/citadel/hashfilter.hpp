@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace citadel {
+
+// Lock-free blocked Bloom filter over 64-bit keys (e.g. Position::hash()), shared by threads.
+//
+// Each key maps to one 64-byte block and sets kBitsPerKey bits inside it, so an insert touches
+// a single cache line. Memory is fixed at construction; as it fills up the false-positive rate
+// (unique keys reported as seen) grows, it never reports a seen key as new except for two
+// threads racing on the same key.
+class HashFilter {
+public:
+  explicit HashFilter(std::size_t sizeMB);
+
+  // Marks `key` as seen; returns true if it was not seen before.
+  bool insert(std::uint64_t key);
+  // True if `key` was seen (or is a false positive); does not mark it.
+  [[nodiscard]] bool contains(std::uint64_t key) const;
+
+  [[nodiscard]] std::size_t sizeBytes() const { return blockCount_ * sizeof(Block); }
+
+private:
+  static constexpr int kBitsPerKey = 6;
+
+  template <typename Fn>
+  void forEachBit(std::uint64_t key, Fn&& fn) const; // fn(word, mask) for the bits of `key`
+
+  struct alignas(64) Block {
+    std::atomic<std::uint64_t> w[8];
+  };
+
+  std::unique_ptr<Block[]> blocks_;
+  std::size_t blockCount_ = 0;
+};
+
+} // namespace citadel
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "citadel/position.hpp"
+
+namespace citadel {
+
+// Tunable weights of the hand-crafted evaluation (HCE).
+//
+// Structural thresholds (phase bounds, the wall counts that make a position "locked", the
+// no-catapult draw factors) stay compile-time constants in hce.cpp; everything the evaluation
+// adds up linearly is a parameter here, so it can be fitted by `citadel tune`.
+struct HceParams {
+  enum Index : std::uint16_t {
+    // Material: opening value and value in a locked wall endgame (interpolated by wall count).
+    MasonMg,
+    MasonEg,
+    CatapultMg,
+    CatapultEg,
+    LancerMg,
+    LancerEg,
+    PegasusMg,
+    PegasusEg,
+    MinisterMg,
+    MinisterEg,
+
+    // Piece-square terms: per step of centrality (0 on the edge .. 4 in the centre) and on the Keep.
+    // The Sovereign terms only apply in proportion to the endgame phase.
+    MasonCenter,
+    MasonKeep,
+    CatapultCenter,
+    CatapultKeep,
+    LancerCenter,
+    LancerKeep,
+    PegasusCenter,
+    PegasusKeep,
+    MinisterCenter,
+    MinisterKeep,
+    SovereignCenter,
+    SovereignKeep,
+
+    // Pressure on the enemy Sovereign: weight * (5 - distance) * 4 / defender safety.
+    MasonPressure,
+    CatapultPressure,
+    LancerPressure,
+    PegasusPressure,
+    MinisterPressure,
+
+    MasonMinisterSynergy,
+    WallPerHp,
+    WallChoke, // wall on the ring around the Keep, scaled by phase
+    Dominance, // scaled by phase
+    BastionRightOpening,
+    WallAdjSovereign,
+    SiegeAttrition,
+    WallTokenOpeningPerHp,
+    Mobility, // per attacked square
+    KingWander,
+    KingKeepEarly,
+    KingAttacked,
+    KingRingAttack,
+    EntombPressure,
+    Tempo,
+    CatapultMonopoly,
+    CatapultEdgeMax, // scaled by the locked-wall endgame factor
+
+    Count
+  };
+
+  std::array<int, Count> value{};
+
+  [[nodiscard]] int operator[](Index i) const { return value[i]; }
+  int& operator[](Index i) { return value[i]; }
+
+  // The built-in weights.
+  [[nodiscard]] static const HceParams& defaults();
+
+  [[nodiscard]] static const char* name(std::size_t i);
+  // Index of the parameter called `n` (case-insensitive), or Count.
+  [[nodiscard]] static std::size_t find(std::string_view n);
+
+  // Text format of paramfile.hpp; parameters missing from the file keep their default. Throws
+  // std::runtime_error on unknown names or bad values.
+  [[nodiscard]] static HceParams load(const std::string& path);
+  void save(const std::string& path) const; // throws std::runtime_error
+};
+
+// The weights used by the engine. setHceParams() clears the evaluation cache; it must not be
+// called while a search is running.
+[[nodiscard]] const HceParams& hceParams();
+void setHceParams(const HceParams& p);
+
+// Per-parameter coefficients of one evaluation: since every tunable term is linear in its
+// weight, evaluateHce(pos) ~= scale / 256 * sum(coeff[i] * value[i]) (White's view; the
+// difference is integer rounding). `scale` is the draw damping of catapult-less positions.
+struct HceTrace {
+  std::array<float, HceParams::Count> coeff{};
+  int scale = 256;
+};
+
+// Static evaluation from White's point of view with the active parameters.
+[[nodiscard]] int evaluateHce(const Position& pos);
+// Same, and fills `trace` (overwritten) for the parameter tuner.
+int evaluateHce(const Position& pos, HceTrace& trace);
+
+} // namespace citadel
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "citadel/hce.hpp"
+#include "citadel/trainingdata.hpp"
+
+namespace citadel {
+
+struct HceTuneOptions {
+  int threads = 1;
+  double learningRate = 1.0; // Adam step, roughly centipawns per iteration
+  double beta1 = 0.9;
+  double beta2 = 0.999;
+  double epsilon = 1e-8;
+  // Target = lambda * sigmoid(eval / wdlScale) + (1 - lambda) * game result (samples without a
+  // result use the eval only), compared with sigmoid(prediction / wdlScale).
+  double lambda = 0.5;
+  double wdlScale = 400.0;
+};
+
+// Gradient-descent fitter for HceParams.
+//
+// Each sample is traced once (HceTrace, kept as its nonzero coefficients only, ~40 of the
+// parameters per position); afterwards the prediction of any parameter vector is a short dot
+// product, so a full-batch step over millions of positions never runs the evaluation again.
+// Steps are split across `threads` workers with private gradient vectors.
+class HceTuner {
+public:
+  HceTuner(const HceParams& start, const HceTuneOptions& opt);
+
+  // Traces `samples` (in parallel) and adds them to the training set.
+  void addSamples(const std::vector<PackedPosition>& samples);
+
+  [[nodiscard]] std::size_t size() const { return samples_.size(); }
+
+  // Mean |trace prediction - evaluateHce| in centipawns over the added samples: the integer
+  // rounding the linear model does not see.
+  [[nodiscard]] double traceError() const { return samples_.empty() ? 0.0 : traceErrorSum_ / static_cast<double>(samples_.size()); }
+
+  // One Adam step over all samples; returns the mean loss before the update.
+  double step();
+
+  // Mean loss of the current parameters.
+  [[nodiscard]] double loss() const;
+
+  // Current parameters, rounded to the integers the evaluation uses.
+  [[nodiscard]] HceParams params() const;
+  [[nodiscard]] std::uint64_t steps() const { return step_; }
+
+private:
+  struct Term {
+    std::uint16_t param;
+    float coeff;
+  };
+  struct Sample {
+    std::uint64_t begin = 0; // first Term
+    std::uint16_t count = 0;
+    std::uint16_t scale = 256; // HceTrace::scale
+    float target = 0.0f;       // win probability, White's view
+  };
+
+  // Loss over samples [begin, end); adds d(loss)/d(theta) into `grad` if it is non-null.
+  double accumulate(std::size_t begin, std::size_t end, double* grad) const;
+
+  HceTuneOptions opt_;
+  std::array<double, HceParams::Count> theta_{};
+  std::array<double, HceParams::Count> m_{}, v_{};
+  std::vector<std::array<double, HceParams::Count>> grads_; // one per worker
+
+  std::vector<Term> terms_;
+  std::vector<Sample> samples_;
+  double traceErrorSum_ = 0.0;
+  std::uint64_t step_ = 0;
+};
+
+} // namespace citadel
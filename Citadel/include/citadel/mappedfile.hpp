@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace citadel {
+
+// Read-only view of a whole file. Uses mmap on POSIX systems, so the pages are shared with the
+// page cache and do not count against the process heap; elsewhere the file is read into memory.
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // Returns false (see lastError()) if the file cannot be opened or mapped.
+  bool open(const std::string& path);
+  void close();
+
+  // Hint that the mapping will be read front to back (read-ahead, early page reuse).
+  void adviseSequential() const;
+
+  [[nodiscard]] const std::uint8_t* data() const { return data_; }
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] const std::string& lastError() const { return lastError_; }
+
+private:
+  const std::uint8_t* data_ = nullptr;
+  std::size_t size_ = 0;
+  bool mapped_ = false;
+  std::vector<std::uint8_t> fallback_;
+  std::string lastError_;
+};
+
+} // namespace citadel
@@ -15,7 +15,7 @@ namespace citadel {
 // - A small MLP head.
 //
 // The model is trained with quantization-aware training (QAT) and exported to a compact binary
-// file that this class can load.
+// file that this class can load (see NnueTrainer / `citadel train`).
 class NNUE {
 public:
   static constexpr std::uint32_t kVersion = 1;
@@ -40,6 +40,9 @@ public:
 
   [[nodiscard]] bool loaded() const { return loaded_; }
   [[nodiscard]] const std::string& lastError() const { return lastError_; }
+  // Nonzero once loaded, and different for every successful load in the process (keys the
+  // search's eval cache, so two nets never share entries).
+  [[nodiscard]] std::uint64_t id() const { return id_; }
 
   // Load a quantized model from disk.
   [[nodiscard]] bool loadFromFile(const std::string& path);
@@ -58,12 +61,16 @@ public:
   // `posAfterNull` must be the position AFTER `makeNullMove(u)`.
   void applyDeltaAfterNullMove(Accumulator& acc, const Position& posAfterNull, const NullUndo& u) const;
 
-private:
   // Feature indices for globals.
   static constexpr std::uint32_t kFeatStmWhite = kBoardChannels * static_cast<std::uint32_t>(SQ_N) + 0;
   static constexpr std::uint32_t kFeatBastionWhite = kBoardChannels * static_cast<std::uint32_t>(SQ_N) + 1;
   static constexpr std::uint32_t kFeatBastionBlack = kBoardChannels * static_cast<std::uint32_t>(SQ_N) + 2;
 
+  // Input feature of square contents `raw` (Position::rawAt); UINT32_MAX for an empty square.
+  [[nodiscard]] static std::uint32_t featureIndex(std::uint8_t sq, std::int8_t raw);
+
+private:
+
   // Model parameters (quantized).
   // Feature transform weights are stored feature-major for fast incremental updates:
   //   ftW_[feature * kHidden1 + j] is the contribution to hidden unit j.
@@ -79,9 +86,9 @@ private:
   std::uint32_t shift3_ = 8;
 
   bool loaded_ = false;
+  std::uint64_t id_ = 0;
   std::string lastError_{};
 
-  [[nodiscard]] static std::uint32_t featureIndex(std::uint8_t sq, std::int8_t raw);
   [[nodiscard]] static inline int arshift(int x, std::uint32_t s) {
     if (s == 0) return x;
     if (x >= 0) return x >> s;
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "citadel/nnue.hpp"
+#include "citadel/trainingdata.hpp"
+
+namespace citadel {
+
+struct NnueTrainOptions {
+  int threads = 1;
+  float learningRate = 1e-3f;
+  float beta1 = 0.9f;
+  float beta2 = 0.999f;
+  float epsilon = 1e-8f;
+  // Target = lambda * sigmoid(eval / wdlScale) + (1 - lambda) * game result (samples without a
+  // result use the eval only). Prediction and target are compared in win-probability space.
+  float lambda = 0.75f;
+  float wdlScale = 400.0f;
+  std::uint64_t seed = 1;
+};
+
+// CPU trainer for the NNUE architecture (kInputDim -> kHidden1 -> kHidden2 -> 1).
+//
+// Quantization-aware: the forward pass runs on the integer weights exactly as NNUE::evaluate
+// does (so the exported net reproduces the training predictions bit for bit), while gradients
+// flow straight through the rounding and clipping into float master weights. Those are kept
+// inside the range their int8/int16 export can represent.
+//
+// A batch is split across `threads` workers with private gradient buffers. Only the rows of the
+// feature transform touched by a batch are reduced and updated (sparse Adam), which is what
+// keeps a step cheap with ~1300 inputs and ~40 active per position.
+class NnueTrainer {
+public:
+  // Fixed-point layout of the exported net (stored in the file header).
+  static constexpr std::uint32_t kShift2 = 6; // hidden weights in units of 1/64
+  static constexpr std::uint32_t kShift3 = 4;
+  static constexpr float kOutputScale = 600.0f; // centipawns per unit of float network output
+
+  explicit NnueTrainer(const NnueTrainOptions& opt);
+
+  // One Adam step on `batch`; returns the mean loss over it.
+  double trainBatch(const std::vector<PackedPosition>& batch);
+
+  // Mean loss over `samples` without updating the weights.
+  [[nodiscard]] double loss(const std::vector<PackedPosition>& samples) const;
+
+  // Quantized evaluation from White's view, identical to NNUE::evaluateStm for White to move.
+  [[nodiscard]] int predictWhite(const PackedPosition& pp) const;
+
+  void setLearningRate(float lr) { opt_.learningRate = lr; }
+  [[nodiscard]] float learningRate() const { return opt_.learningRate; }
+  [[nodiscard]] std::uint64_t steps() const { return step_; }
+
+  // Writes the net in the format NNUE::loadFromFile reads. Throws std::runtime_error on failure.
+  void exportNet(const std::string& path) const;
+
+private:
+  static constexpr std::uint32_t kIn = NNUE::kInputDim;
+  static constexpr std::uint32_t kH1 = NNUE::kHidden1;
+  static constexpr std::uint32_t kH2 = NNUE::kHidden2;
+  static constexpr int kAct = static_cast<int>(NNUE::kActMax);
+
+  struct Grads {
+    std::vector<float> ftW; // kIn * kH1, only rows flagged in `touched` are nonzero
+    std::vector<std::uint8_t> touched;
+    std::vector<float> ftB, l2W, l2B, outW;
+    float outB = 0.0f;
+    double loss = 0.0;
+  };
+
+  struct Adam {
+    std::vector<float> m, v;
+    void resize(std::size_t n) {
+      m.assign(n, 0.0f);
+      v.assign(n, 0.0f);
+    }
+  };
+
+  struct Forward; // per-sample activations, see nnuetrain.cpp
+
+  void forward(const PackedPosition& pp, Forward& f) const;
+  void requantizeFtRow(std::uint32_t f);
+  void requantizeDense(); // everything but the feature-transform rows
+  [[nodiscard]] float target(const PackedPosition& pp) const; // win probability, White's view
+  void accumulate(const PackedPosition* pp, std::size_t n, Grads& g) const;
+  void adamUpdate(float* w, float* gsum, Adam& a, std::size_t offset, std::size_t n, float scale, float lo, float hi);
+
+  NnueTrainOptions opt_;
+
+  // Float master weights (same layouts as NNUE: ftW feature-major, l2W row k = hidden2 unit).
+  std::vector<float> ftW_, ftB_, l2W_, l2B_, outW_;
+  float outB_ = 0.0f;
+  Adam ftWA_, ftBA_, l2WA_, l2BA_, outWA_, outBA_;
+
+  // Integer weights used by the forward pass and by exportNet().
+  std::vector<std::int16_t> qFtW_;
+  std::vector<std::int32_t> qFtB_, qL2B_;
+  std::vector<std::int8_t> qL2W_, qOutW_;
+  std::int32_t qOutB_ = 0;
+
+  std::vector<Grads> grads_; // one per worker
+  std::uint64_t step_ = 0;
+};
+
+} // namespace citadel
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace citadel {
+
+// Runs fn(worker, begin, end) over [0, n) in contiguous slices, one per worker: `threads`
+// workers, fewer if a slice would hold less than `minSlice` items. Worker 0 is the calling
+// thread; returns once all slices are done.
+template <typename Fn>
+void parallelFor(std::size_t n, int threads, Fn&& fn, std::size_t minSlice = 1) {
+  const std::size_t maxWorkers = std::max<std::size_t>(n / std::max<std::size_t>(minSlice, 1), 1);
+  const std::size_t workers = std::clamp<std::size_t>(static_cast<std::size_t>(std::max(1, threads)), 1, maxWorkers);
+  std::vector<std::thread> pool;
+  for (std::size_t w = 1; w < workers; ++w) pool.emplace_back([&fn, n, w, workers]() { fn(w, n * w / workers, n * (w + 1) / workers); });
+  fn(std::size_t{0}, std::size_t{0}, n / workers);
+  for (auto& t : pool) t.join();
+}
+
+} // namespace citadel
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace citadel {
+
+// Text files of named integer parameters (HceParams, SearchParams): "<name> <value>" lines and
+// '#' comments. Names are matched case-insensitively, as UCI option names; parameters missing
+// from the file keep their value in `values`.
+//
+// `name(i)` is the name of values[i]. `range(i)` (optional) gives the inclusive [min, max] of
+// values[i]. `what` prefixes error messages ("hce params"). Both throw std::runtime_error.
+using ParamName = std::function<const char*(std::size_t)>;
+using ParamRange = std::function<std::pair<int, int>(std::size_t)>;
+
+void loadParamFile(const std::string& path, std::string_view what, std::span<int> values, const ParamName& name, const ParamRange& range = {});
+void saveParamFile(const std::string& path, std::string_view what, std::span<const int> values, const ParamName& name);
+
+// Index of the parameter called `n` (case-insensitive), or `count` if there is none.
+[[nodiscard]] std::size_t findParam(std::string_view n, std::size_t count, const ParamName& name);
+
+} // namespace citadel
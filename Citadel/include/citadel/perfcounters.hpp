@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace citadel {
+
+// Hardware event counters for the calling process (Linux perf_event_open), counted in user
+// space only and inherited by threads created after open(). Each event is opened on its own,
+// so a missing event (VMs, containers, perf_event_paranoid) only disables that one counter.
+// On other platforms open() always fails and every counter reads as unavailable.
+class PerfCounters {
+public:
+  enum Event : std::uint8_t { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, EventCount };
+
+  struct Sample {
+    std::array<std::uint64_t, EventCount> value{};
+    std::array<bool, EventCount> valid{};
+  };
+
+  PerfCounters() = default;
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+  ~PerfCounters();
+
+  // Opens every event it can (disabled). Returns true if at least one counter is available;
+  // otherwise lastError() says why the first event failed.
+  bool open();
+  void close();
+
+  void start(); // reset + enable
+  void stop();  // disable
+
+  // Counts since the last start(), scaled up if the kernel multiplexed a counter.
+  [[nodiscard]] Sample read() const;
+
+  [[nodiscard]] bool available(Event e) const { return fd_[e] >= 0; }
+  [[nodiscard]] const std::string& lastError() const { return lastError_; }
+
+  [[nodiscard]] static const char* eventName(Event e);
+
+private:
+  std::array<int, EventCount> fd_{-1, -1, -1, -1, -1};
+  std::string lastError_;
+};
+
+} // namespace citadel
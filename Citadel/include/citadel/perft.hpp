@@ -1,6 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <istream>
+#include <string>
 #include <vector>
 
 #include "citadel/move.hpp"
@@ -14,9 +18,49 @@ struct PerftStats {
   double nps = 0.0;
 };
 
+// Subtree-count cache for hashed perft: (position hash, depth) -> node count. Entries are
+// lock-free (key stored XOR-ed with the data word), so one table can be shared by all perft threads.
+class PerftHash {
+public:
+  explicit PerftHash(std::size_t mb);
+
+  [[nodiscard]] bool probe(std::uint64_t key, int depth, std::uint64_t& nodes) const;
+  void store(std::uint64_t key, int depth, std::uint64_t nodes);
+  void clear();
+
+private:
+  struct Entry {
+    std::atomic<std::uint64_t> check{0}; // key ^ data
+    std::atomic<std::uint64_t> data{0};  // nodes << 8 | depth
+  };
+  static constexpr std::size_t kBucket = 2; // depth-preferred + always-replace
+
+  std::vector<Entry> entries_;
+  std::size_t mask_ = 0; // bucket index mask
+
+  [[nodiscard]] std::size_t bucketOf(std::uint64_t key, int depth) const;
+};
+
 [[nodiscard]] std::uint64_t perft(Position& pos, int depth);
+[[nodiscard]] std::uint64_t perftHashed(Position& pos, int depth, PerftHash& hash);
 [[nodiscard]] std::vector<std::pair<Move, std::uint64_t>> perftDivide(Position& pos, int depth);
-[[nodiscard]] PerftStats perftTimed(Position& pos, int depth);
+[[nodiscard]] PerftStats perftTimed(Position& pos, int depth, int threads = 1, PerftHash* hash = nullptr);
 
-} // namespace citadel
+// Multi-threaded perft. The tree is cut into root subtrees (root + reply subtrees when the root is
+// narrow) that `threads` workers pull from a shared queue, each on its own Position copy.
+// threads <= 1 runs on the calling thread. A non-null `hash` enables hashed perft.
+[[nodiscard]] std::uint64_t perftParallel(const Position& pos, int depth, int threads, PerftHash* hash = nullptr);
+[[nodiscard]] std::vector<std::pair<Move, std::uint64_t>> perftDivideParallel(const Position& pos, int depth, int threads,
+                                                                             PerftHash* hash = nullptr);
+
+// Perft regression suite: EPD-style lines "<fen> ;D1 <n> ;D2 <n> ...". Blank lines and lines
+// starting with '#' are skipped; a bare FEN (no D fields) is accepted (e.g. fen.txt).
+struct PerftSuiteEntry {
+  std::string fen;
+  std::vector<std::uint64_t> expected; // expected[d - 1] = perft(d); 0 where no Dd field is given
+};
 
+[[nodiscard]] std::vector<PerftSuiteEntry> loadPerftSuite(std::istream& in); // throws on malformed D fields
+[[nodiscard]] std::string formatPerftSuiteLine(const PerftSuiteEntry& e);
+
+} // namespace citadel
@@ -58,6 +58,10 @@ public:
 
   [[nodiscard]] std::string toFEN() const;
   [[nodiscard]] static Position fromFEN(std::string_view fen);
+  // Builds a position from raw square values (as returned by rawAt()) and the FEN state fields.
+  // Used by compact storage formats; throws std::runtime_error on out-of-range square values.
+  [[nodiscard]] static Position fromRaw(const std::array<std::int8_t, SQ_N>& board, Color turn, std::array<bool, 2> bastionRight,
+                                         std::array<bool, 2> wallBuiltLast, int halfmove, int fullmove);
 
   [[nodiscard]] Color turn() const { return turn_; }
   [[nodiscard]] bool bastionRight(Color c) const { return bastionRight_[static_cast<int>(c)]; }
@@ -66,6 +70,8 @@ public:
   [[nodiscard]] bool wallBuiltLast(Color c) const { return wallBuiltLast_[static_cast<int>(c)]; }
   [[nodiscard]] int wallTokens(Color c) const { return wallTokens_[static_cast<int>(c)]; }
   [[nodiscard]] std::uint8_t sovereignSq(Color c) const { return sovereignSq_[static_cast<int>(c)]; }
+  [[nodiscard]] int halfmoveClock() const { return halfmove_; }
+  [[nodiscard]] int fullmoveNumber() const { return fullmove_; }
 
   [[nodiscard]] uint64_t hash() const { return hash_; }
   [[nodiscard]] bool isRepetition() const;
@@ -77,12 +83,21 @@ public:
   // Move generation includes all turn-actions (move/capture, construct, command, demolish, bastion).
   void generateMoves(MoveList& out);
 
+  // Number of moves generateMoves() would produce for the side to move (or for `side`, e.g. for
+  // mobility terms), counted without emitting them. Catapult demolish variants, command+build
+  // combinations and Bastion wall pairs are counted combinatorially.
+  [[nodiscard]] std::uint32_t countMoves();
+  [[nodiscard]] std::uint32_t countMoves(Color side);
+
   void makeMove(const Move& m, Undo& u);
   void undoMove(const Undo& u);
 
   void makeNullMove(NullUndo& u);
   void undoNullMove(const NullUndo& u);
 
+  // Pre-sizes the repetition history so that the next `plies` makeMove() calls do not allocate.
+  void reserveHistory(std::size_t plies) { history_.reserve(history_.size() + plies); }
+
   [[nodiscard]] std::string pretty() const;
 
   // Low-level inspection (useful for eval / debugging).
@@ -95,6 +110,7 @@ public:
   [[nodiscard]] bool hasDominance(Color c) const;
   [[nodiscard]] bool isEntombed(Color victim) const;
   [[nodiscard]] Bitboard81 computeAttacks(Color attacker) const;
+  [[nodiscard]] bool isSquareAttackedBy(Color attacker, std::uint8_t square) const;
 
 private:
   // Board encoding (signed):
@@ -155,7 +171,6 @@ private:
   void saveSquare(Undo& u, std::uint8_t s);
 
   [[nodiscard]] bool threatened(std::uint8_t square, Color forColor) const;
-  [[nodiscard]] bool isSquareAttackedBy(Color attacker, std::uint8_t square) const;
   [[nodiscard]] int masonMoveRange(std::uint8_t masonSq, Color c) const;
   [[nodiscard]] int ministerMoveRange(std::uint8_t ministerSq, Color c) const;
   [[nodiscard]] int sovereignMoveRange(std::uint8_t sovereignSq, Color c) const;
@@ -167,6 +182,11 @@ private:
   void genMasonExtras(MoveList& out, std::uint8_t masonSq, Color us, const Bitboard81& enemyAttacks);
   void genCatapultExtras(MoveList& out, std::uint8_t catSq, Color us);
   void genBastion(MoveList& out, std::uint8_t sovSq, Color us);
+
+  [[nodiscard]] std::uint32_t countSliderMoves(std::uint8_t fromSq, std::uint8_t dirBegin, std::uint8_t dirEnd, int maxSteps, Color us) const;
+  [[nodiscard]] std::uint32_t countMasonMoves(std::uint8_t masonSq, Color us, const Bitboard81& enemyAttacks, const Bitboard81& empty);
+  [[nodiscard]] std::uint32_t countCatapultMoves(std::uint8_t catSq, Color us, const Bitboard81& walls) const;
+  [[nodiscard]] std::uint32_t countBastion(std::uint8_t sovSq, Color us, const Bitboard81& empty) const;
 };
 
 } // namespace citadel
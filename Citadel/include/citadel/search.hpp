@@ -1,9 +1,11 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <string>
 #include <vector>
 
 #include "citadel/move.hpp"
@@ -12,18 +14,29 @@
 namespace citadel {
 
 class NNUE;
+struct SearchParams;
 
 struct SearchLimits {
   int depth = 4;                 // max depth in plies (>=1)
   std::uint64_t nodeLimit = 0;   // 0 = unlimited
   std::uint64_t timeLimitMs = 0; // 0 = unlimited
+
+  // Game clock of the side to move (UCI wtime/btime, winc/binc, movestogo). When timeLeftMs != 0
+  // a TimeManager derives soft/hard limits from it; timeLimitMs (if also set) caps the hard limit.
+  std::uint64_t timeLeftMs = 0;
+  std::uint64_t incMs = 0;
+  int movesToGo = 0;              // 0 = sudden death
+  std::uint64_t moveOverheadMs = 30;
 };
 
 struct SearchInfo {
   int depth = 0;
   int seldepth = 0;
+  int multipv = 1; // 1-based line index (MultiPV), lines are reported best-first
   int score = 0; // centipawn-like, from side-to-move perspective
   std::uint64_t nodes = 0;
+  std::uint64_t evalCacheProbes = 0;
+  std::uint64_t evalCacheHits = 0;
   std::uint64_t timeMs = 0;
   Move best = nullMove();
   std::vector<Move> pv;
@@ -36,22 +49,106 @@ enum class EvalBackend : std::uint8_t { HCE = 0, NNUE = 1 };
 struct SearchOptions {
   SearchLimits limits{};
   SearchInfoCallback onInfo{};
+
+  // Number of best root moves to search with exact scores (UCI MultiPV). Each completed
+  // iteration reports one SearchInfo per line.
+  int multiPV = 1;
+
+  // Restrict the root to these moves (UCI 'go searchmoves'). Ignored if none of them is legal.
+  std::vector<Move> searchMoves;
+
   std::atomic_bool* stop = nullptr; // optional external stop signal
 
+  // Optional ponder flag. While it reads true the search ignores its time limits and does not
+  // return (until `stop`); clearing it (UCI ponderhit) starts the normal time control.
+  std::atomic_bool* ponder = nullptr;
+
   // Evaluation selection.
   EvalBackend evalBackend = EvalBackend::HCE;
   const NNUE* nnue = nullptr; // required when evalBackend == NNUE
 
+  // Pruning/reduction constants; nullptr uses the global searchParams() (see searchparams.hpp).
+  const SearchParams* params = nullptr;
+
   // Transposition table (TT) usage. Set false when calling search concurrently from multiple
   // threads (Citadel's TT is single-threaded today).
   bool useTT = true;
+
+  // Static-evaluation cache usage. The cache is lock-free and shared by all threads.
+  bool useEvalCache = true;
+
+  // Start from (aged) move-ordering history of the previous keepHeuristics search instead of
+  // from scratch. Like the TT this state is global: only one such search may run at a time.
+  bool keepHeuristics = false;
+};
+
+// Hot-path search counters. They are only collected in builds with CITADEL_STATS defined
+// (-DCITADEL_STATS); otherwise the increments compile away and every field stays zero.
+#ifdef CITADEL_STATS
+inline constexpr bool kSearchStatsEnabled = true;
+#else
+inline constexpr bool kSearchStatsEnabled = false;
+#endif
+
+struct SearchStats {
+  // Interior nodes by type (non-PV nodes split by outcome: fail-high = cut, fail-low = all).
+  std::uint64_t pvNodes = 0;
+  std::uint64_t cutNodes = 0;
+  std::uint64_t allNodes = 0;
+  std::uint64_t qNodes = 0;
+
+  std::uint64_t ttProbes = 0;
+  std::uint64_t ttHits = 0;
+  std::uint64_t ttCutoffs = 0;
+
+  std::uint64_t nullTries = 0;
+  std::uint64_t nullCutoffs = 0;
+
+  std::uint64_t razorPrunes = 0;
+  std::uint64_t rfpPrunes = 0; // reverse futility
+  std::uint64_t futilityPrunes = 0;
+  std::uint64_t lmpPrunes = 0;
+  std::uint64_t lmrReductions = 0;
+  std::uint64_t lmrResearches = 0;
+
+  std::uint64_t betaCutoffs = 0;
+  std::uint64_t firstMoveCutoffs = 0;
+
+  std::uint64_t genNodes = 0; // interior nodes that generated moves
+  std::array<std::uint64_t, 6> genByType{}; // indexed by MoveType
+
+  SearchStats& operator+=(const SearchStats& o);
+};
+
+// Human-readable dump, one counter group per line.
+[[nodiscard]] std::vector<std::string> formatSearchStats(const SearchStats& st);
+
+// Counters of the most recently finished searchBestMove (any thread).
+[[nodiscard]] SearchStats lastSearchStats();
+
+// A root move with its statistics from the last completed iteration.
+struct RootMove {
+  Move move = nullMove();
+  int score = 0;           // side-to-move perspective; an upper bound unless `exact`
+  int previousScore = 0;   // score in the iteration before
+  bool exact = false;
+  std::uint64_t nodes = 0; // nodes spent below this move in the iteration
+  std::vector<Move> pv;    // starts with `move`
 };
 
 struct SearchResult {
   Move best = nullMove();
+  Move ponder = nullMove(); // expected reply from the PV (nullMove() if unknown)
   int score = 0; // centipawn-like, from side-to-move perspective
   std::uint64_t nodes = 0;
+  std::uint64_t evalCacheProbes = 0;
+  std::uint64_t evalCacheHits = 0;
   double seconds = 0.0;
+  SearchStats stats{}; // all zero unless built with CITADEL_STATS
+
+  // Searched root moves in final order: the MultiPV lines best-first, then the others in search
+  // order. Empty if no iteration completed.
+  std::vector<RootMove> rootMoves;
 };
 
 // Transposition table controls (useful for UCI).
@@ -59,9 +156,24 @@ void clearTranspositionTable();
 void setTranspositionTableSizeMB(std::size_t mb);
 [[nodiscard]] std::size_t transpositionTableSizeMB();
 
+// Forget move-ordering history carried by SearchOptions::keepHeuristics.
+void clearSearchHistory();
+
+// Static-evaluation cache controls. Clear after loading a different NNUE model.
+void clearEvalCache();
+
 [[nodiscard]] SearchResult searchBestMove(Position& pos, const SearchOptions& opt);
 [[nodiscard]] SearchResult searchBestMove(Position& pos, int depth);
 
+// Search-side Zobrist key (independent of Position::hash()) and its incremental update, as used
+// by the TT. Exposed for tooling and benchmarks.
+[[nodiscard]] std::uint64_t searchHash(const Position& pos);
+[[nodiscard]] std::uint64_t searchHashAfterMake(std::uint64_t parentKey, const Position& posAfterMove, const Undo& u);
+
+// True while the calling thread is inside negamax/quiescence (below the root). The search
+// performs no heap allocation there; allocation checkers use this to attribute allocations.
+[[nodiscard]] bool searchHotPathActive();
+
 // Evaluate a position without searching.
 // Returns a centipawn-like score from side-to-move perspective.
 [[nodiscard]] int evaluatePositionStm(const Position& pos, EvalBackend backend = EvalBackend::HCE, const NNUE* nnue = nullptr);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "citadel/search.hpp"
+
+namespace citadel {
+
+// Pruning and reduction constants of the search. NNUE and HCE scores are scaled differently, so
+// the eval-margin terms have a separate Nnue* copy; the search uses the one matching its backend.
+struct SearchParams {
+  enum Index : std::uint16_t {
+    // HCE backend (razoring and reverse futility are off with NNUE).
+    RazorBase,     // depth 1 margin
+    RazorDepth,    // added per extra ply (depth 2)
+    RfpBase,
+    RfpDepth,      // per ply
+    NmpMinDepth,
+    NmpMinPieces,  // own non-sovereign pieces needed for a null move
+    NmpBaseR,
+    NmpDeepDepth,  // one more ply of reduction from this depth on
+    FutilityMargin,
+    LmpMoves,      // quiet moves searched at depth 2 before late-move pruning
+    LmpMargin,
+
+    // NNUE backend.
+    NnueNmpMinDepth,
+    NnueNmpMinPieces,
+    NnueNmpBaseR,
+    NnueNmpDeepDepth,
+    NnueFutilityMargin,
+    NnueLmpMoves,
+    NnueLmpMargin,
+
+    // Both: late-move reductions r = 1 + (move >= LmrLateMoves) + (depth >= LmrDeepDepth).
+    LmrMinDepth,
+    LmrMinMoves,
+    LmrLateMoves,
+    LmrDeepDepth,
+    AspWindow,        // root aspiration half-width
+    AspWindowShallow, // the same at depth 2
+
+    Count
+  };
+
+  struct Info {
+    const char* name;
+    int value; // default
+    int min;
+    int max;
+    double step;       // SPSA perturbation at the end of a run
+    std::uint8_t uses; // bit 0: HCE search, bit 1: NNUE search
+  };
+
+  std::array<int, Count> value{};
+
+  [[nodiscard]] int operator[](Index i) const { return value[i]; }
+  int& operator[](Index i) { return value[i]; }
+
+  [[nodiscard]] static const SearchParams& defaults();
+  [[nodiscard]] static const Info& info(std::size_t i);
+  // Index of the parameter called `n` (case-insensitive, as UCI option names), or Count.
+  [[nodiscard]] static std::size_t find(std::string_view n);
+  [[nodiscard]] static bool usedBy(std::size_t i, EvalBackend backend);
+
+  // Text format of paramfile.hpp; missing parameters keep their default. Throws
+  // std::runtime_error on unknown names or values outside [min, max].
+  [[nodiscard]] static SearchParams load(const std::string& path);
+  void save(const std::string& path) const; // throws std::runtime_error
+};
+
+// Parameters of searches that do not bring their own (SearchOptions::params). Not to be changed
+// while such a search runs.
+[[nodiscard]] const SearchParams& searchParams();
+void setSearchParams(const SearchParams& p);
+
+} // namespace citadel
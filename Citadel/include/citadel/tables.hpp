@@ -3,6 +3,7 @@
 #include <array>
 #include <cstdint>
 
+#include "citadel/bitboard81.hpp"
 #include "citadel/core.hpp"
 
 namespace citadel {
@@ -47,6 +48,11 @@ struct Tables {
   std::array<std::uint8_t, SQ_N> kingCount{};
   std::array<std::array<std::uint8_t, 8>, SQ_N> kingTargets{}; // max 8
 
+  // The same neighbourhoods as sets (setwise counting).
+  std::array<Bitboard81, SQ_N> knightMask{};
+  std::array<Bitboard81, SQ_N> kingMask{};
+  std::array<Bitboard81, SQ_N> orthoMask{}; // 4-adjacent
+
   // Rays for sliding pieces. Each direction holds up to 8 squares.
   std::array<std::array<std::uint8_t, 8>, SQ_N> rayLen{};
   std::array<std::array<std::array<std::uint8_t, 8>, 8>, SQ_N> ray{};
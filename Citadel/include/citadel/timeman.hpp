@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace citadel {
+
+// Clock-based time allocation for a single move.
+//
+// - The soft limit is checked between iterations: once it has passed, no new depth is started.
+// - The hard limit aborts a running iteration.
+//
+// After every completed iteration the soft limit is rescaled by best-move stability, score drops
+// and the share of root nodes spent on the best move (a large share means an "easy" move).
+class TimeManager {
+public:
+  // `timeLeftMs` is the mover's remaining clock, `movesToGo` = 0 means sudden death.
+  void init(std::uint64_t timeLeftMs, std::uint64_t incMs, int movesToGo, std::uint64_t overheadMs);
+
+  [[nodiscard]] std::uint64_t softLimitMs() const { return softMs_; }
+  [[nodiscard]] std::uint64_t hardLimitMs() const { return hardMs_; }
+
+  // Feed the result of a completed iteration.
+  // `bestNodeShare` is nodes(best root move) / nodes(all root moves) in 0..1.
+  void onIteration(int depth, bool bestMoveChanged, int score, double bestNodeShare);
+
+  // True if no new iteration should be started.
+  [[nodiscard]] bool stopAfterIteration(std::uint64_t elapsedMs) const;
+
+private:
+  std::uint64_t softMs_ = 0;
+  std::uint64_t hardMs_ = 0;
+  double scale_ = 1.0;
+
+  int stableIters_ = 0;
+  int prevScore_ = 0;
+  bool havePrevScore_ = false;
+};
+
+} // namespace citadel
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace citadel {
+
+// Timeline events in Chrome trace_event format (load the file in chrome://tracing or Perfetto).
+//
+// Each thread records into its own fixed-size ring buffer (oldest events are overwritten), so
+// recording takes no lock and never allocates after a thread's first event. Event names,
+// categories and argument names must be string literals: only the pointers are stored.
+//
+// traceOpen()/traceClose() reset and drain all buffers; call them only while no search is running.
+
+namespace detail {
+inline std::atomic<bool> TRACE_ENABLED{false};
+}
+
+[[nodiscard]] inline bool traceEnabled() {
+  return detail::TRACE_ENABLED.load(std::memory_order_relaxed);
+}
+
+// Starts recording; the file is written by traceClose() (or the next traceOpen()).
+// Returns false if the file cannot be created.
+bool traceOpen(const std::string& path);
+
+// Stops recording and writes the JSON file. No-op if not recording.
+void traceClose();
+
+// Names the calling thread in the timeline.
+void traceThreadName(const char* name);
+
+// A point-in-time event with an optional integer argument.
+void traceInstant(const char* name, const char* category, const char* argName = nullptr, std::int64_t arg = 0);
+
+// A duration event covering the lifetime of the object.
+class TraceScope {
+public:
+  TraceScope(const char* name, const char* category, const char* argName = nullptr, std::int64_t arg = 0);
+  ~TraceScope();
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+  const char* name_;
+  const char* category_;
+  const char* argName_;
+  std::int64_t arg_;
+  std::uint64_t startNs_ = 0;
+  bool active_ = false;
+};
+
+} // namespace citadel
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "citadel/move.hpp"
+#include "citadel/position.hpp"
+
+namespace citadel {
+
+// Training-data file formats written by `datagen`.
+//
+// - Text:   one "<FEN> | <stm> <eval> <result>" line per sample, '#' comment lines.
+// - Packed: DataFileHeader, then fixed-size 64-byte PackedPosition records.
+// - Chain:  DataFileHeader, then one block per game: the packed start position, a uint32 entry
+//           count, and per played ply a ChainEntry (index of the played move in generateMoves()
+//           order + the search score, or kChainNoSample for a ply that is not a sample).
+//           Positions are recovered by replaying the moves, which costs ~4 bytes per sample
+//           instead of 64.
+//
+// Binary files are little-endian and written with the host layout (as the NNUE net files).
+enum class DataFormat : std::uint8_t { Text, Packed, Chain };
+
+[[nodiscard]] std::optional<DataFormat> parseDataFormat(std::string_view s); // "text" | "bin" | "chain"
+[[nodiscard]] const char* dataFormatName(DataFormat f);
+
+// Game result from White's point of view.
+inline constexpr std::int8_t kResultBlackWin = -1;
+inline constexpr std::int8_t kResultDraw = 0;
+inline constexpr std::int8_t kResultWhiteWin = 1;
+inline constexpr std::int8_t kResultUnknown = -128; // game cut off before a result
+
+struct PackedPosition {
+  // Square s lives in the low (even s) or high (odd s) nibble of cells[s / 2]:
+  // 0 empty, 1..7 White piece (PieceType + 1) or wall, 8..14 Black piece or wall.
+  std::array<std::uint8_t, 41> cells{};
+  std::array<std::uint8_t, 11> reinforced{}; // bit s set: the wall on s has 2 HP
+  std::uint8_t flags = 0;                    // kFlag* bits
+  std::int8_t result = kResultUnknown;
+  std::int16_t eval = 0; // search score, side to move's perspective
+  std::uint16_t ply = 0; // plies since the start of the datagen game
+  std::uint16_t halfmove = 0;
+  std::uint16_t fullmove = 1;
+  std::array<std::uint8_t, 2> reserved{};
+
+  static constexpr std::uint8_t kFlagBlackToMove = 1u << 0;
+  static constexpr std::uint8_t kFlagBastionWhite = 1u << 1;
+  static constexpr std::uint8_t kFlagBastionBlack = 1u << 2;
+  static constexpr std::uint8_t kFlagWallBuiltWhite = 1u << 3;
+  static constexpr std::uint8_t kFlagWallBuiltBlack = 1u << 4;
+
+  // Raw square value as Position::rawAt() would return it.
+  [[nodiscard]] std::int8_t rawAt(std::uint8_t s) const;
+  [[nodiscard]] Color turn() const { return (flags & kFlagBlackToMove) ? Color::Black : Color::White; }
+  [[nodiscard]] bool bastionRight(Color c) const { return flags & (c == Color::White ? kFlagBastionWhite : kFlagBastionBlack); }
+  [[nodiscard]] bool wallBuiltLast(Color c) const { return flags & (c == Color::White ? kFlagWallBuiltWhite : kFlagWallBuiltBlack); }
+};
+static_assert(sizeof(PackedPosition) == 64, "PackedPosition must stay 64 bytes (on-disk format)");
+
+[[nodiscard]] PackedPosition packPosition(const Position& pos, int eval, std::int8_t result, int ply);
+[[nodiscard]] Position unpackPosition(const PackedPosition& pp);
+
+struct ChainEntry {
+  std::uint16_t moveIndex = 0; // index into generateMoves() of the position before the move
+  std::int16_t eval = 0;       // kChainNoSample: the move is replayed but the position is not a sample
+};
+inline constexpr std::int16_t kChainNoSample = -32768;
+static_assert(sizeof(ChainEntry) == 4, "ChainEntry must stay 4 bytes (on-disk format)");
+
+struct DataFileHeader {
+  std::array<char, 4> magic{'C', 'T', 'D', 'A'};
+  std::uint16_t version = 1;
+  std::uint16_t format = 0; // DataFormat (Packed or Chain)
+};
+static_assert(sizeof(DataFileHeader) == 8, "DataFileHeader must stay 8 bytes (on-disk format)");
+
+// Index of `m` in pos.generateMoves() order, or -1 if it is not a legal move.
+[[nodiscard]] int moveIndexOf(Position& pos, const Move& m);
+
+// One sample line of a Text file. Lines written before results were recorded have no result
+// field; they parse with result == kResultUnknown.
+struct TextSample {
+  std::string fen;
+  Color stm = Color::White;
+  int eval = 0;
+  std::int8_t result = kResultUnknown;
+};
+
+// nullopt for comment, blank or malformed lines.
+[[nodiscard]] std::optional<TextSample> parseTextSample(std::string_view line);
+// "<FEN> | <stm> <eval> <result>" (no result field if it is unknown), without the newline.
+[[nodiscard]] std::string formatTextSample(const TextSample& s);
+
+// Serialization into a byte buffer (datagen workers batch records before writing).
+void appendDataFileHeader(std::string& buf, DataFormat format);
+void appendPacked(std::string& buf, const PackedPosition& pp);
+// `start` carries the game result; the moves of `entries` are replayed from it.
+void appendChainGame(std::string& buf, const PackedPosition& start, const std::vector<ChainEntry>& entries);
+
+// Streaming reader for datagen files of any format (binary files are recognized by their
+// header, anything else is read as Text); yields one PackedPosition per sample in file order.
+// Text samples carry ply 0. Throws std::runtime_error on open failure, bad headers, malformed
+// text lines or corrupt chains.
+class TrainingDataReader {
+public:
+  explicit TrainingDataReader(const std::string& path);
+
+  [[nodiscard]] DataFormat format() const { return format_; }
+
+  // Next sample; false at end of file.
+  bool next(PackedPosition& out);
+
+  // Replaces `out` with up to `max` next samples; returns how many were read (0 at end of
+  // file). Text lines are parsed on `threads` threads, which is where text input spends its time.
+  std::size_t nextBatch(std::vector<PackedPosition>& out, std::size_t max, int threads = 1);
+
+  // Chain files only: the next game block as stored (start position and all of its entries),
+  // without replaying it; false at end of file. Not to be mixed with next().
+  bool nextGame(PackedPosition& start, std::vector<ChainEntry>& entries);
+
+private:
+  bool readBytes(void* dst, std::size_t n);
+  bool nextTextLine(std::string& line); // next non-comment line
+  [[nodiscard]] PackedPosition parseTextLine(const std::string& line, std::uint64_t lineNo) const;
+
+  std::ifstream in_;
+  std::string path_;
+  DataFormat format_ = DataFormat::Packed;
+  std::uint64_t lineNo_ = 0; // Text: lines consumed so far
+
+  // Chain state: the current game position and the entries left in its block.
+  Position chainPos_;
+  PackedPosition chainStart_{};
+  std::uint32_t chainLeft_ = 0;
+  int chainPly_ = 0;
+};
+
+} // namespace citadel
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+namespace citadel {
+
+// An engine binary driven over its stdin/stdout (UCI), as used by `citadel match`. The command
+// line is run by /bin/sh, so it may carry arguments. POSIX only; elsewhere start() fails.
+class UciProcess {
+public:
+  UciProcess() = default;
+  UciProcess(const UciProcess&) = delete;
+  UciProcess& operator=(const UciProcess&) = delete;
+  ~UciProcess(); // sends "quit", then kills the process if it does not exit
+
+  // Returns false (see lastError()) if the process cannot be started.
+  bool start(const std::string& command);
+  void stop();
+
+  // False once the engine closed its output or a write to it failed.
+  [[nodiscard]] bool alive() const { return alive_; }
+
+  bool send(const std::string& line); // appends the newline
+  // Next output line without the newline; nullopt on end of output or after timeoutMs
+  // (negative: no timeout).
+  std::optional<std::string> readLine(int timeoutMs);
+
+  [[nodiscard]] const std::string& lastError() const { return lastError_; }
+
+private:
+  int pid_ = -1;
+  int toChild_ = -1;
+  int fromChild_ = -1;
+  bool alive_ = false;
+  std::string buffer_; // output read past the last returned line
+  std::string lastError_;
+};
+
+} // namespace citadel
@@ -172,5 +172,26 @@ Position Position::fromFEN(std::string_view fen) {
   return p;
 }
 
+Position Position::fromRaw(const std::array<std::int8_t, SQ_N>& board, Color turn, std::array<bool, 2> bastionRight,
+                           std::array<bool, 2> wallBuiltLast, int halfmove, int fullmove) {
+  Position p;
+  for (std::uint8_t s = 0; s < SQ_N; ++s) {
+    const std::int8_t v = board[s];
+    if (v < -8 || v > 8) throw std::runtime_error("Invalid raw board: square value out of range");
+    p.b_[s] = v;
+  }
+  p.turn_ = turn;
+  for (int c = 0; c < 2; ++c) {
+    p.bastionRight_[c] = bastionRight[static_cast<std::size_t>(c)];
+    p.wallBuiltLast_[c] = wallBuiltLast[static_cast<std::size_t>(c)];
+  }
+  p.halfmove_ = halfmove;
+  p.fullmove_ = fullmove;
+  p.winner_ = SQ_NONE;
+  p.winReason_ = WinReason::None;
+  p.rebuildDerived();
+  return p;
+}
+
 } // namespace citadel
 
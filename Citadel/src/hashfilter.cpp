@@ -0,0 +1,47 @@
+#include "citadel/hashfilter.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace citadel {
+
+HashFilter::HashFilter(std::size_t sizeMB) {
+  blockCount_ = std::max<std::size_t>(1, (sizeMB * 1024 * 1024) / sizeof(Block));
+  blocks_ = std::make_unique<Block[]>(blockCount_);
+  for (std::size_t i = 0; i < blockCount_; ++i) {
+    for (auto& w : blocks_[i].w) w.store(0, std::memory_order_relaxed);
+  }
+}
+
+template <typename Fn>
+void HashFilter::forEachBit(std::uint64_t key, Fn&& fn) const {
+  // Block from the key, bit positions from a remix of it so they are independent of the block.
+  const auto block = static_cast<std::size_t>(std::rotl(key, 32) % blockCount_);
+  Block& b = blocks_[block];
+
+  std::uint64_t h = key * 0x9E3779B97F4A7C15ull;
+  for (int i = 0; i < kBitsPerKey; ++i) {
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    const std::uint64_t bit = h >> 55; // 0..511
+    fn(b.w[bit >> 6], std::uint64_t{1} << (bit & 63));
+  }
+}
+
+bool HashFilter::insert(std::uint64_t key) {
+  bool fresh = false;
+  forEachBit(key, [&](std::atomic<std::uint64_t>& w, std::uint64_t mask) {
+    if (!(w.fetch_or(mask, std::memory_order_relaxed) & mask)) fresh = true;
+  });
+  return fresh;
+}
+
+bool HashFilter::contains(std::uint64_t key) const {
+  bool seen = true;
+  forEachBit(key, [&](std::atomic<std::uint64_t>& w, std::uint64_t mask) {
+    if (!(w.load(std::memory_order_relaxed) & mask)) seen = false;
+  });
+  return seen;
+}
+
+} // namespace citadel
@@ -0,0 +1,519 @@
+#include "citadel/hce.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "citadel/paramfile.hpp"
+#include "citadel/search.hpp"
+#include "citadel/tables.hpp"
+
+namespace citadel {
+
+// --------------------------------------------------------------------------------------
+// Parameters
+// --------------------------------------------------------------------------------------
+
+struct HceParamInfo {
+  const char* name;
+  int value;
+};
+
+// Same order as HceParams::Index.
+static constexpr std::array<HceParamInfo, HceParams::Count> PARAM_INFO = {{
+    {"MasonMg", 100},
+    {"MasonEg", 225},
+    {"CatapultMg", 550},
+    {"CatapultEg", 600},
+    {"LancerMg", 350},
+    {"LancerEg", 350},
+    {"PegasusMg", 400},
+    {"PegasusEg", 500},
+    {"MinisterMg", 450},
+    {"MinisterEg", 450},
+
+    {"MasonCenter", 4},
+    {"MasonKeep", 6},
+    {"CatapultCenter", 3},
+    {"CatapultKeep", 4},
+    {"LancerCenter", 4},
+    {"LancerKeep", 6},
+    {"PegasusCenter", 4},
+    {"PegasusKeep", 6},
+    {"MinisterCenter", 5},
+    {"MinisterKeep", 8},
+    // Sovereign PST is intentionally much larger to create strong "gravity" toward the Keep.
+    {"SovereignCenter", 20},
+    {"SovereignKeep", 40},
+
+    {"MasonPressure", 10},
+    {"CatapultPressure", 6},
+    {"LancerPressure", 6},
+    {"PegasusPressure", 10},
+    {"MinisterPressure", 3},
+
+    {"MasonMinisterSynergy", 20},   // mason gets much stronger if it can Command.
+    {"WallPerHp", 2},               // keep minimal to avoid valuing useless corner walls.
+    {"WallChoke", 6},               // walls on the Keep boundary ring can be useful, but don't overvalue early.
+    {"Dominance", 25},              // lower than before; PST handles "gravity" toward the Keep.
+    {"BastionRightOpening", 80},    // keeping Bastion available early is valuable
+    {"WallAdjSovereign", 15},       // walls adjacent to own sovereign are valuable protection.
+    {"SiegeAttrition", 200},        // immobilized sovereign penalty.
+    {"WallTokenOpeningPerHp", 3},   // discourage over-building walls early
+    {"Mobility", 2},                // activity: reward attacked squares (proxy for mobility/development)
+    {"KingWander", 45},             // per square away from start, scaled by opening
+    {"KingKeepEarly", 140},         // sovereign in Keep too early is dangerous
+    {"KingAttacked", 700},          // enemy attacks sovereign square (immediate regicide threat)
+    {"KingRingAttack", 55},         // per adjacent square attacked around sovereign
+    {"EntombPressure", 18},
+    {"Tempo", 20},
+    {"CatapultMonopoly", 200},      // one side has catapults, the other has none
+    {"CatapultEdgeMax", 150},       // bonus for having catapult edge in locked endgames
+}};
+
+static constexpr HceParams buildDefaults() {
+  HceParams p;
+  for (std::size_t i = 0; i < p.value.size(); ++i) p.value[i] = PARAM_INFO[i].value;
+  return p;
+}
+
+static constexpr HceParams DEFAULT_PARAMS = buildDefaults();
+static HceParams g_params = DEFAULT_PARAMS;
+
+const HceParams& HceParams::defaults() { return DEFAULT_PARAMS; }
+
+const char* HceParams::name(std::size_t i) { return (i < PARAM_INFO.size()) ? PARAM_INFO[i].name : "?"; }
+
+std::size_t HceParams::find(std::string_view n) { return findParam(n, Count, name); }
+
+HceParams HceParams::load(const std::string& path) {
+  HceParams p = DEFAULT_PARAMS;
+  loadParamFile(path, "hce params", p.value, name);
+  return p;
+}
+
+void HceParams::save(const std::string& path) const { saveParamFile(path, "hce params", value, name); }
+
+const HceParams& hceParams() { return g_params; }
+
+void setHceParams(const HceParams& p) {
+  g_params = p;
+  clearEvalCache(); // cached scores were computed with the old weights
+}
+
+// --------------------------------------------------------------------------------------
+// Evaluation
+// --------------------------------------------------------------------------------------
+
+static inline int abs8(std::int8_t v) { return (v < 0) ? -static_cast<int>(v) : static_cast<int>(v); }
+static inline bool isPieceVal(std::int8_t v) {
+  const int a = abs8(v);
+  return a >= 1 && a <= 6;
+}
+static inline bool isWallVal(std::int8_t v) {
+  const int a = abs8(v);
+  return a >= 7;
+}
+static inline Color colorOf(std::int8_t v) { return (v > 0) ? Color::White : Color::Black; }
+
+// Endgame / wall heuristics
+static constexpr int WALLS_MANY_START = 12;             // total wall HP where games start to "lock"
+static constexpr int WALLS_MANY_FULL = 25;              // total wall HP considered very locked
+static constexpr int NO_CAT_DRAWISH_SCALE_MAX = 256;    // max % shrink (in /256) when no catapults and walls are high
+static constexpr int SIEGE_WALL_TOKENS = 15;            // more wall HP than this: SiegeAttrition applies
+
+// Opening/midgame heuristics: discourage early sovereign adventures and wall spam.
+static constexpr int MAX_NON_SOV_PIECES = 34;           // initial position: 17 non-sovereign pieces per side
+
+static constexpr int pstCentrality(int r, int c) {
+  // Chebyshev distance from center (4,4) on a 9x9 board: 0..4
+  const int dr = (r >= 4) ? (r - 4) : (4 - r);
+  const int dc = (c >= 4) ? (c - 4) : (4 - c);
+  const int cheb = (dr > dc) ? dr : dc;
+  return 4 - cheb; // 4 at center, 0 on edge
+}
+
+static constexpr bool isKeepBoundaryRing(int r, int c) {
+  // A 5x5 "ring" around the Keep (Keep is 3..5). This corresponds to r/c in [2..6]
+  // and on the boundary of that box. These squares are typical entry chokepoints.
+  if (r < 2 || r > 6 || c < 2 || c > 6) return false;
+  if (isKeep(r, c)) return false;
+  return (r == 2 || r == 6 || c == 2 || c == 6);
+}
+
+// Per piece type (Mason..Minister): the first parameter of each group; Sovereign has no
+// material or pressure term.
+static constexpr HceParams::Index MATERIAL_MG[5] = {HceParams::MasonMg, HceParams::CatapultMg, HceParams::LancerMg,
+                                                    HceParams::PegasusMg, HceParams::MinisterMg};
+static constexpr HceParams::Index PST_CENTER[6] = {HceParams::MasonCenter,    HceParams::CatapultCenter,
+                                                   HceParams::LancerCenter,   HceParams::PegasusCenter,
+                                                   HceParams::MinisterCenter, HceParams::SovereignCenter};
+static constexpr HceParams::Index PRESSURE[5] = {HceParams::MasonPressure, HceParams::CatapultPressure, HceParams::LancerPressure,
+                                                 HceParams::PegasusPressure, HceParams::MinisterPressure};
+
+static constexpr HceParams::Index next(HceParams::Index i) { return static_cast<HceParams::Index>(i + 1); }
+
+// kTrace == false compiles to the plain evaluation; with kTrace every weighted term also
+// records its coefficient. Integer arithmetic is identical in both.
+template <bool kTrace>
+static int evalImpl(const Position& pos, const HceParams& P, HceTrace* trace) {
+  using I = HceParams;
+  // Positive = good for White.
+  int scoreW = 0;
+  int scoreB = 0;
+
+  // Coefficient of parameter `i` in the score of `side` (stored from White's view).
+  auto term = [&](bool white, I::Index i, float c) {
+    if constexpr (kTrace) trace->coeff[i] += white ? c : -c;
+  };
+
+  const auto& T = tables();
+
+  // Game phase: 0 = opening, 256 = endgame (fewer pieces).
+  int nonSovPieces = 0;
+  for (std::uint8_t s = 0; s < SQ_N; ++s) {
+    const std::int8_t v = pos.rawAt(s);
+    if (v == 0) continue;
+    const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
+    if (av >= 1 && av <= 6) {
+      const int ptIdx = av - 1;
+      if (ptIdx != static_cast<int>(PieceType::Sovereign)) ++nonSovPieces;
+    }
+  }
+  int missing = MAX_NON_SOV_PIECES - nonSovPieces;
+  if (missing < 0) missing = 0;
+  const int phase = (missing * 256 + (MAX_NON_SOV_PIECES / 2)) / MAX_NON_SOV_PIECES; // 0..256
+  const int opening = 256 - phase;
+  const float phaseF = static_cast<float>(phase) / 256.0f;
+  const float openingF = static_cast<float>(opening) / 256.0f;
+
+  const int wallsW = pos.wallTokens(Color::White);
+  const int wallsB = pos.wallTokens(Color::Black);
+  const int totalWalls = wallsW + wallsB;
+
+  auto clamp256 = [](int x) -> int { return (x < 0) ? 0 : (x > 256) ? 256 : x; };
+  const int wallMany = clamp256(((totalWalls - WALLS_MANY_START) * 256) / (WALLS_MANY_FULL - WALLS_MANY_START));
+  const int wallEndgame = (wallMany * phase) / 256; // 0..256
+  const float wallEndgameF = static_cast<float>(wallEndgame) / 256.0f;
+
+  // 1. Calculate Sovereign Safety (Denominators for Proximity Heuristic)
+  auto calculateSafety = [&](Color c) -> int {
+    const std::uint8_t ks = pos.sovereignSq(c);
+    if (ks == SQ_NONE) return 100; // King dead or missing? Treat as infinite safety to avoid div/0 errors, though game should be over.
+
+    int safety = 1; // Base safety
+    int wallSafetyCount = 0;
+
+    for (std::uint8_t i = 0; i < T.kingCount[ks]; ++i) {
+      const std::uint8_t adj = T.kingTargets[ks][i];
+      const std::int8_t v = pos.rawAt(adj);
+      if (v == 0) continue;
+
+      // Friendly Piece: +2 safety (blocker + potential helper)
+      if (isPieceVal(v) && colorOf(v) == c) {
+        safety += 2;
+      }
+      // Friendly Wall: +1 safety (blocker), cap wall contribution at 3.
+      // (Too many walls = entombment risk, not safety).
+      else if (isWallVal(v) && colorOf(v) == c) {
+        if (wallSafetyCount < 3) {
+          safety += 1;
+          wallSafetyCount++;
+        }
+      }
+    }
+    return safety;
+  };
+
+  const int safetyW = calculateSafety(Color::White);
+  const int safetyB = calculateSafety(Color::Black);
+  int pressureOnW = 0;
+  int pressureOnB = 0;
+
+  const std::uint8_t sovSqW = pos.sovereignSq(Color::White);
+  const std::uint8_t sovSqB = pos.sovereignSq(Color::Black);
+
+  // Main Board Loop
+  for (std::uint8_t s = 0; s < SQ_N; ++s) {
+    const std::int8_t v = pos.rawAt(s);
+    if (v == 0) continue;
+
+    const bool isWhite = v > 0;
+    const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
+    int& score = isWhite ? scoreW : scoreB;
+
+    if (av >= 1 && av <= 6) {
+      // It is a Piece
+      const int ptIdx = av - 1;
+      const PieceType pt = static_cast<PieceType>(ptIdx);
+      const auto pi = static_cast<std::size_t>(ptIdx);
+
+      // A. Material & PST
+      const int cent = pstCentrality(row(s), col(s));
+      const int keep = isKeepSq(s) ? 1 : 0;
+      const I::Index pc = PST_CENTER[pi];
+      const int pst = cent * P[pc] + keep * P[next(pc)];
+      if (pt == PieceType::Sovereign) {
+        score += (pst * phase) / 256;
+        term(isWhite, pc, static_cast<float>(cent) * phaseF);
+        term(isWhite, next(pc), static_cast<float>(keep) * phaseF);
+      } else {
+        // Material is interpolated toward its locked-endgame value as walls pile up.
+        const I::Index mg = MATERIAL_MG[pi];
+        score += P[mg] + ((P[next(mg)] - P[mg]) * wallEndgame) / 256;
+        score += pst;
+        term(isWhite, mg, 1.0f - wallEndgameF);
+        term(isWhite, next(mg), wallEndgameF);
+        term(isWhite, pc, static_cast<float>(cent));
+        term(isWhite, next(pc), static_cast<float>(keep));
+      }
+
+      // B. Sovereign Proximity / Vulnerability Heuristic
+      // If this piece is attacking the enemy sovereign, calculate pressure.
+      const std::uint8_t targetSov = isWhite ? sovSqB : sovSqW;
+      if (targetSov != SQ_NONE && pt != PieceType::Sovereign) {
+        const int r = row(s), c = col(s);
+        const int tr = row(targetSov), tc = col(targetSov);
+        const int dr = (r > tr) ? (r - tr) : (tr - r);
+        const int dc = (c > tc) ? (c - tc) : (tc - c);
+        const int dist = (dr > dc) ? dr : dc; // Chebyshev distance
+
+        if (dist <= 4) {
+          // Formula: Weight * (5 - Distance)
+          // Dist 1: Weight*4. Dist 4: Weight*1.
+          const int pVal = P[PRESSURE[pi]] * (5 - dist);
+          if (isWhite) pressureOnB += pVal; else pressureOnW += pVal;
+          term(isWhite, PRESSURE[pi], static_cast<float>((5 - dist) * 4) / static_cast<float>(isWhite ? safetyB : safetyW));
+        }
+      }
+
+      // C. Minister-Mason synergy
+      if (pt == PieceType::Mason) {
+        for (std::uint8_t i = 0; i < T.kingCount[s]; ++i) {
+          const std::uint8_t adj = T.kingTargets[s][i];
+          const std::int8_t v2 = pos.rawAt(adj);
+          if (v2 == 0) continue;
+          const int av2 = (v2 < 0) ? -static_cast<int>(v2) : static_cast<int>(v2);
+          if (av2 != (1 + static_cast<int>(PieceType::Minister))) continue;
+          if ((v2 > 0) == isWhite) {
+            score += P[I::MasonMinisterSynergy];
+            term(isWhite, I::MasonMinisterSynergy, 1.0f);
+            break;
+          }
+        }
+      }
+    } else {
+      // It is a Wall
+      const int hp = av - 6;
+      score += P[I::WallPerHp] * hp;
+      term(isWhite, I::WallPerHp, static_cast<float>(hp));
+
+      const int r = row(s);
+      const int c = col(s);
+      if (isKeepBoundaryRing(r, c)) {
+        score += (P[I::WallChoke] * phase) / 256;
+        term(isWhite, I::WallChoke, phaseF);
+      }
+    }
+  }
+
+  // Apply Proximity Scores (Pressure / Safety)
+  // We apply this to the attacker's score.
+  scoreW += (pressureOnB * 4) / safetyB; // *4 is a scaling factor to bring it to CP range (safety usually 1..5)
+  scoreB += (pressureOnW * 4) / safetyW;
+
+  // Global Heuristics
+  for (const Color c : {Color::White, Color::Black}) {
+    const bool white = c == Color::White;
+    int& sc = white ? scoreW : scoreB;
+    if (pos.hasDominance(c)) {
+      sc += (P[I::Dominance] * phase) / 256;
+      term(white, I::Dominance, phaseF);
+    }
+    if (pos.bastionRight(c)) {
+      sc += (P[I::BastionRightOpening] * opening) / 256;
+      term(white, I::BastionRightOpening, openingF);
+    }
+  }
+
+  // Helper for wall adjacency bonus
+  auto addAdjWallBonus = [&](Color c, int& sc) {
+    const std::uint8_t ks = pos.sovereignSq(c);
+    if (ks == SQ_NONE) return;
+    for (std::uint8_t i = 0; i < T.kingCount[ks]; ++i) {
+      const std::uint8_t adj = T.kingTargets[ks][i];
+      const std::int8_t v = pos.rawAt(adj);
+      if (v == 0) continue;
+      const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
+      if (av < 7) continue;
+      const bool wallIsWhite = v > 0;
+      if ((c == Color::White) == wallIsWhite) {
+        sc += P[I::WallAdjSovereign];
+        term(wallIsWhite, I::WallAdjSovereign, 1.0f);
+      }
+    }
+  };
+  addAdjWallBonus(Color::White, scoreW);
+  addAdjWallBonus(Color::Black, scoreB);
+
+  // Penalties
+  for (const Color c : {Color::White, Color::Black}) {
+    const bool white = c == Color::White;
+    int& sc = white ? scoreW : scoreB;
+    const int tokens = pos.wallTokens(c);
+    if (tokens > SIEGE_WALL_TOKENS) {
+      sc -= P[I::SiegeAttrition];
+      term(white, I::SiegeAttrition, -1.0f);
+    }
+    sc -= (tokens * P[I::WallTokenOpeningPerHp] * opening) / 256;
+    term(white, I::WallTokenOpeningPerHp, -static_cast<float>(tokens) * openingF);
+  }
+
+  // Mobility
+  const Bitboard81 attW = pos.computeAttacks(Color::White);
+  const Bitboard81 attB = pos.computeAttacks(Color::Black);
+  const int mobW = static_cast<int>(attW.popcount());
+  const int mobB = static_cast<int>(attB.popcount());
+  scoreW += P[I::Mobility] * mobW;
+  scoreB += P[I::Mobility] * mobB;
+  term(true, I::Mobility, static_cast<float>(mobW));
+  term(false, I::Mobility, static_cast<float>(mobB));
+
+  // King Safety (Penalty-based)
+  auto kingSafetyPen = [&](Color c, const Bitboard81& enemyAttacks) -> int {
+    const bool white = c == Color::White;
+    const std::uint8_t ks = pos.sovereignSq(c);
+    if (ks == SQ_NONE) return 0;
+    int pen = 0;
+    const std::uint8_t home = white ? sq(8, 4) : sq(0, 4);
+    const int dr = std::abs(row(ks) - row(home));
+    const int dc = std::abs(col(ks) - col(home));
+    const int cheb = (dr > dc) ? dr : dc;
+    pen += (P[I::KingWander] * cheb * opening) / 256;
+    term(white, I::KingWander, -static_cast<float>(cheb) * openingF);
+    if (isKeepSq(ks)) {
+      pen += (P[I::KingKeepEarly] * opening) / 256;
+      term(white, I::KingKeepEarly, -openingF);
+    }
+    if (enemyAttacks.test(ks)) {
+      pen += P[I::KingAttacked];
+      term(white, I::KingAttacked, -1.0f);
+    }
+    int ringAtt = 0;
+    const int r0 = row(ks);
+    const int c0 = col(ks);
+    for (const auto& d : DIRS8) {
+      const int rr = r0 + d.r;
+      const int cc = c0 + d.c;
+      if (!inBounds(rr, cc)) continue;
+      const std::uint8_t adj = sq(rr, cc);
+      if (enemyAttacks.test(adj)) ++ringAtt;
+    }
+    pen += P[I::KingRingAttack] * ringAtt;
+    term(white, I::KingRingAttack, -static_cast<float>(ringAtt));
+    return pen;
+  };
+  scoreW -= kingSafetyPen(Color::White, attB);
+  scoreB -= kingSafetyPen(Color::Black, attW);
+
+  // Entombment Pressure
+  auto entombPressure = [&](Color attacker) -> int {
+    const Color victim = other(attacker);
+    const std::uint8_t vk = pos.sovereignSq(victim);
+    if (vk == SQ_NONE) return 0;
+    int blocked = 0;
+    const int r0 = row(vk);
+    const int c0 = col(vk);
+    for (const auto& d : DIRS8) {
+      const int rr = r0 + d.r;
+      const int cc = c0 + d.c;
+      if (!inBounds(rr, cc)) { ++blocked; continue; }
+      const std::uint8_t adj = sq(rr, cc);
+      const std::int8_t v = pos.rawAt(adj);
+      const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
+      if (av >= 7) ++blocked;
+    }
+    return blocked;
+  };
+  const int entombW = entombPressure(Color::White);
+  const int entombB = entombPressure(Color::Black);
+  scoreW += P[I::EntombPressure] * entombW;
+  scoreB += P[I::EntombPressure] * entombB;
+  term(true, I::EntombPressure, static_cast<float>(entombW));
+  term(false, I::EntombPressure, static_cast<float>(entombB));
+
+  // ----------------------------------------------------------------------------
+  // Tempo
+  // ----------------------------------------------------------------------------
+  // We apply Tempo here so that it gets scaled down if the position is deemed
+  // drawish/locked later. This prevents score oscillation (+20/-20) in dead draws
+  // while preserving initiative scores in open positions.
+  if (pos.turn() == Color::White) scoreW += P[I::Tempo];
+  else scoreB += P[I::Tempo];
+  term(pos.turn() == Color::White, I::Tempo, 1.0f);
+
+  int diff = scoreW - scoreB;
+
+  // ----------------------------------------------------------------------------
+  // Catapult / Wall Endgame & Draw Heuristics
+  // ----------------------------------------------------------------------------
+  const int catW = static_cast<int>(pos.pieceCount(Color::White, PieceType::Catapult));
+  const int catB = static_cast<int>(pos.pieceCount(Color::Black, PieceType::Catapult));
+
+  if (catW == 0 && catB == 0) {
+    // 1. Both sides have NO Catapults. Walls are permanent.
+    const int mobTotal = mobW + mobB;
+    int drawish = clamp256(((60 - mobTotal) * 256) / 40);
+
+    const int masons = static_cast<int>(pos.pieceCount(Color::White, PieceType::Mason) +
+                                        pos.pieceCount(Color::Black, PieceType::Mason));
+    if (masons > 0) {
+      // Masons present + No Catapults = Infinite Wall potential => High Draw Probability.
+      // Apply strict score dampening.
+      int masonFactor = 200; // ~78% score reduction
+      if (totalWalls >= 4) masonFactor = 245; // ~95% score reduction
+      drawish = std::max(drawish, masonFactor);
+    } else {
+      // No Masons, No Catapults. Static board.
+      // If walls are high, it's likely drawn/locked.
+      int staticWallFactor = (totalWalls * 20);
+      if (staticWallFactor > 256) staticWallFactor = 256;
+      drawish = std::max(drawish, staticWallFactor);
+    }
+
+    const int scale = 256 - (drawish * NO_CAT_DRAWISH_SCALE_MAX) / 256;
+    diff = (diff * scale) / 256;
+    if constexpr (kTrace) trace->scale = scale;
+
+  } else {
+    // 2. At least one side has a Catapult.
+
+    // Check for "Monopoly": One side has catapults, the other has NONE.
+    // This is a massive strategic advantage (conversion potential) regardless of phase.
+    if (catW > 0 && catB == 0) {
+      diff += P[I::CatapultMonopoly];
+      term(true, I::CatapultMonopoly, 1.0f);
+    } else if (catB > 0 && catW == 0) {
+      diff -= P[I::CatapultMonopoly];
+      term(false, I::CatapultMonopoly, 1.0f);
+    }
+
+    // Small edge bonus for having *more* catapults in endgame (e.g. 2 vs 1)
+    if (catW != catB) {
+      const int edge = (catW > catB) ? 1 : -1;
+      const int bonus = (P[I::CatapultEdgeMax] * wallEndgame) / 256;
+      diff += edge * bonus;
+      term(catW > catB, I::CatapultEdgeMax, wallEndgameF);
+    }
+  }
+
+  return diff;
+}
+
+int evaluateHce(const Position& pos) { return evalImpl<false>(pos, g_params, nullptr); }
+
+int evaluateHce(const Position& pos, HceTrace& trace) {
+  trace = HceTrace{};
+  return evalImpl<true>(pos, g_params, &trace);
+}
+
+} // namespace citadel
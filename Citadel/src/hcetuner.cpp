@@ -0,0 +1,128 @@
+#include "citadel/hcetuner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "citadel/parallel.hpp"
+
+namespace citadel {
+
+namespace {
+
+inline double sigmoid(double x) { return 1.0 / (1.0 + std::exp(-x)); }
+
+} // namespace
+
+HceTuner::HceTuner(const HceParams& start, const HceTuneOptions& opt) : opt_(opt) {
+  opt_.threads = std::max(1, opt_.threads);
+  for (std::size_t i = 0; i < theta_.size(); ++i) theta_[i] = start.value[i];
+  grads_.resize(static_cast<std::size_t>(opt_.threads));
+}
+
+void HceTuner::addSamples(const std::vector<PackedPosition>& samples) {
+  struct Slice {
+    std::vector<Term> terms;
+    std::vector<Sample> samples;
+    double error = 0.0;
+  };
+  std::vector<Slice> slices(static_cast<std::size_t>(opt_.threads));
+  const HceParams& p = hceParams();
+
+  parallelFor(samples.size(), opt_.threads, [&](std::size_t w, std::size_t begin, std::size_t end) {
+    Slice& sl = slices[w];
+    HceTrace trace;
+    for (std::size_t i = begin; i < end; ++i) {
+      const PackedPosition& pp = samples[i];
+      const Position pos = unpackPosition(pp);
+      const int eval = evaluateHce(pos, trace);
+
+      Sample s;
+      s.begin = sl.terms.size();
+      s.scale = static_cast<std::uint16_t>(trace.scale);
+      double linear = 0.0;
+      for (std::size_t k = 0; k < trace.coeff.size(); ++k) {
+        if (trace.coeff[k] == 0.0f) continue;
+        sl.terms.push_back(Term{static_cast<std::uint16_t>(k), trace.coeff[k]});
+        linear += static_cast<double>(trace.coeff[k]) * p.value[k];
+      }
+      s.count = static_cast<std::uint16_t>(sl.terms.size() - s.begin);
+      sl.error += std::abs(linear * trace.scale / 256.0 - eval);
+
+      const double evalWhite = (pp.turn() == Color::White) ? pp.eval : -pp.eval;
+      double target = sigmoid(evalWhite / opt_.wdlScale);
+      if (pp.result != kResultUnknown) target = opt_.lambda * target + (1.0 - opt_.lambda) * (pp.result + 1) * 0.5;
+      s.target = static_cast<float>(target);
+      sl.samples.push_back(s);
+    }
+  });
+
+  for (Slice& sl : slices) {
+    const std::uint64_t base = terms_.size();
+    for (Sample& s : sl.samples) s.begin += base;
+    terms_.insert(terms_.end(), sl.terms.begin(), sl.terms.end());
+    samples_.insert(samples_.end(), sl.samples.begin(), sl.samples.end());
+    traceErrorSum_ += sl.error;
+  }
+}
+
+double HceTuner::accumulate(std::size_t begin, std::size_t end, double* grad) const {
+  double loss = 0.0;
+  for (std::size_t i = begin; i < end; ++i) {
+    const Sample& s = samples_[i];
+    const Term* t = terms_.data() + s.begin;
+    double e = 0.0;
+    for (std::uint16_t k = 0; k < s.count; ++k) e += t[k].coeff * theta_[t[k].param];
+    const double scale = s.scale / 256.0;
+    const double p = sigmoid(e * scale / opt_.wdlScale);
+    const double err = p - s.target;
+    loss += err * err;
+    if (!grad) continue;
+    // d(err^2)/d(theta_j) = 2 * err * p * (1 - p) * scale / wdlScale * coeff_j
+    const double g = 2.0 * err * p * (1.0 - p) * scale / opt_.wdlScale;
+    for (std::uint16_t k = 0; k < s.count; ++k) grad[t[k].param] += g * t[k].coeff;
+  }
+  return loss;
+}
+
+double HceTuner::step() {
+  if (samples_.empty()) return 0.0;
+  std::vector<double> losses(grads_.size(), 0.0);
+  parallelFor(samples_.size(), opt_.threads, [&](std::size_t w, std::size_t begin, std::size_t end) {
+    grads_[w].fill(0.0);
+    losses[w] = accumulate(begin, end, grads_[w].data());
+  });
+
+  ++step_;
+  const double n = static_cast<double>(samples_.size());
+  const double c1 = 1.0 - std::pow(opt_.beta1, static_cast<double>(step_));
+  const double c2 = 1.0 - std::pow(opt_.beta2, static_cast<double>(step_));
+  double loss = 0.0;
+  for (const double l : losses) loss += l;
+  for (std::size_t j = 0; j < theta_.size(); ++j) {
+    double g = 0.0;
+    for (const auto& gw : grads_) g += gw[j];
+    g /= n;
+    m_[j] = opt_.beta1 * m_[j] + (1.0 - opt_.beta1) * g;
+    v_[j] = opt_.beta2 * v_[j] + (1.0 - opt_.beta2) * g * g;
+    theta_[j] -= opt_.learningRate * (m_[j] / c1) / (std::sqrt(v_[j] / c2) + opt_.epsilon);
+  }
+  return loss / n;
+}
+
+double HceTuner::loss() const {
+  if (samples_.empty()) return 0.0;
+  std::vector<double> losses(grads_.size(), 0.0);
+  parallelFor(samples_.size(), opt_.threads, [&](std::size_t w, std::size_t begin, std::size_t end) { losses[w] = accumulate(begin, end, nullptr); });
+  double loss = 0.0;
+  for (const double l : losses) loss += l;
+  return loss / static_cast<double>(samples_.size());
+}
+
+HceParams HceTuner::params() const {
+  HceParams p;
+  for (std::size_t i = 0; i < theta_.size(); ++i) p.value[i] = static_cast<int>(std::lround(theta_[i]));
+  return p;
+}
+
+} // namespace citadel
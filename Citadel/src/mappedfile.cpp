@@ -0,0 +1,91 @@
+#include "citadel/mappedfile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace citadel {
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+bool MappedFile::open(const std::string& path) {
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    lastError_ = "open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    lastError_ = "stat " + path + ": " + std::strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ == 0) {
+    ::close(fd);
+    return true; // nothing to map; data() stays null
+  }
+  void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file referenced
+  if (p == MAP_FAILED) {
+    lastError_ = "mmap " + path + ": " + std::strerror(errno);
+    size_ = 0;
+    return false;
+  }
+  data_ = static_cast<const std::uint8_t*>(p);
+  mapped_ = true;
+  return true;
+}
+
+void MappedFile::close() {
+  if (mapped_) ::munmap(const_cast<std::uint8_t*>(data_), size_);
+  mapped_ = false;
+  data_ = nullptr;
+  size_ = 0;
+  fallback_.clear();
+}
+
+void MappedFile::adviseSequential() const {
+  if (mapped_) ::madvise(const_cast<std::uint8_t*>(data_), size_, MADV_SEQUENTIAL);
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+  close();
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    lastError_ = "open " + path + " failed";
+    return false;
+  }
+  fallback_.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+  data_ = fallback_.data();
+  size_ = fallback_.size();
+  return true;
+}
+
+void MappedFile::close() {
+  fallback_.clear();
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void MappedFile::adviseSequential() const {}
+
+#endif
+
+} // namespace citadel
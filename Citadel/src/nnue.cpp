@@ -1,10 +1,13 @@
 #include "citadel/nnue.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <fstream>
 #include <limits>
 
+#include "citadel/trace.hpp"
+
 namespace citadel {
 
 namespace {
@@ -58,7 +61,9 @@ std::uint32_t NNUE::featureIndex(std::uint8_t sq, std::int8_t raw) {
 }
 
 bool NNUE::loadFromFile(const std::string& path) {
+  TraceScope trace("nnueLoad", "nnue");
   loaded_ = false;
+  id_ = 0;
   lastError_.clear();
   ftW_.clear();
   l2W_.clear();
@@ -168,6 +173,8 @@ bool NNUE::loadFromFile(const std::string& path) {
     outB_ = v;
   }
 
+  static std::atomic<std::uint64_t> nextId{1};
+  id_ = nextId.fetch_add(1, std::memory_order_relaxed);
   loaded_ = true;
   return true;
 }
@@ -0,0 +1,306 @@
+#include "citadel/nnuetrain.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "citadel/parallel.hpp"
+
+namespace citadel {
+
+namespace {
+
+template <typename T>
+static void writeRaw(std::ostream& out, const T& v) {
+  out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+static T quantize(float x, float scale) {
+  const double q = std::round(static_cast<double>(x) * scale);
+  return static_cast<T>(std::clamp(q, static_cast<double>(std::numeric_limits<T>::min()), static_cast<double>(std::numeric_limits<T>::max())));
+}
+
+// Output weight scale: h2 (0..127) times int8 weights, shifted by kShift3, gives centipawns.
+constexpr float kOutWScale = NnueTrainer::kOutputScale * static_cast<float>(1u << NnueTrainer::kShift3) / static_cast<float>(NNUE::kActMax);
+constexpr float kL2WScale = static_cast<float>(1u << NnueTrainer::kShift2);
+constexpr float kAct = static_cast<float>(NNUE::kActMax);
+
+} // namespace
+
+struct NnueTrainer::Forward {
+  std::array<std::uint32_t, SQ_N + 3> feats{};
+  std::size_t featCount = 0;
+  std::array<std::uint8_t, kH1> h1{};
+  std::array<bool, kH1> pass1{}; // inside the clipped-ReLU range (gradient flows)
+  std::array<std::uint8_t, kH2> h2{};
+  std::array<bool, kH2> pass2{};
+  int cp = 0;
+};
+
+NnueTrainer::NnueTrainer(const NnueTrainOptions& opt) : opt_(opt) {
+  opt_.threads = std::max(1, opt_.threads);
+
+  // Scaled so that about half of the first-layer units start inside the clipped range.
+  std::mt19937_64 rng(opt_.seed);
+  std::normal_distribution<float> ftInit(0.0f, 0.07f);
+  std::normal_distribution<float> l2Init(0.0f, 1.0f / 16.0f);
+  std::normal_distribution<float> outInit(0.0f, 1.0f / 6.0f);
+  ftW_.resize(static_cast<std::size_t>(kIn) * kH1);
+  for (auto& w : ftW_) w = ftInit(rng);
+  ftB_.assign(kH1, 0.25f);
+  l2W_.resize(static_cast<std::size_t>(kH2) * kH1);
+  for (auto& w : l2W_) w = std::clamp(l2Init(rng), -128.0f / kL2WScale, 127.0f / kL2WScale);
+  l2B_.assign(kH2, 0.1f);
+  outW_.resize(kH2);
+  for (auto& w : outW_) w = std::clamp(outInit(rng), -128.0f / kOutWScale, 127.0f / kOutWScale);
+
+  ftWA_.resize(ftW_.size());
+  ftBA_.resize(kH1);
+  l2WA_.resize(l2W_.size());
+  l2BA_.resize(kH2);
+  outWA_.resize(kH2);
+  outBA_.resize(1);
+
+  grads_.resize(static_cast<std::size_t>(opt_.threads));
+  for (auto& g : grads_) {
+    g.ftW.assign(ftW_.size(), 0.0f);
+    g.touched.assign(kIn, 0);
+    g.ftB.assign(kH1, 0.0f);
+    g.l2W.assign(l2W_.size(), 0.0f);
+    g.l2B.assign(kH2, 0.0f);
+    g.outW.assign(kH2, 0.0f);
+  }
+
+  qFtW_.resize(ftW_.size());
+  qFtB_.resize(kH1);
+  qL2W_.resize(l2W_.size());
+  qL2B_.resize(kH2);
+  qOutW_.resize(kH2);
+  for (std::uint32_t f = 0; f < kIn; ++f) requantizeFtRow(f);
+  requantizeDense();
+}
+
+void NnueTrainer::requantizeFtRow(std::uint32_t f) {
+  const std::size_t base = static_cast<std::size_t>(f) * kH1;
+  for (std::size_t j = 0; j < kH1; ++j) qFtW_[base + j] = quantize<std::int16_t>(ftW_[base + j], kAct);
+}
+
+void NnueTrainer::requantizeDense() {
+  for (std::size_t j = 0; j < kH1; ++j) qFtB_[j] = quantize<std::int32_t>(ftB_[j], kAct);
+  for (std::size_t i = 0; i < l2W_.size(); ++i) qL2W_[i] = quantize<std::int8_t>(l2W_[i], kL2WScale);
+  for (std::size_t k = 0; k < kH2; ++k) qL2B_[k] = quantize<std::int32_t>(l2B_[k], kAct * kL2WScale);
+  for (std::size_t k = 0; k < kH2; ++k) qOutW_[k] = quantize<std::int8_t>(outW_[k], kOutWScale);
+  qOutB_ = quantize<std::int32_t>(outB_, kOutputScale * static_cast<float>(1u << kShift3));
+}
+
+void NnueTrainer::forward(const PackedPosition& pp, Forward& f) const {
+  f.featCount = 0;
+  for (std::uint8_t s = 0; s < SQ_N; ++s) {
+    const std::uint32_t feat = NNUE::featureIndex(s, pp.rawAt(s));
+    if (feat != std::numeric_limits<std::uint32_t>::max()) f.feats[f.featCount++] = feat;
+  }
+  if (pp.turn() == Color::White) f.feats[f.featCount++] = NNUE::kFeatStmWhite;
+  if (pp.bastionRight(Color::White)) f.feats[f.featCount++] = NNUE::kFeatBastionWhite;
+  if (pp.bastionRight(Color::Black)) f.feats[f.featCount++] = NNUE::kFeatBastionBlack;
+
+  // Integer pipeline of NNUE::evaluateWhite.
+  std::array<std::int32_t, kH1> acc;
+  for (std::size_t j = 0; j < kH1; ++j) acc[j] = qFtB_[j];
+  for (std::size_t i = 0; i < f.featCount; ++i) {
+    const std::int16_t* w = &qFtW_[static_cast<std::size_t>(f.feats[i]) * kH1];
+    for (std::size_t j = 0; j < kH1; ++j) acc[j] += w[j];
+  }
+  for (std::size_t j = 0; j < kH1; ++j) {
+    f.h1[j] = static_cast<std::uint8_t>(std::clamp(acc[j], 0, static_cast<std::int32_t>(NNUE::kActMax)));
+    f.pass1[j] = acc[j] > 0 && acc[j] < static_cast<std::int32_t>(NNUE::kActMax);
+  }
+
+  std::int32_t out = qOutB_;
+  for (std::size_t k = 0; k < kH2; ++k) {
+    std::int32_t sum = qL2B_[k];
+    const std::int8_t* w = &qL2W_[k * kH1];
+    for (std::size_t j = 0; j < kH1; ++j) sum += static_cast<std::int32_t>(w[j]) * static_cast<std::int32_t>(f.h1[j]);
+    sum >>= kShift2; // arithmetic (floor), as NNUE::arshift
+    f.h2[k] = static_cast<std::uint8_t>(std::clamp(sum, 0, static_cast<std::int32_t>(NNUE::kActMax)));
+    f.pass2[k] = sum > 0 && sum < static_cast<std::int32_t>(NNUE::kActMax);
+    out += static_cast<std::int32_t>(qOutW_[k]) * static_cast<std::int32_t>(f.h2[k]);
+  }
+  f.cp = out >> kShift3;
+}
+
+int NnueTrainer::predictWhite(const PackedPosition& pp) const {
+  Forward f;
+  forward(pp, f);
+  return f.cp;
+}
+
+float NnueTrainer::target(const PackedPosition& pp) const {
+  const float evalWhite = static_cast<float>(pp.turn() == Color::White ? pp.eval : -pp.eval);
+  const float evalP = 1.0f / (1.0f + std::exp(-evalWhite / opt_.wdlScale));
+  if (pp.result == kResultUnknown) return evalP;
+  const float resultP = (static_cast<float>(pp.result) + 1.0f) * 0.5f;
+  return opt_.lambda * evalP + (1.0f - opt_.lambda) * resultP;
+}
+
+void NnueTrainer::accumulate(const PackedPosition* pp, std::size_t n, Grads& g) const {
+  Forward f;
+  std::array<float, kH2> d2;
+  std::array<float, kH1> d1;
+  for (std::size_t s = 0; s < n; ++s) {
+    forward(pp[s], f);
+    const float p = 1.0f / (1.0f + std::exp(-static_cast<float>(f.cp) / opt_.wdlScale));
+    const float diff = p - target(pp[s]);
+    g.loss += static_cast<double>(diff) * diff;
+
+    // Straight-through backward pass in float-network units (cp = kOutputScale * output).
+    const float gOut = 2.0f * diff * p * (1.0f - p) / opt_.wdlScale * kOutputScale;
+    g.outB += gOut;
+    for (std::size_t k = 0; k < kH2; ++k) {
+      g.outW[k] += gOut * static_cast<float>(f.h2[k]) / kAct;
+      d2[k] = f.pass2[k] ? gOut * outW_[k] : 0.0f;
+      g.l2B[k] += d2[k];
+    }
+
+    d1.fill(0.0f);
+    for (std::size_t k = 0; k < kH2; ++k) {
+      if (d2[k] == 0.0f) continue;
+      const float* w = &l2W_[k * kH1];
+      float* gw = &g.l2W[k * kH1];
+      for (std::size_t j = 0; j < kH1; ++j) {
+        gw[j] += d2[k] * static_cast<float>(f.h1[j]) / kAct;
+        d1[j] += d2[k] * w[j];
+      }
+    }
+    for (std::size_t j = 0; j < kH1; ++j) {
+      if (!f.pass1[j]) d1[j] = 0.0f;
+      g.ftB[j] += d1[j];
+    }
+
+    // Sparse: only the rows of the active features receive gradient.
+    for (std::size_t i = 0; i < f.featCount; ++i) {
+      const std::uint32_t feat = f.feats[i];
+      g.touched[feat] = 1;
+      float* gw = &g.ftW[static_cast<std::size_t>(feat) * kH1];
+      for (std::size_t j = 0; j < kH1; ++j) gw[j] += d1[j];
+    }
+  }
+}
+
+void NnueTrainer::adamUpdate(float* w, float* gsum, Adam& a, std::size_t offset, std::size_t n, float scale, float lo, float hi) {
+  const auto t = static_cast<double>(step_);
+  const float c1 = static_cast<float>(1.0 - std::pow(static_cast<double>(opt_.beta1), t));
+  const float c2 = static_cast<float>(1.0 - std::pow(static_cast<double>(opt_.beta2), t));
+  for (std::size_t i = offset; i < offset + n; ++i) {
+    const float g = gsum[i] * scale;
+    gsum[i] = 0.0f;
+    a.m[i] = opt_.beta1 * a.m[i] + (1.0f - opt_.beta1) * g;
+    a.v[i] = opt_.beta2 * a.v[i] + (1.0f - opt_.beta2) * g * g;
+    w[i] -= opt_.learningRate * (a.m[i] / c1) / (std::sqrt(a.v[i] / c2) + opt_.epsilon);
+    w[i] = std::clamp(w[i], lo, hi);
+  }
+}
+
+double NnueTrainer::trainBatch(const std::vector<PackedPosition>& batch) {
+  if (batch.empty()) return 0.0;
+  parallelFor(batch.size(), opt_.threads, [&](std::size_t w, std::size_t begin, std::size_t end) {
+    grads_[w].loss = 0.0;
+    accumulate(batch.data() + begin, end - begin, grads_[w]);
+  });
+
+  // Reduce into grads_[0].
+  Grads& g0 = grads_[0];
+  for (std::size_t w = 1; w < grads_.size(); ++w) {
+    Grads& g = grads_[w];
+    g0.loss += g.loss;
+    g0.outB += g.outB;
+    g.outB = 0.0f;
+    auto addInto = [](std::vector<float>& dst, std::vector<float>& src) {
+      for (std::size_t i = 0; i < dst.size(); ++i) {
+        dst[i] += src[i];
+        src[i] = 0.0f;
+      }
+    };
+    addInto(g0.ftB, g.ftB);
+    addInto(g0.l2W, g.l2W);
+    addInto(g0.l2B, g.l2B);
+    addInto(g0.outW, g.outW);
+  }
+
+  ++step_;
+  const float scale = 1.0f / static_cast<float>(batch.size());
+  constexpr float kFtLimit = 32767.0f / kAct;
+  constexpr float kNoLimit = std::numeric_limits<float>::max();
+  for (std::uint32_t f = 0; f < kIn; ++f) {
+    bool touched = false;
+    const std::size_t base = static_cast<std::size_t>(f) * kH1;
+    for (auto& g : grads_) {
+      if (!g.touched[f]) continue;
+      touched = true;
+      g.touched[f] = 0;
+      if (&g == &g0) continue;
+      for (std::size_t j = 0; j < kH1; ++j) {
+        g0.ftW[base + j] += g.ftW[base + j];
+        g.ftW[base + j] = 0.0f;
+      }
+    }
+    if (!touched) continue;
+    adamUpdate(ftW_.data(), g0.ftW.data(), ftWA_, base, kH1, scale, -kFtLimit, kFtLimit);
+    requantizeFtRow(f);
+  }
+  adamUpdate(ftB_.data(), g0.ftB.data(), ftBA_, 0, kH1, scale, -kNoLimit, kNoLimit);
+  adamUpdate(l2W_.data(), g0.l2W.data(), l2WA_, 0, l2W_.size(), scale, -128.0f / kL2WScale, 127.0f / kL2WScale);
+  adamUpdate(l2B_.data(), g0.l2B.data(), l2BA_, 0, kH2, scale, -kNoLimit, kNoLimit);
+  adamUpdate(outW_.data(), g0.outW.data(), outWA_, 0, kH2, scale, -128.0f / kOutWScale, 127.0f / kOutWScale);
+  adamUpdate(&outB_, &g0.outB, outBA_, 0, 1, scale, -kNoLimit, kNoLimit);
+
+  requantizeDense(); // the feature rows were requantized as they were updated
+
+  const double loss = g0.loss;
+  g0.loss = 0.0;
+  return loss / static_cast<double>(batch.size());
+}
+
+double NnueTrainer::loss(const std::vector<PackedPosition>& samples) const {
+  if (samples.empty()) return 0.0;
+  std::vector<double> sums(static_cast<std::size_t>(opt_.threads), 0.0);
+  parallelFor(samples.size(), opt_.threads, [&](std::size_t w, std::size_t begin, std::size_t end) {
+    Forward f;
+    for (std::size_t s = begin; s < end; ++s) {
+      forward(samples[s], f);
+      const float p = 1.0f / (1.0f + std::exp(-static_cast<float>(f.cp) / opt_.wdlScale));
+      const float diff = p - target(samples[s]);
+      sums[w] += static_cast<double>(diff) * diff;
+    }
+  });
+  double total = 0.0;
+  for (const double s : sums) total += s;
+  return total / static_cast<double>(samples.size());
+}
+
+void NnueTrainer::exportNet(const std::string& path) const {
+  // Written next to the target and renamed, so a crash never leaves a half-written net.
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("nnue export: failed to open " + tmp);
+    out.write("CNUE", 4);
+    for (const std::uint32_t v : {NNUE::kVersion, NNUE::kInputDim, NNUE::kHidden1, NNUE::kHidden2, NNUE::kActMax, kShift2, kShift3}) writeRaw(out, v);
+    out.write(reinterpret_cast<const char*>(qFtW_.data()), static_cast<std::streamsize>(qFtW_.size() * sizeof(std::int16_t)));
+    out.write(reinterpret_cast<const char*>(qFtB_.data()), static_cast<std::streamsize>(qFtB_.size() * sizeof(std::int32_t)));
+    out.write(reinterpret_cast<const char*>(qL2W_.data()), static_cast<std::streamsize>(qL2W_.size()));
+    out.write(reinterpret_cast<const char*>(qL2B_.data()), static_cast<std::streamsize>(qL2B_.size() * sizeof(std::int32_t)));
+    out.write(reinterpret_cast<const char*>(qOutW_.data()), static_cast<std::streamsize>(qOutW_.size()));
+    writeRaw(out, qOutB_);
+    if (!out.flush()) throw std::runtime_error("nnue export: write failed on " + tmp);
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) throw std::runtime_error("nnue export: cannot replace " + path + ": " + ec.message());
+}
+
+} // namespace citadel
@@ -0,0 +1,60 @@
+#include "citadel/paramfile.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace citadel {
+
+std::size_t findParam(std::string_view n, std::size_t count, const ParamName& name) {
+  auto equalNoCase = [](std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t k = 0; k < a.size(); ++k) {
+      if (std::tolower(static_cast<unsigned char>(a[k])) != std::tolower(static_cast<unsigned char>(b[k]))) return false;
+    }
+    return true;
+  };
+  for (std::size_t i = 0; i < count; ++i) {
+    if (equalNoCase(n, name(i))) return i;
+  }
+  return count;
+}
+
+void loadParamFile(const std::string& path, std::string_view what, std::span<int> values, const ParamName& name, const ParamRange& range) {
+  const std::string prefix = std::string(what) + ": ";
+  std::ifstream in(path);
+  if (!in) throw std::runtime_error(prefix + "failed to open " + path);
+
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(in, line)) {
+    ++lineNo;
+    const std::string where = " at line " + std::to_string(lineNo) + " of " + path;
+    std::istringstream iss(line);
+    std::string n;
+    if (!(iss >> n) || n.front() == '#') continue;
+    const std::size_t i = findParam(n, values.size(), name);
+    if (i == values.size()) throw std::runtime_error(prefix + "unknown parameter '" + n + "'" + where);
+    int v = 0;
+    std::string extra;
+    if (!(iss >> v) || (iss >> extra && extra.front() != '#')) throw std::runtime_error(prefix + "bad value" + where);
+    if (range) {
+      const auto [lo, hi] = range(i);
+      if (v < lo || v > hi) {
+        throw std::runtime_error(prefix + n + " out of range [" + std::to_string(lo) + ", " + std::to_string(hi) + "]" + where);
+      }
+    }
+    values[i] = v;
+  }
+}
+
+void saveParamFile(const std::string& path, std::string_view what, std::span<const int> values, const ParamName& name) {
+  const std::string prefix = std::string(what) + ": ";
+  std::ofstream out(path, std::ios::trunc);
+  if (!out) throw std::runtime_error(prefix + "failed to open " + path);
+  for (std::size_t i = 0; i < values.size(); ++i) out << name(i) << ' ' << values[i] << '\n';
+  if (!out.flush()) throw std::runtime_error(prefix + "write failed on " + path);
+}
+
+} // namespace citadel
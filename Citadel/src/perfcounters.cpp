@@ -0,0 +1,137 @@
+#include "citadel/perfcounters.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace citadel {
+
+namespace {
+
+#if defined(__linux__)
+struct EventSpec {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+constexpr std::uint64_t cacheConfig(std::uint64_t cache, std::uint64_t op, std::uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+constexpr EventSpec EVENT_SPECS[PerfCounters::EventCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static int openEvent(const EventSpec& spec) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = spec.type;
+  attr.config = spec.config;
+  attr.disabled = 1;
+  attr.inherit = 1; // bench worker threads are created after open()
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+} // namespace
+
+PerfCounters::~PerfCounters() {
+  close();
+}
+
+const char* PerfCounters::eventName(Event e) {
+  switch (e) {
+    case Cycles:
+      return "cycles";
+    case Instructions:
+      return "instructions";
+    case L1DMisses:
+      return "L1D misses";
+    case LLCMisses:
+      return "LLC misses";
+    case BranchMisses:
+      return "branch misses";
+    default:
+      return "?";
+  }
+}
+
+bool PerfCounters::open() {
+  close();
+  lastError_.clear();
+#if defined(__linux__)
+  bool any = false;
+  for (std::size_t i = 0; i < fd_.size(); ++i) {
+    fd_[i] = openEvent(EVENT_SPECS[i]);
+    if (fd_[i] >= 0) {
+      any = true;
+    } else if (lastError_.empty()) {
+      lastError_ = std::string("perf_event_open(") + eventName(static_cast<Event>(i)) + "): " + std::strerror(errno);
+    }
+  }
+  if (any) lastError_.clear();
+  return any;
+#else
+  lastError_ = "hardware counters are only supported on Linux";
+  return false;
+#endif
+}
+
+void PerfCounters::close() {
+#if defined(__linux__)
+  for (int& fd : fd_) {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+#endif
+}
+
+void PerfCounters::start() {
+#if defined(__linux__)
+  for (int fd : fd_) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+void PerfCounters::stop() {
+#if defined(__linux__)
+  for (int fd : fd_) {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+#endif
+}
+
+PerfCounters::Sample PerfCounters::read() const {
+  Sample s;
+#if defined(__linux__)
+  for (std::size_t i = 0; i < fd_.size(); ++i) {
+    if (fd_[i] < 0) continue;
+    std::uint64_t buf[3] = {0, 0, 0}; // value, time enabled, time running
+    if (::read(fd_[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) continue;
+    if (buf[2] == 0) continue; // never scheduled onto the PMU
+    s.value[i] = (buf[2] < buf[1]) ? static_cast<std::uint64_t>(static_cast<double>(buf[0]) * static_cast<double>(buf[1]) / static_cast<double>(buf[2]))
+                                   : buf[0];
+    s.valid[i] = true;
+  }
+#endif
+  return s;
+}
+
+} // namespace citadel
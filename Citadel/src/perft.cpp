@@ -1,16 +1,23 @@
 #include "citadel/perft.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 
 namespace citadel {
 
 std::uint64_t perft(Position& pos, int depth) {
   if (depth <= 0) return 1;
+  if (depth == 1) return pos.countMoves();
 
   MoveList moves;
   pos.generateMoves(moves);
   if (moves.empty()) return 0;
-  if (depth == 1) return moves.size;
 
   std::uint64_t nodes = 0;
   for (std::uint32_t i = 0; i < moves.size; ++i) {
@@ -22,6 +29,77 @@ std::uint64_t perft(Position& pos, int depth) {
   return nodes;
 }
 
+PerftHash::PerftHash(std::size_t mb) {
+  const std::size_t bytes = std::max<std::size_t>(mb, 1) * 1024 * 1024;
+  std::size_t buckets = 1;
+  while (buckets * 2 * kBucket * sizeof(Entry) <= bytes) buckets *= 2;
+  entries_ = std::vector<Entry>(buckets * kBucket);
+  mask_ = buckets - 1;
+}
+
+std::size_t PerftHash::bucketOf(std::uint64_t key, int depth) const {
+  // Mix the depth in so the same position at different depths lands in different buckets.
+  const std::uint64_t k = key ^ (static_cast<std::uint64_t>(depth) * std::uint64_t{0x9E3779B97F4A7C15});
+  return static_cast<std::size_t>(k & mask_) * kBucket;
+}
+
+bool PerftHash::probe(std::uint64_t key, int depth, std::uint64_t& nodes) const {
+  const std::size_t b = bucketOf(key, depth);
+  for (std::size_t i = 0; i < kBucket; ++i) {
+    const Entry& e = entries_[b + i];
+    const std::uint64_t data = e.data.load(std::memory_order_relaxed);
+    const std::uint64_t check = e.check.load(std::memory_order_relaxed);
+    // A torn write (check/data from different stores) fails this test and reads as a miss.
+    if ((check ^ data) == key && static_cast<int>(data & 0xFF) == depth) {
+      nodes = data >> 8;
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerftHash::store(std::uint64_t key, int depth, std::uint64_t nodes) {
+  if (depth <= 0 || depth > 0xFF || (nodes >> 56) != 0) return;
+  const std::uint64_t data = (nodes << 8) | static_cast<std::uint64_t>(depth);
+  const std::size_t b = bucketOf(key, depth);
+
+  // Slot 0 keeps the deepest subtree seen (most work saved), slot 1 takes everything else.
+  Entry& deep = entries_[b];
+  const int deepDepth = static_cast<int>(deep.data.load(std::memory_order_relaxed) & 0xFF);
+  Entry& e = (depth >= deepDepth) ? deep : entries_[b + 1];
+  e.check.store(key ^ data, std::memory_order_relaxed);
+  e.data.store(data, std::memory_order_relaxed);
+}
+
+void PerftHash::clear() {
+  for (Entry& e : entries_) {
+    e.check.store(0, std::memory_order_relaxed);
+    e.data.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::uint64_t perftHashed(Position& pos, int depth, PerftHash& hash) {
+  if (depth <= 0) return 1;
+  if (pos.gameOver()) return 0;
+
+  // Depth-1 counts are cheaper to recount than to look up.
+  if (depth == 1) return pos.countMoves();
+  std::uint64_t nodes = 0;
+  if (hash.probe(pos.hash(), depth, nodes)) return nodes;
+
+  MoveList moves;
+  pos.generateMoves(moves);
+
+  for (std::uint32_t i = 0; i < moves.size; ++i) {
+    Undo u;
+    pos.makeMove(moves.buf[i], u);
+    nodes += perftHashed(pos, depth - 1, hash);
+    pos.undoMove(u);
+  }
+  hash.store(pos.hash(), depth, nodes);
+  return nodes;
+}
+
 std::vector<std::pair<Move, std::uint64_t>> perftDivide(Position& pos, int depth) {
   std::vector<std::pair<Move, std::uint64_t>> out;
   if (depth <= 0) return out;
@@ -40,9 +118,96 @@ std::vector<std::pair<Move, std::uint64_t>> perftDivide(Position& pos, int depth
   return out;
 }
 
-PerftStats perftTimed(Position& pos, int depth) {
+namespace {
+
+// One unit of parallel work: the subtree below root move `root` (and reply `reply` if `split`).
+struct PerftTask {
+  std::uint32_t root = 0;
+  Move reply = nullMove();
+  bool split = false;
+};
+
+static std::uint64_t perftSubtree(Position& pos, int depth, PerftHash* hash) {
+  return hash ? perftHashed(pos, depth, *hash) : perft(pos, depth);
+}
+
+} // namespace
+
+std::vector<std::pair<Move, std::uint64_t>> perftDivideParallel(const Position& pos, int depth, int threads, PerftHash* hash) {
+  Position rootPos = pos;
+  if ((threads <= 1 && !hash) || depth <= 1) return perftDivide(rootPos, depth);
+  threads = std::max(threads, 1);
+
+  MoveList moves;
+  rootPos.generateMoves(moves);
+
+  // Narrow roots leave workers idle near the end; split one ply deeper for better balance.
+  const bool splitReplies = depth >= 3 && moves.size < 8u * static_cast<std::uint32_t>(threads);
+
+  std::vector<PerftTask> tasks;
+  for (std::uint32_t i = 0; i < moves.size; ++i) {
+    if (!splitReplies) {
+      tasks.push_back(PerftTask{i, nullMove(), false});
+      continue;
+    }
+    Undo u;
+    rootPos.makeMove(moves.buf[i], u);
+    MoveList replies;
+    rootPos.generateMoves(replies);
+    for (std::uint32_t j = 0; j < replies.size; ++j) tasks.push_back(PerftTask{i, replies.buf[j], true});
+    rootPos.undoMove(u);
+  }
+
+  std::vector<std::atomic<std::uint64_t>> counts(moves.size);
+  std::atomic<std::size_t> next{0};
+
+  auto worker = [&]() {
+    Position local = rootPos;
+    while (true) {
+      const std::size_t t = next.fetch_add(1, std::memory_order_relaxed);
+      if (t >= tasks.size()) break;
+      const PerftTask& task = tasks[t];
+
+      Undo u1;
+      local.makeMove(moves.buf[task.root], u1);
+      std::uint64_t n = 0;
+      if (task.split) {
+        Undo u2;
+        local.makeMove(task.reply, u2);
+        n = perftSubtree(local, depth - 2, hash);
+        local.undoMove(u2);
+      } else {
+        n = perftSubtree(local, depth - 1, hash);
+      }
+      local.undoMove(u1);
+      counts[task.root].fetch_add(n, std::memory_order_relaxed);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(static_cast<std::size_t>(threads));
+  for (int t = 0; t < threads; ++t) pool.emplace_back(worker);
+  for (auto& th : pool) th.join();
+
+  std::vector<std::pair<Move, std::uint64_t>> out;
+  out.reserve(moves.size);
+  for (std::uint32_t i = 0; i < moves.size; ++i) out.push_back({moves.buf[i], counts[i].load(std::memory_order_relaxed)});
+  return out;
+}
+
+std::uint64_t perftParallel(const Position& pos, int depth, int threads, PerftHash* hash) {
+  if (threads <= 1 || depth <= 1) {
+    Position p = pos;
+    return perftSubtree(p, depth, hash);
+  }
+  std::uint64_t nodes = 0;
+  for (const auto& [m, n] : perftDivideParallel(pos, depth, threads, hash)) nodes += n;
+  return nodes;
+}
+
+PerftStats perftTimed(Position& pos, int depth, int threads, PerftHash* hash) {
   const auto t0 = std::chrono::steady_clock::now();
-  const std::uint64_t nodes = perft(pos, depth);
+  const std::uint64_t nodes = (threads > 1 || hash) ? perftParallel(pos, depth, threads, hash) : perft(pos, depth);
   const auto t1 = std::chrono::steady_clock::now();
 
   const std::chrono::duration<double> dt = t1 - t0;
@@ -53,5 +218,54 @@ PerftStats perftTimed(Position& pos, int depth) {
   return st;
 }
 
-} // namespace citadel
+static std::string_view trimView(std::string_view sv) {
+  while (!sv.empty() && (sv.front() == ' ' || sv.front() == '\t' || sv.front() == '\r')) sv.remove_prefix(1);
+  while (!sv.empty() && (sv.back() == ' ' || sv.back() == '\t' || sv.back() == '\r')) sv.remove_suffix(1);
+  return sv;
+}
+
+std::vector<PerftSuiteEntry> loadPerftSuite(std::istream& in) {
+  std::vector<PerftSuiteEntry> out;
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(in, line)) {
+    ++lineNo;
+    std::string_view rest = trimView(line);
+    if (rest.empty() || rest.front() == '#') continue;
+
+    PerftSuiteEntry e;
+    const std::size_t semi = rest.find(';');
+    e.fen = std::string(trimView(rest.substr(0, semi)));
+    rest = (semi == std::string_view::npos) ? std::string_view{} : rest.substr(semi + 1);
+
+    while (!rest.empty()) {
+      const std::size_t next = rest.find(';');
+      const std::string_view field = trimView(rest.substr(0, next));
+      rest = (next == std::string_view::npos) ? std::string_view{} : rest.substr(next + 1);
+      if (field.empty()) continue;
 
+      std::istringstream iss{std::string(field)};
+      char tag = 0;
+      int depth = 0;
+      std::uint64_t nodes = 0;
+      if (!(iss >> tag >> depth >> nodes) || (tag != 'D' && tag != 'd') || depth < 1 || depth > 64) {
+        throw std::runtime_error("perft suite line " + std::to_string(lineNo) + ": bad field '" + std::string(field) + "'");
+      }
+      if (e.expected.size() < static_cast<std::size_t>(depth)) e.expected.resize(static_cast<std::size_t>(depth), 0);
+      e.expected[static_cast<std::size_t>(depth - 1)] = nodes;
+    }
+    out.push_back(std::move(e));
+  }
+  return out;
+}
+
+std::string formatPerftSuiteLine(const PerftSuiteEntry& e) {
+  std::string s = e.fen;
+  for (std::size_t d = 0; d < e.expected.size(); ++d) {
+    if (e.expected[d] == 0) continue;
+    s += " ;D" + std::to_string(d + 1) + " " + std::to_string(e.expected[d]);
+  }
+  return s;
+}
+
+} // namespace citadel
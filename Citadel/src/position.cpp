@@ -1,5 +1,6 @@
 #include "citadel/position.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <sstream>
@@ -816,6 +817,181 @@ void Position::generateMoves(MoveList& out) {
   }
 }
 
+// ------------------------------------------------------------
+// Move counting (mirrors generateMoves; keep the two in sync)
+// ------------------------------------------------------------
+
+std::uint32_t Position::countSliderMoves(std::uint8_t fromSq, std::uint8_t dirBegin, std::uint8_t dirEnd, int maxSteps, Color us) const {
+  const auto& T = tables();
+  const Color them = other(us);
+  const bool lancer = pieceOf(at(fromSq)) == PieceType::Lancer;
+  std::uint32_t n = 0;
+  for (std::uint8_t dir = dirBegin; dir < dirEnd; ++dir) {
+    const int len = std::min(maxSteps, static_cast<int>(T.rayLen[fromSq][dir]));
+    for (int step = 0; step < len; ++step) {
+      const std::int8_t v = at(T.ray[fromSq][dir][static_cast<std::uint8_t>(step)]);
+      if (isWallVal(v)) break;
+      if (isPieceVal(v)) {
+        if (lancer && colorOf(v) == us && pieceOf(v) == PieceType::Mason) continue; // pass through
+        if (colorOf(v) == them) ++n;
+        break;
+      }
+      ++n;
+    }
+  }
+  return n;
+}
+
+std::uint32_t Position::countMasonMoves(std::uint8_t masonSq, Color us, const Bitboard81& enemyAttacks, const Bitboard81& empty) {
+  const auto& T = tables();
+  const Color them = other(us);
+  const int r = row(masonSq);
+  const int c = col(masonSq);
+  const int f = (us == Color::White) ? -1 : 1;
+  const bool canBuild = !wallBuiltLast(us);
+  const Coord ortho[3] = {{f, 0}, {0, -1}, {0, 1}};
+
+  std::uint32_t n = 0;
+
+  // Normal moves: orthogonal slides onto empties, diagonal captures.
+  const int max = masonMoveRange(masonSq, us);
+  for (const auto& d : ortho) {
+    for (int step = 1; step <= max; ++step) {
+      const int rr = r + d.r * step;
+      const int cc = c + d.c * step;
+      if (!inBounds(rr, cc) || at(sq(rr, cc)) != 0) break;
+      ++n;
+    }
+  }
+  std::array<std::uint8_t, 2> captures{};
+  std::uint8_t captureCount = 0;
+  for (const int dc : {-1, 1}) {
+    if (!inBounds(r + f, c + dc)) continue;
+    const std::uint8_t tsq = sq(r + f, c + dc);
+    const std::int8_t v = at(tsq);
+    if (isPieceVal(v) && colorOf(v) == them) captures[captureCount++] = tsq;
+  }
+  n += captureCount;
+
+  // Construct.
+  if (canBuild && !enemyAttacks.test(masonSq)) n += (T.orthoMask[masonSq] & empty).popcount();
+
+  // Command: requires adjacent friendly minister.
+  if ((T.kingMask[masonSq] & pieceBB_[static_cast<int>(us)][static_cast<int>(PieceType::Minister)]).empty()) return n;
+
+  Bitboard81 emptyAfter = empty;
+  emptyAfter.set(masonSq);
+
+  auto countCommandDest = [&](std::uint8_t destSq) -> std::uint32_t {
+    const std::int8_t dstV = at(destSq);
+    if (isPieceVal(dstV) && colorOf(dstV) == them && pieceOf(dstV) == PieceType::Sovereign) return 1;
+    if (!canBuild) return 1;
+
+    // The build needs the destination unattacked after the step; probe it on the board.
+    const std::int8_t fromV = at(masonSq);
+    setSquareRaw(destSq, fromV);
+    setSquareRaw(masonSq, 0);
+    const bool attacked = isSquareAttackedBy(them, destSq);
+    setSquareRaw(masonSq, fromV);
+    setSquareRaw(destSq, dstV);
+
+    return 1 + (attacked ? 0u : (T.orthoMask[destSq] & emptyAfter).popcount());
+  };
+
+  for (const auto& d : ortho) {
+    if (!inBounds(r + d.r, c + d.c)) continue;
+    const std::uint8_t tsq = sq(r + d.r, c + d.c);
+    if (at(tsq) == 0) n += countCommandDest(tsq);
+  }
+  for (std::uint8_t i = 0; i < captureCount; ++i) n += countCommandDest(captures[i]);
+  return n;
+}
+
+std::uint32_t Position::countCatapultMoves(std::uint8_t catSq, Color us, const Bitboard81& walls) const {
+  const auto& T = tables();
+  std::uint32_t n = 0;
+  for (std::uint8_t dir = 0; dir < 4; ++dir) {
+    const std::uint8_t len = T.rayLen[catSq][dir];
+    for (std::uint8_t step = 0; step < len; ++step) {
+      const std::uint8_t toSq = T.ray[catSq][dir][step];
+      const std::int8_t v = at(toSq);
+      if (isWallVal(v)) {
+        ++n; // ranged demolish of the first wall (only reached if no piece blocks)
+        break;
+      }
+      if (isPieceVal(v)) {
+        if (colorOf(v) != us) {
+          // Capture, optionally demolishing an adjacent wall (not after taking the sovereign).
+          n += 1 + ((pieceOf(v) == PieceType::Sovereign) ? 0u : (T.kingMask[toSq] & walls).popcount());
+        }
+        break;
+      }
+      // Move to an empty square, plus one variant per adjacent wall to demolish.
+      n += 1 + (T.kingMask[toSq] & walls).popcount();
+    }
+  }
+  return n;
+}
+
+std::uint32_t Position::countBastion(std::uint8_t sovSq, Color us, const Bitboard81& empty) const {
+  if (wallBuiltLast(us) || !bastionRight(us) || wallTokens(us) > 15) return 0;
+
+  const auto& T = tables();
+  std::uint32_t n = 0;
+  Bitboard81 ministers = T.kingMask[sovSq] & pieceBB_[static_cast<int>(us)][static_cast<int>(PieceType::Minister)];
+  while (ministers.any()) {
+    const std::uint8_t ministerSq = ministers.pop_lsb();
+    // The old sovereign square is occupied (by the minister after the swap), never in `empty`.
+    const std::uint32_t e = (T.kingMask[ministerSq] & empty).popcount();
+    if (e >= 2) n += e * (e - 1) / 2;
+  }
+  return n;
+}
+
+std::uint32_t Position::countMoves() {
+  if (gameOver()) return 0;
+  return countMoves(turn_);
+}
+
+std::uint32_t Position::countMoves(Color us) {
+  const auto& T = tables();
+  const std::size_t u = static_cast<std::size_t>(us);
+  const Bitboard81 enemyAttacks = computeAttacks(other(us));
+  const Bitboard81 walls = wallsBB_[0] | wallsBB_[1];
+  const Bitboard81 occupied = piecesBB_[0] | piecesBB_[1] | walls;
+  const Bitboard81 empty = Bitboard81{~0ULL, (1ULL << (SQ_N - 64)) - 1} ^ occupied;
+  const Bitboard81 pegasusTargets = Bitboard81{~0ULL, (1ULL << (SQ_N - 64)) - 1} ^ (walls | piecesBB_[u]);
+
+  std::uint32_t n = 0;
+
+  Bitboard81 bb = pieceBB_[u][static_cast<std::size_t>(PieceType::Mason)];
+  while (bb.any()) n += countMasonMoves(bb.pop_lsb(), us, enemyAttacks, empty);
+
+  bb = pieceBB_[u][static_cast<std::size_t>(PieceType::Pegasus)];
+  while (bb.any()) n += (T.knightMask[bb.pop_lsb()] & pegasusTargets).popcount();
+
+  bb = pieceBB_[u][static_cast<std::size_t>(PieceType::Lancer)];
+  while (bb.any()) n += countSliderMoves(bb.pop_lsb(), 4, 8, 8, us);
+
+  bb = pieceBB_[u][static_cast<std::size_t>(PieceType::Catapult)];
+  while (bb.any()) n += countCatapultMoves(bb.pop_lsb(), us, walls);
+
+  bb = pieceBB_[u][static_cast<std::size_t>(PieceType::Minister)];
+  while (bb.any()) {
+    const std::uint8_t s = bb.pop_lsb();
+    n += countSliderMoves(s, 0, 8, ministerMoveRange(s, us), us);
+  }
+
+  bb = pieceBB_[u][static_cast<std::size_t>(PieceType::Sovereign)];
+  while (bb.any()) {
+    const std::uint8_t s = bb.pop_lsb();
+    const int max = sovereignMoveRange(s, us);
+    if (max > 0) n += countSliderMoves(s, 0, 8, max, us);
+    n += countBastion(s, us, empty);
+  }
+  return n;
+}
+
 void Position::makeMove(const Move& m, Undo& u) {
   history_.push_back(hash_);
 
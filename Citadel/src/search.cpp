@@ -7,11 +7,27 @@
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "citadel/hce.hpp"
 #include "citadel/nnue.hpp"
+#include "citadel/searchparams.hpp"
 #include "citadel/tables.hpp"
+#include "citadel/timeman.hpp"
+#include "citadel/trace.hpp"
+
+// Counter increments for CITADEL_STATS builds; compiled out otherwise.
+#ifdef CITADEL_STATS
+#define SEARCH_STAT(ctx, expr) ((ctx).stats.expr)
+#else
+#define SEARCH_STAT(ctx, expr) ((void)0)
+#endif
 
 namespace citadel {
 
@@ -41,389 +57,10 @@ static constexpr int MAX_PLY = 256;
 static constexpr int QS_MAX_DEPTH = 4; // cap quiescence extensions to keep it fast
 
 // Order matches Position encoding: 0..5 = Mason, Catapult, Lancer, Pegasus, Minister, Sovereign
-static constexpr std::array<int, 6> PIECE_VALUE_MAT = {100, 550, 350, 400, 450, 0};      // Sovereign is priceless; treat as 0 in static material.
 static constexpr std::array<int, 6> PIECE_VALUE_ORDER = {100, 550, 350, 400, 450, 100000}; // For move ordering (captures), sovereign capture must dominate.
 
-static constexpr int DOMINANCE_BONUS = 25;             // lower than before; PST handles "gravity" toward the Keep.
-static constexpr int WALL_BASE_VALUE_PER_HP = 2;       // keep minimal to avoid valuing useless corner walls.
-static constexpr int WALL_ADJ_SOV_BONUS = 15;          // walls adjacent to own sovereign are valuable protection.
-static constexpr int WALL_CHOKE_BONUS = 6;             // walls on the Keep boundary ring can be useful, but don't overvalue early.
-static constexpr int MASON_MINISTER_SYNERGY = 20;      // mason gets much stronger if it can Command.
-static constexpr int ENTOMB_PRESSURE_WEIGHT = 18;      // retained from prior eval (still important tactically).
-static constexpr int SIEGE_ATTRITION_PENALTY = 200;     // immobilized sovereign penalty.
-
-// Endgame / wall heuristics
-static constexpr int WALLS_MANY_START = 12;             // total wall HP where games start to "lock"
-static constexpr int WALLS_MANY_FULL = 25;              // total wall HP considered very locked
-static constexpr int NO_CAT_DRAWISH_SCALE_MAX = 256;    // max % shrink (in /256) when no catapults and walls are high
-static constexpr int CATAPULT_EDGE_BONUS_MAX = 150;     // bonus for having catapult edge in locked endgames
-
-// Opening/midgame heuristics: discourage early sovereign adventures and wall spam.
-static constexpr int MAX_NON_SOV_PIECES = 34;           // initial position: 17 non-sovereign pieces per side
-static constexpr int BASTION_RIGHT_OPENING_BONUS = 80;  // keeping Bastion available early is valuable
-static constexpr int KING_WANDER_PEN = 45;              // per square away from start, scaled by opening
-static constexpr int KING_KEEP_EARLY_PEN = 140;         // sovereign in Keep too early is dangerous
-static constexpr int KING_ATTACKED_PEN = 700;           // enemy attacks sovereign square (immediate regicide threat)
-static constexpr int KING_RING_ATTACK_PEN = 55;         // per adjacent square attacked around sovereign
-static constexpr int WALL_TOKEN_OPENING_PEN_PER_HP = 3; // discourage over-building walls early
-static constexpr int MOBILITY_ATK_WEIGHT = 2;           // activity: reward attacked squares (proxy for mobility/development)
-
-static constexpr int pstCentrality(int r, int c) {
-  // Chebyshev distance from center (4,4) on a 9x9 board: 0..4
-  const int dr = (r >= 4) ? (r - 4) : (4 - r);
-  const int dc = (c >= 4) ? (c - 4) : (4 - c);
-  const int cheb = (dr > dc) ? dr : dc;
-  return 4 - cheb; // 4 at center, 0 on edge
-}
-
-static std::array<std::array<int, SQ_N>, static_cast<int>(PieceType::Count)> buildPST() {
-  std::array<std::array<int, SQ_N>, static_cast<int>(PieceType::Count)> pst{};
-
-  for (std::uint8_t s = 0; s < SQ_N; ++s) {
-    const int r = row(s);
-    const int c = col(s);
-    const int cent = pstCentrality(r, c); // 0..4
-    const bool keep = isKeep(r, c);
-    const int keepBonus = keep ? 1 : 0;
-
-    pst[static_cast<std::size_t>(PieceType::Mason)][s] = (cent * 4) + (keepBonus * 6);
-    pst[static_cast<std::size_t>(PieceType::Catapult)][s] = (cent * 3) + (keepBonus * 4);
-    pst[static_cast<std::size_t>(PieceType::Lancer)][s] = (cent * 4) + (keepBonus * 6);
-    pst[static_cast<std::size_t>(PieceType::Pegasus)][s] = (cent * 4) + (keepBonus * 6);
-    pst[static_cast<std::size_t>(PieceType::Minister)][s] = (cent * 5) + (keepBonus * 8);
-
-    // Sovereign PST is intentionally much larger to create strong "gravity" toward the Keep.
-    pst[static_cast<std::size_t>(PieceType::Sovereign)][s] = (cent * 20) + (keepBonus * 40);
-  }
-
-  return pst;
-}
-
-static const std::array<std::array<int, SQ_N>, static_cast<int>(PieceType::Count)>& PST() {
-  static const auto pst = buildPST();
-  return pst;
-}
-
-static constexpr bool isKeepBoundaryRing(int r, int c) {
-  // A 5x5 "ring" around the Keep (Keep is 3..5). This corresponds to r/c in [2..6]
-  // and on the boundary of that box. These squares are typical entry chokepoints.
-  if (r < 2 || r > 6 || c < 2 || c > 6) return false;
-  if (isKeep(r, c)) return false;
-  return (r == 2 || r == 6 || c == 2 || c == 6);
-}
-
-static int evalStatic(const Position& pos) {
-  // Positive = good for White.
-  int scoreW = 0;
-  int scoreB = 0;
-
-  const auto& T = tables();
-
-  // Game phase: 0 = opening, 256 = endgame (fewer pieces).
-  int nonSovPieces = 0;
-  for (std::uint8_t s = 0; s < SQ_N; ++s) {
-    const std::int8_t v = pos.rawAt(s);
-    if (v == 0) continue;
-    const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
-    if (av >= 1 && av <= 6) {
-      const int ptIdx = av - 1;
-      if (ptIdx != static_cast<int>(PieceType::Sovereign)) ++nonSovPieces;
-    }
-  }
-  int missing = MAX_NON_SOV_PIECES - nonSovPieces;
-  if (missing < 0) missing = 0;
-  const int phase = (missing * 256 + (MAX_NON_SOV_PIECES / 2)) / MAX_NON_SOV_PIECES; // 0..256
-  const int opening = 256 - phase;
-
-  const int wallsW = pos.wallTokens(Color::White);
-  const int wallsB = pos.wallTokens(Color::Black);
-  const int totalWalls = wallsW + wallsB;
-
-  auto clamp256 = [](int x) -> int { return (x < 0) ? 0 : (x > 256) ? 256 : x; };
-  const int wallMany = clamp256(((totalWalls - WALLS_MANY_START) * 256) / (WALLS_MANY_FULL - WALLS_MANY_START));
-  const int wallEndgame = (wallMany * phase) / 256; // 0..256
-
-  // 1. Calculate Sovereign Safety (Denominators for Proximity Heuristic)
-  auto calculateSafety = [&](Color c) -> int {
-    const std::uint8_t ks = pos.sovereignSq(c);
-    if (ks == SQ_NONE) return 100; // King dead or missing? Treat as infinite safety to avoid div/0 errors, though game should be over.
-    
-    int safety = 1; // Base safety
-    int wallSafetyCount = 0;
-    
-    for (std::uint8_t i = 0; i < T.kingCount[ks]; ++i) {
-      const std::uint8_t adj = T.kingTargets[ks][i];
-      const std::int8_t v = pos.rawAt(adj);
-      if (v == 0) continue;
-      
-      // Friendly Piece: +2 safety (blocker + potential helper)
-      if (isPieceVal(v) && colorOf(v) == c) {
-        safety += 2;
-      }
-      // Friendly Wall: +1 safety (blocker), cap wall contribution at 3.
-      // (Too many walls = entombment risk, not safety).
-      else if (isWallVal(v) && colorOf(v) == c) {
-        if (wallSafetyCount < 3) {
-          safety += 1;
-          wallSafetyCount++;
-        }
-      }
-    }
-    return safety;
-  };
-
-  const int safetyW = calculateSafety(Color::White);
-  const int safetyB = calculateSafety(Color::Black);
-  int pressureOnW = 0;
-  int pressureOnB = 0;
-
-  const std::uint8_t sovSqW = pos.sovereignSq(Color::White);
-  const std::uint8_t sovSqB = pos.sovereignSq(Color::Black);
-
-  auto dynPieceValue = [&](PieceType pt) -> int {
-    const int idx = static_cast<int>(pt);
-    const int base = PIECE_VALUE_MAT[static_cast<std::size_t>(idx)];
-    int target = base;
-    if (pt == PieceType::Mason) target = 225;
-    if (pt == PieceType::Pegasus) target = 500;
-    if (pt == PieceType::Catapult) target = 600;
-    return base + ((target - base) * wallEndgame) / 256;
-  };
-
-  // Main Board Loop
-  for (std::uint8_t s = 0; s < SQ_N; ++s) {
-    const std::int8_t v = pos.rawAt(s);
-    if (v == 0) continue;
-
-    const bool isWhite = v > 0;
-    const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
-    int& score = isWhite ? scoreW : scoreB;
-
-    if (av >= 1 && av <= 6) {
-      // It is a Piece
-      const int ptIdx = av - 1;
-      const PieceType pt = static_cast<PieceType>(ptIdx);
-
-      // A. Material & PST
-      score += dynPieceValue(pt);
-      if (pt == PieceType::Sovereign) {
-        score += (PST()[static_cast<std::size_t>(pt)][s] * phase) / 256;
-      } else {
-        score += PST()[static_cast<std::size_t>(pt)][s];
-      }
-
-      // B. Sovereign Proximity / Vulnerability Heuristic
-      // If this piece is attacking the enemy sovereign, calculate pressure.
-      const std::uint8_t targetSov = isWhite ? sovSqB : sovSqW;
-      if (targetSov != SQ_NONE) {
-        const int r = row(s), c = col(s);
-        const int tr = row(targetSov), tc = col(targetSov);
-        const int dr = (r > tr) ? (r - tr) : (tr - r);
-        const int dc = (c > tc) ? (c - tc) : (tc - c);
-        const int dist = (dr > dc) ? dr : dc; // Chebyshev distance
-
-        if (dist <= 4) {
-          int baseWeight = 0;
-          switch (pt) {
-            case PieceType::Mason:    baseWeight = 10; break;
-            case PieceType::Pegasus:  baseWeight = 10; break;
-            case PieceType::Catapult: baseWeight = 6;  break;
-            case PieceType::Lancer:   baseWeight = 6;  break;
-            case PieceType::Minister: baseWeight = 3;  break;
-            default: break;
-          }
-          // Formula: Weight * (5 - Distance)
-          // Dist 1: Weight*4. Dist 4: Weight*1.
-          const int pVal = baseWeight * (5 - dist);
-          if (isWhite) pressureOnB += pVal; else pressureOnW += pVal;
-        }
-      }
-
-      // C. Minister-Mason synergy
-      if (pt == PieceType::Mason) {
-        for (std::uint8_t i = 0; i < T.kingCount[s]; ++i) {
-          const std::uint8_t adj = T.kingTargets[s][i];
-          const std::int8_t v2 = pos.rawAt(adj);
-          if (v2 == 0) continue;
-          const int av2 = (v2 < 0) ? -static_cast<int>(v2) : static_cast<int>(v2);
-          if (av2 != (1 + static_cast<int>(PieceType::Minister))) continue;
-          if ((v2 > 0) == isWhite) {
-            score += MASON_MINISTER_SYNERGY;
-            break;
-          }
-        }
-      }
-    } else {
-      // It is a Wall
-      const int hp = av - 6;
-      score += WALL_BASE_VALUE_PER_HP * hp;
-
-      const int r = row(s);
-      const int c = col(s);
-      if (isKeepBoundaryRing(r, c)) score += (WALL_CHOKE_BONUS * phase) / 256;
-    }
-  }
-
-  // Apply Proximity Scores (Pressure / Safety)
-  // We apply this to the attacker's score.
-  scoreW += (pressureOnB * 4) / safetyB; // *4 is a scaling factor to bring it to CP range (safety usually 1..5)
-  scoreB += (pressureOnW * 4) / safetyW;
-
-  // Global Heuristics
-  if (pos.hasDominance(Color::White)) scoreW += (DOMINANCE_BONUS * phase) / 256;
-  if (pos.hasDominance(Color::Black)) scoreB += (DOMINANCE_BONUS * phase) / 256;
-
-  if (pos.bastionRight(Color::White)) scoreW += (BASTION_RIGHT_OPENING_BONUS * opening) / 256;
-  if (pos.bastionRight(Color::Black)) scoreB += (BASTION_RIGHT_OPENING_BONUS * opening) / 256;
-
-  // Helper for wall adjacency bonus
-  auto addAdjWallBonus = [&](Color c, int& sc) {
-    const std::uint8_t ks = pos.sovereignSq(c);
-    if (ks == SQ_NONE) return;
-    for (std::uint8_t i = 0; i < T.kingCount[ks]; ++i) {
-      const std::uint8_t adj = T.kingTargets[ks][i];
-      const std::int8_t v = pos.rawAt(adj);
-      if (v == 0) continue;
-      const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
-      if (av < 7) continue;
-      const bool wallIsWhite = v > 0;
-      if ((c == Color::White) == wallIsWhite) sc += WALL_ADJ_SOV_BONUS;
-    }
-  };
-  addAdjWallBonus(Color::White, scoreW);
-  addAdjWallBonus(Color::Black, scoreB);
-
-  // Penalties
-  if (pos.wallTokens(Color::White) > 15) scoreW -= SIEGE_ATTRITION_PENALTY;
-  if (pos.wallTokens(Color::Black) > 15) scoreB -= SIEGE_ATTRITION_PENALTY;
-
-  scoreW -= (pos.wallTokens(Color::White) * WALL_TOKEN_OPENING_PEN_PER_HP * opening) / 256;
-  scoreB -= (pos.wallTokens(Color::Black) * WALL_TOKEN_OPENING_PEN_PER_HP * opening) / 256;
-
-  // Mobility
-  const Bitboard81 attW = pos.computeAttacks(Color::White);
-  const Bitboard81 attB = pos.computeAttacks(Color::Black);
-  const int mobW = static_cast<int>(attW.popcount());
-  const int mobB = static_cast<int>(attB.popcount());
-  scoreW += MOBILITY_ATK_WEIGHT * mobW;
-  scoreB += MOBILITY_ATK_WEIGHT * mobB;
-
-  // King Safety (Penalty-based)
-  auto kingSafetyPen = [&](Color c, const Bitboard81& enemyAttacks) -> int {
-    const std::uint8_t ks = pos.sovereignSq(c);
-    if (ks == SQ_NONE) return 0;
-    int pen = 0;
-    const std::uint8_t home = (c == Color::White) ? sq(8, 4) : sq(0, 4);
-    const int dr = std::abs(row(ks) - row(home));
-    const int dc = std::abs(col(ks) - col(home));
-    const int cheb = (dr > dc) ? dr : dc;
-    pen += (KING_WANDER_PEN * cheb * opening) / 256;
-    if (isKeepSq(ks)) pen += (KING_KEEP_EARLY_PEN * opening) / 256;
-    if (enemyAttacks.test(ks)) pen += KING_ATTACKED_PEN;
-    int ringAtt = 0;
-    const int r0 = row(ks);
-    const int c0 = col(ks);
-    for (const auto& d : DIRS8) {
-      const int rr = r0 + d.r;
-      const int cc = c0 + d.c;
-      if (!inBounds(rr, cc)) continue;
-      const std::uint8_t adj = sq(rr, cc);
-      if (enemyAttacks.test(adj)) ++ringAtt;
-    }
-    pen += KING_RING_ATTACK_PEN * ringAtt;
-    return pen;
-  };
-  scoreW -= kingSafetyPen(Color::White, attB);
-  scoreB -= kingSafetyPen(Color::Black, attW);
-
-  // Entombment Pressure
-  auto entombPressure = [&](Color attacker) -> int {
-    const Color victim = other(attacker);
-    const std::uint8_t vk = pos.sovereignSq(victim);
-    if (vk == SQ_NONE) return 0;
-    int blocked = 0;
-    const int r0 = row(vk);
-    const int c0 = col(vk);
-    for (const auto& d : DIRS8) {
-      const int rr = r0 + d.r;
-      const int cc = c0 + d.c;
-      if (!inBounds(rr, cc)) { ++blocked; continue; }
-      const std::uint8_t adj = sq(rr, cc);
-      const std::int8_t v = pos.rawAt(adj);
-      const int av = (v < 0) ? -static_cast<int>(v) : static_cast<int>(v);
-      if (av >= 7) ++blocked;
-    }
-    return blocked;
-  };
-  scoreW += ENTOMB_PRESSURE_WEIGHT * entombPressure(Color::White);
-  scoreB += ENTOMB_PRESSURE_WEIGHT * entombPressure(Color::Black);
-
-  // ----------------------------------------------------------------------------
-  // Tempo
-  // ----------------------------------------------------------------------------
-  // We apply Tempo here so that it gets scaled down if the position is deemed
-  // drawish/locked later. This prevents score oscillation (+20/-20) in dead draws
-  // while preserving initiative scores in open positions.
-  constexpr int TEMPO_BONUS = 20;
-  if (pos.turn() == Color::White) scoreW += TEMPO_BONUS;
-  else scoreB += TEMPO_BONUS;
-
-  int diff = scoreW - scoreB;
-
-  // ----------------------------------------------------------------------------
-  // Catapult / Wall Endgame & Draw Heuristics
-  // ----------------------------------------------------------------------------
-  const int catW = static_cast<int>(pos.pieceCount(Color::White, PieceType::Catapult));
-  const int catB = static_cast<int>(pos.pieceCount(Color::Black, PieceType::Catapult));
-  
-  // Constant for Catapult Monopoly (one side has it, other doesn't)
-  constexpr int CATAPULT_MONOPOLY_BONUS = 200;
-
-  if (catW == 0 && catB == 0) {
-    // 1. Both sides have NO Catapults. Walls are permanent.
-    const int mobTotal = mobW + mobB;
-    int drawish = clamp256(((60 - mobTotal) * 256) / 40);
-
-    const int masons = static_cast<int>(pos.pieceCount(Color::White, PieceType::Mason) + 
-                                        pos.pieceCount(Color::Black, PieceType::Mason));
-    if (masons > 0) {
-      // Masons present + No Catapults = Infinite Wall potential => High Draw Probability.
-      // Apply strict score dampening.
-      int masonFactor = 200; // ~78% score reduction
-      if (totalWalls >= 4) masonFactor = 245; // ~95% score reduction
-      drawish = std::max(drawish, masonFactor);
-    } else {
-      // No Masons, No Catapults. Static board.
-      // If walls are high, it's likely drawn/locked.
-      int staticWallFactor = (totalWalls * 20); 
-      if (staticWallFactor > 256) staticWallFactor = 256;
-      drawish = std::max(drawish, staticWallFactor);
-    }
-
-    const int scale = 256 - (drawish * NO_CAT_DRAWISH_SCALE_MAX) / 256;
-    diff = (diff * scale) / 256;
-
-  } else {
-    // 2. At least one side has a Catapult.
-    
-    // Check for "Monopoly": One side has catapults, the other has NONE.
-    // This is a massive strategic advantage (conversion potential) regardless of phase.
-    if (catW > 0 && catB == 0) diff += CATAPULT_MONOPOLY_BONUS;
-    else if (catB > 0 && catW == 0) diff -= CATAPULT_MONOPOLY_BONUS;
-
-    // Small edge bonus for having *more* catapults in endgame (e.g. 2 vs 1)
-    if (catW != catB) {
-      const int edge = (catW > catB) ? 1 : -1;
-      const int bonus = (CATAPULT_EDGE_BONUS_MAX * wallEndgame) / 256;
-      diff += edge * bonus;
-    }
-  }
-
-  return diff;
-}
-
 static inline int hceEvalStm(const Position& pos) {
-  const int diff = evalStatic(pos);
+  const int diff = evaluateHce(pos);
   return (pos.turn() == Color::White) ? diff : -diff;
 }
 
@@ -589,11 +226,13 @@ static void ensureTT() {
 }
 
 void clearTranspositionTable() {
+  TraceScope trace("clearTT", "tt", "mb", static_cast<std::int64_t>(TT_MB));
   ensureTT();
   for (auto& e : TT) e = TTEntry{};
 }
 
 void setTranspositionTableSizeMB(std::size_t mb) {
+  TraceScope trace("allocTT", "tt", "mb", static_cast<std::int64_t>(mb));
   allocTTMB(mb);
 }
 
@@ -623,6 +262,40 @@ static inline TTEntry& ttSlot(std::uint64_t key) {
   return TT[static_cast<std::size_t>(key) & TT_MASK];
 }
 
+// --------------------------------------------------------------------------------------
+// Static evaluation cache
+// --------------------------------------------------------------------------------------
+
+// Small, fixed-size, always-replace cache of static evaluations (side-to-move perspective).
+// Each slot is a single 64-bit word: the high 32 bits hold a key check, the low 32 bits the score.
+// Whole-word relaxed loads/stores cannot tear, so the table is shared lock-free by all search
+// threads; a lost race only costs a re-evaluation.
+static constexpr std::size_t EVAL_CACHE_ENTRIES = std::size_t{1} << 17; // 1 MB
+static constexpr std::uint64_t EVAL_CACHE_NNUE_SALT = 0x6A09E667F3BCC909ULL;
+
+static std::array<std::atomic<std::uint64_t>, EVAL_CACHE_ENTRIES> EVAL_CACHE{};
+
+static inline std::uint32_t evalCacheCheck(std::uint64_t key) {
+  // Never 0, so an empty slot can't match.
+  return static_cast<std::uint32_t>(key >> 32) | 1u;
+}
+
+static inline bool evalCacheProbe(std::uint64_t key, int& score) {
+  const std::uint64_t w = EVAL_CACHE[static_cast<std::size_t>(key) & (EVAL_CACHE_ENTRIES - 1)].load(std::memory_order_relaxed);
+  if (static_cast<std::uint32_t>(w >> 32) != evalCacheCheck(key)) return false;
+  score = static_cast<int>(static_cast<std::int32_t>(static_cast<std::uint32_t>(w)));
+  return true;
+}
+
+static inline void evalCacheStore(std::uint64_t key, int score) {
+  const std::uint64_t w = (static_cast<std::uint64_t>(evalCacheCheck(key)) << 32) | static_cast<std::uint32_t>(static_cast<std::int32_t>(score));
+  EVAL_CACHE[static_cast<std::size_t>(key) & (EVAL_CACHE_ENTRIES - 1)].store(w, std::memory_order_relaxed);
+}
+
+void clearEvalCache() {
+  for (auto& e : EVAL_CACHE) e.store(0, std::memory_order_relaxed);
+}
+
 // --------------------------------------------------------------------------------------
 // Quiescence + PVS Negamax
 // --------------------------------------------------------------------------------------
@@ -843,22 +516,56 @@ struct PlyBuffers {
 
 static thread_local PlyBuffers PLY{};
 
+// Set while this thread is below the root (negamax/quiescence); see searchHotPathActive().
+static thread_local bool HOT_PATH = false;
+
+struct HotPathScope {
+  HotPathScope() { HOT_PATH = true; }
+  ~HotPathScope() { HOT_PATH = false; }
+  HotPathScope(const HotPathScope&) = delete;
+  HotPathScope& operator=(const HotPathScope&) = delete;
+};
+
+bool searchHotPathActive() {
+  return HOT_PATH;
+}
+
+// Move-ordering history carried between searches for SearchOptions::keepHeuristics.
+static std::array<int, HISTORY_SIZE> HISTORY_CARRY{};
+
+void clearSearchHistory() {
+  HISTORY_CARRY.fill(0);
+}
+
 struct SearchContext {
   SearchLimits limits{};
   SearchInfoCallback onInfo{};
   std::atomic_bool* stop = nullptr;
+  std::atomic_bool* ponder = nullptr;
+  bool pondering = false;
+  bool iterationCompleted = false; // a root result exists to fall back on
 
   EvalBackend evalBackend = EvalBackend::HCE;
   const NNUE* nnue = nullptr;
   bool useNNUE = false;
   bool useTT = true;
+  bool useEvalCache = true;
+  bool rootRestricted = false; // root limited by SearchOptions::searchMoves
+  SearchParams params{};       // copied at the start, so UCI changes never race a search
 
   std::chrono::steady_clock::time_point start{};
   std::chrono::steady_clock::time_point end{};
+  std::chrono::steady_clock::time_point clockStart{}; // == start, or the moment of ponderhit
+  std::uint64_t hardMs = 0;
   bool useTime = false;
+  TimeManager tm{};
+  bool useTM = false;
   std::uint64_t nodeLimit = 0;
 
   std::uint64_t nodes = 0;
+  std::uint64_t evalCacheProbes = 0;
+  std::uint64_t evalCacheHits = 0;
+  SearchStats stats{};
   int seldepth = 0;
   bool aborted = false;
 
@@ -878,6 +585,26 @@ struct SearchContext {
     return static_cast<std::uint64_t>(duration_cast<milliseconds>(steady_clock::now() - start).count());
   }
 
+  // Time charged to our clock: pondering is free, the clock starts at ponderhit.
+  [[nodiscard]] std::uint64_t clockElapsedMs() const {
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(duration_cast<milliseconds>(steady_clock::now() - clockStart).count());
+  }
+
+  // Returns true while still pondering; on ponderhit switches to the normal time control.
+  bool stillPondering() {
+    if (!pondering) return false;
+    if (ponder->load(std::memory_order_relaxed)) return true;
+    pondering = false;
+    clockStart = std::chrono::steady_clock::now();
+    end = clockStart + std::chrono::milliseconds(hardMs);
+    // The soft limit is otherwise only checked after an iteration, and the deep one running
+    // while pondering would go on to the hard limit. If the ponder alone took the soft limit,
+    // answer with the last completed iteration now.
+    if (useTM && iterationCompleted && elapsedMs() >= tm.softLimitMs()) end = clockStart;
+    return false;
+  }
+
   bool shouldStop() {
     if (aborted) return true;
     // Check stop/time/node limits only every ~2k nodes (cheap + responsive enough for UCI).
@@ -891,7 +618,7 @@ struct SearchContext {
       if (stop) stop->store(true, std::memory_order_relaxed);
       return true;
     }
-    if (useTime && std::chrono::steady_clock::now() >= end) {
+    if (useTime && !stillPondering() && std::chrono::steady_clock::now() >= end) {
       aborted = true;
       if (stop) stop->store(true, std::memory_order_relaxed);
       return true;
@@ -900,11 +627,22 @@ struct SearchContext {
   }
 };
 
-static inline int evalStm(const Position& pos, const SearchContext& ctx, int ply) {
-  if (ctx.useNNUE && ctx.nnue && ply >= 0 && ply < MAX_PLY) {
-    return ctx.nnue->evaluateStm(pos, PLY.nnueAcc[static_cast<std::size_t>(ply)]);
+static inline int evalStm(const Position& pos, SearchContext& ctx, int ply, std::uint64_t key) {
+  const bool nnue = ctx.useNNUE && ctx.nnue && ply >= 0 && ply < MAX_PLY;
+  if (!ctx.useEvalCache) return nnue ? ctx.nnue->evaluateStm(pos, PLY.nnueAcc[static_cast<std::size_t>(ply)]) : hceEvalStm(pos);
+
+  // Backends and nets score differently, so they must not share entries (the salt is odd, so
+  // every net id gives a different key).
+  const std::uint64_t ck = nnue ? (key ^ (EVAL_CACHE_NNUE_SALT * ctx.nnue->id())) : key;
+  ++ctx.evalCacheProbes;
+  int score = 0;
+  if (evalCacheProbe(ck, score)) {
+    ++ctx.evalCacheHits;
+    return score;
   }
-  return hceEvalStm(pos);
+  score = nnue ? ctx.nnue->evaluateStm(pos, PLY.nnueAcc[static_cast<std::size_t>(ply)]) : hceEvalStm(pos);
+  evalCacheStore(ck, score);
+  return score;
 }
 
 static inline int historyScore(const SearchContext& ctx, const Move& m) {
@@ -985,13 +723,26 @@ static std::vector<Move> extractPV(Position pos, std::uint64_t key, int maxLen)
   return pv;
 }
 
+// PV starting with a given root move: the move itself, then the TT line below it.
+static std::vector<Move> extractLinePV(Position pos, std::uint64_t rootKey, const Move& first, int maxLen) {
+  std::vector<Move> pv;
+  if (maxLen <= 0) return pv;
+  Undo u;
+  pos.makeMove(first, u);
+  const std::uint64_t childKey = hashAfterMake(rootKey, pos, u);
+  pv.push_back(first);
+  for (const Move& m : extractPV(pos, childKey, maxLen - 1)) pv.push_back(m);
+  return pv;
+}
+
 static int quiescence(Position& pos, int alpha, int beta, SearchContext& ctx, int ply, std::uint64_t key, int qDepth) {
   ++ctx.nodes;
+  SEARCH_STAT(ctx, qNodes++);
   if (ply > ctx.seldepth) ctx.seldepth = ply;
   if (ctx.shouldStop()) return 0;
 
   if (pos.gameOver()) return mateScore(ply); // side-to-move is the winner in our state model
-  if (ply >= MAX_PLY) return evalStm(pos, ctx, ply); // safety against pathological cycles
+  if (ply >= MAX_PLY) return evalStm(pos, ctx, ply, key); // safety against pathological cycles
 
   // Claimable threefold draw is an available action at this node.
   if (ply > 0 && pos.isRepetition()) {
@@ -999,7 +750,7 @@ static int quiescence(Position& pos, int alpha, int beta, SearchContext& ctx, in
     if (alpha >= beta) return alpha;
   }
 
-  const int stand = evalStm(pos, ctx, ply);
+  const int stand = evalStm(pos, ctx, ply, key);
   if (stand >= beta) return beta;
   if (stand > alpha) alpha = stand;
   if (qDepth <= 0) return alpha;
@@ -1048,7 +799,9 @@ static int quiescence(Position& pos, int alpha, int beta, SearchContext& ctx, in
   return alpha;
 }
 
-static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext& ctx, int ply, std::uint64_t key, bool pvNode) {
+static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext& ctx, int ply, std::uint64_t key, bool pvNode);
+
+static int negamaxNode(Position& pos, int depth, int alpha, int beta, SearchContext& ctx, int ply, std::uint64_t key, bool pvNode) {
   // Threefold repetition is a *claimable* draw (not forced). Treat it as an available
   // action with score 0: the side-to-move can always claim if it's beneficial, but may
   // also choose to play on (e.g. when winning).
@@ -1063,7 +816,7 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
   if (ctx.shouldStop()) return 0;
 
   if (pos.gameOver()) return mateScore(ply);
-  if (ply >= MAX_PLY) return evalStm(pos, ctx, ply);
+  if (ply >= MAX_PLY) return evalStm(pos, ctx, ply, key);
 
   const int alphaOrig = alpha;
 
@@ -1083,8 +836,10 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
   // Transposition table probe.
   Move ttBest = nullMove();
   if (ctx.useTT) {
+    SEARCH_STAT(ctx, ttProbes++);
     const TTEntry& e = ttSlot(key);
     if (e.key == key) {
+      SEARCH_STAT(ctx, ttHits++);
       ttBest = e.best;
       if (e.depth >= depth) {
         int ttScore = scoreFromTT(e.score, ply);
@@ -1092,11 +847,13 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
         if (canClaimDraw && ttScore < 0) ttScore = 0;
         // When a draw claim is available, an Exact=0 stored score can be history-dependent;
         // don't let it short-circuit a potentially winning continuation.
-        if (e.flag == TTFlag::Exact) {
-          if (!canClaimDraw || ttScore != 0) return ttScore;
+        const bool cutoff = (e.flag == TTFlag::Exact) ? (!canClaimDraw || ttScore != 0)
+                            : (e.flag == TTFlag::Lower) ? (ttScore >= beta)
+                                                        : (ttScore <= alpha);
+        if (cutoff) {
+          SEARCH_STAT(ctx, ttCutoffs++);
+          return ttScore;
         }
-        if (e.flag == TTFlag::Lower && ttScore >= beta) return ttScore;
-        if (e.flag == TTFlag::Upper && ttScore <= alpha) return ttScore;
       }
     }
   }
@@ -1105,7 +862,7 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
   bool haveStaticEval = false;
   auto getStaticEval = [&]() -> int {
     if (!haveStaticEval) {
-      staticEval = evalStm(pos, ctx, ply);
+      staticEval = evalStm(pos, ctx, ply, key);
       haveStaticEval = true;
     }
     return staticEval;
@@ -1113,24 +870,36 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
 
   // NNUE pruning policy: keep it more conservative (especially for newly trained nets).
   const bool conservativeEvalPruning = ctx.useNNUE;
+  using SP = SearchParams;
+  const SearchParams& P = ctx.params;
 
   // Razoring (very shallow): if we are far below alpha, go straight to quiescence.
   if (!pvNode && depth <= 2 && !conservativeEvalPruning) {
     const int ev = getStaticEval();
-    const int razorMargin = 220 + (depth - 1) * 180;
-    if (ev + razorMargin <= alpha) return quiescence(pos, alpha, beta, ctx, ply, key, QS_MAX_DEPTH);
+    const int razorMargin = P[SP::RazorBase] + (depth - 1) * P[SP::RazorDepth];
+    if (ev + razorMargin <= alpha) {
+      SEARCH_STAT(ctx, razorPrunes++);
+      return quiescence(pos, alpha, beta, ctx, ply, key, QS_MAX_DEPTH);
+    }
   }
 
   // Reverse futility pruning (fail-high) at shallow depth.
   if (!pvNode && depth <= 2 && !conservativeEvalPruning) {
     const int ev = getStaticEval();
-    const int margin = 160 + depth * 120;
-    if (ev - margin >= beta) return ev;
+    const int margin = P[SP::RfpBase] + depth * P[SP::RfpDepth];
+    if (ev - margin >= beta) {
+      SEARCH_STAT(ctx, rfpPrunes++);
+      return ev;
+    }
   }
 
   // Null-move pruning (disabled in very low material to reduce zugzwang risk).
-  if (!pvNode && depth >= (ctx.useNNUE ? 4 : 3) && ply > 0 && nonSovPieceCount(pos, pos.turn()) >= (ctx.useNNUE ? 4 : 3)) {
-    const int R = ctx.useNNUE ? (1 + ((depth >= 7) ? 1 : 0)) : (2 + ((depth >= 6) ? 1 : 0));
+  const int nmpMinDepth = ctx.useNNUE ? P[SP::NnueNmpMinDepth] : P[SP::NmpMinDepth];
+  const int nmpMinPieces = ctx.useNNUE ? P[SP::NnueNmpMinPieces] : P[SP::NmpMinPieces];
+  if (!pvNode && depth >= nmpMinDepth && ply > 0 && nonSovPieceCount(pos, pos.turn()) >= nmpMinPieces) {
+    const int R = ctx.useNNUE ? (P[SP::NnueNmpBaseR] + ((depth >= P[SP::NnueNmpDeepDepth]) ? 1 : 0))
+                              : (P[SP::NmpBaseR] + ((depth >= P[SP::NmpDeepDepth]) ? 1 : 0));
+    SEARCH_STAT(ctx, nullTries++);
     NullUndo nu;
     if (ctx.useNNUE && ply + 1 < MAX_PLY) PLY.nnueAcc[static_cast<std::size_t>(ply + 1)] = PLY.nnueAcc[static_cast<std::size_t>(ply)];
     pos.makeNullMove(nu);
@@ -1139,11 +908,18 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
     const int score = -negamax(pos, depth - 1 - R, -beta, -(beta - 1), ctx, ply + 1, nullKey, false);
     pos.undoNullMove(nu);
     if (ctx.aborted) return 0;
-    if (score >= beta) return beta;
+    if (score >= beta) {
+      SEARCH_STAT(ctx, nullCutoffs++);
+      return beta;
+    }
   }
 
   MoveList& moves = PLY.moves[static_cast<std::size_t>(ply)];
   pos.generateMoves(moves);
+#ifdef CITADEL_STATS
+  ++ctx.stats.genNodes;
+  for (std::uint32_t i = 0; i < moves.size; ++i) ++ctx.stats.genByType[static_cast<std::size_t>(moves.buf[i].type)];
+#endif
   if (moves.empty()) return getStaticEval();
 
   // Score moves once, then do lazy selection-ordering.
@@ -1174,17 +950,23 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
     // Futility: at depth 1, skip late quiet moves if we cannot raise alpha.
     if (!pvNode && depth == 1 && quiet) {
       const int ev = getStaticEval();
-      const int margin = ctx.useNNUE ? 340 : 220;
-      if (ev + margin <= alpha) continue;
+      const int margin = ctx.useNNUE ? P[SP::NnueFutilityMargin] : P[SP::FutilityMargin];
+      if (ev + margin <= alpha) {
+        SEARCH_STAT(ctx, futilityPrunes++);
+        continue;
+      }
     }
 
     // Late-move pruning (very shallow): after enough quiet moves, skip more quiet moves
     // when we're not improving alpha. This helps speed in locked wall endgames.
     if (!pvNode && depth == 2 && quiet) {
       const int ev = getStaticEval();
-      const std::uint32_t moveCount = ctx.useNNUE ? 32u : 20u;
-      const int margin = ctx.useNNUE ? 200 : 140;
-      if (i >= moveCount && ev + margin <= alpha) continue;
+      const auto moveCount = static_cast<std::uint32_t>(ctx.useNNUE ? P[SP::NnueLmpMoves] : P[SP::LmpMoves]);
+      const int margin = ctx.useNNUE ? P[SP::NnueLmpMargin] : P[SP::LmpMargin];
+      if (i >= moveCount && ev + margin <= alpha) {
+        SEARCH_STAT(ctx, lmpPrunes++);
+        continue;
+      }
     }
 
     Undo u;
@@ -1206,11 +988,12 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
       } else {
         // Non-PV: PVS null window, with LMR for late quiet moves.
         int searchDepth = newDepth;
-        const bool doLMR = (!pvNode && quiet && depth >= 3 && i >= 4);
+        const bool doLMR = (!pvNode && quiet && depth >= P[SP::LmrMinDepth] && i >= static_cast<std::uint32_t>(P[SP::LmrMinMoves]));
         if (doLMR) {
-          const int r = 1 + ((i >= 8) ? 1 : 0) + ((depth >= 6) ? 1 : 0);
+          const int r = 1 + ((i >= static_cast<std::uint32_t>(P[SP::LmrLateMoves])) ? 1 : 0) + ((depth >= P[SP::LmrDeepDepth]) ? 1 : 0);
           searchDepth = newDepth - r;
           if (searchDepth < 1) searchDepth = 1;
+          if (searchDepth != newDepth) SEARCH_STAT(ctx, lmrReductions++);
         }
 
         score = -negamax(pos, searchDepth, -(alpha + 1), -alpha, ctx, ply + 1, key, false);
@@ -1218,6 +1001,7 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
           // If reduced search (or null-window) indicates improvement, re-search deeper / wider.
           if (score > alpha) {
             if (doLMR && searchDepth != newDepth) {
+              SEARCH_STAT(ctx, lmrResearches++);
               score = -negamax(pos, newDepth, -(alpha + 1), -alpha, ctx, ply + 1, key, false);
             }
             if (score > alpha && score < beta) {
@@ -1240,6 +1024,8 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
     if (best > alpha) alpha = best;
 
     if (alpha >= beta) {
+      SEARCH_STAT(ctx, betaCutoffs++);
+      if (i == 0) SEARCH_STAT(ctx, firstMoveCutoffs++);
       if (quiet) recordQuietCutoff(ctx, m, ply, depth);
       break;
     }
@@ -1261,46 +1047,41 @@ static int negamax(Position& pos, int depth, int alpha, int beta, SearchContext&
   return best;
 }
 
+static inline int negamax(Position& pos, int depth, int alpha, int beta, SearchContext& ctx, int ply, std::uint64_t key, bool pvNode) {
+#ifdef CITADEL_STATS
+  const int v = negamaxNode(pos, depth, alpha, beta, ctx, ply, key, pvNode);
+  if (depth > 0 && !ctx.aborted) {
+    if (pvNode) ++ctx.stats.pvNodes;
+    else if (v >= beta) ++ctx.stats.cutNodes;
+    else ++ctx.stats.allNodes;
+  }
+  return v;
+#else
+  return negamaxNode(pos, depth, alpha, beta, ctx, ply, key, pvNode);
+#endif
+}
+
 struct RootOut {
   int score = -INF;
   Move best = nullMove();
 };
 
-static RootOut searchRoot(Position& pos, std::uint64_t rootKey, MoveList& moves, int depth, int alpha, int beta, SearchContext& ctx) {
+// Searches root moves [first, rms.size()) in list order, recording each move's score and node
+// count. Moves before `first` are excluded (MultiPV lines already found in this iteration). The
+// best move is rotated to slot `first` so an aspiration re-search tries it first.
+static RootOut searchRoot(Position& pos, std::uint64_t rootKey, std::vector<RootMove>& rms, std::size_t first, int depth, int alpha, int beta,
+                          SearchContext& ctx) {
   RootOut out;
-  if (moves.empty()) return out;
-
-  // Root move ordering: heuristic + TT + killers/history.
-  Move ttBest = nullMove();
-  if (ctx.useTT) {
-    const TTEntry& e = ttSlot(rootKey);
-    if (e.key == rootKey) ttBest = e.best;
-  }
-
-  std::array<int, 4096> scores{};
-  for (std::uint32_t i = 0; i < moves.size; ++i) scores[i] = orderScore(pos, moves.buf[i], ttBest, ctx, 0);
+  if (first >= rms.size()) return out;
 
   int bestScore = -INF;
-  Move bestMove = moves.buf[0];
+  std::size_t bestIdx = first;
   int alpha0 = alpha;
 
-  for (std::uint32_t i = 0; i < moves.size; ++i) {
-    // Select next best move by ordering score.
-    std::uint32_t bestIdx = i;
-    int bestSc = scores[i];
-    for (std::uint32_t j = i + 1; j < moves.size; ++j) {
-      const int s = scores[j];
-      if (s > bestSc) {
-        bestSc = s;
-        bestIdx = j;
-      }
-    }
-    if (bestIdx != i) {
-      std::swap(moves.buf[i], moves.buf[bestIdx]);
-      std::swap(scores[i], scores[bestIdx]);
-    }
-
-    const Move m = moves.buf[i];
+  for (std::size_t i = first; i < rms.size(); ++i) {
+    RootMove& rm = rms[i];
+    const Move m = rm.move;
+    const std::uint64_t nodes0 = ctx.nodes;
     Undo u;
     if (ctx.useNNUE) PLY.nnueAcc[1] = PLY.nnueAcc[0];
     pos.makeMove(m, u);
@@ -1310,21 +1091,27 @@ static RootOut searchRoot(Position& pos, std::uint64_t rootKey, MoveList& moves,
     int score = 0;
     if (pos.gameOver()) {
       score = mateScore(1);
-    } else if (i == 0) {
-      score = -negamax(pos, depth - 1, -beta, -alpha, ctx, 1, childKey, true);
     } else {
-      score = -negamax(pos, depth - 1, -(alpha + 1), -alpha, ctx, 1, childKey, false);
-      if (!ctx.aborted && score > alpha && score < beta) {
+      HotPathScope hot;
+      if (i == first) {
         score = -negamax(pos, depth - 1, -beta, -alpha, ctx, 1, childKey, true);
+      } else {
+        score = -negamax(pos, depth - 1, -(alpha + 1), -alpha, ctx, 1, childKey, false);
+        if (!ctx.aborted && score > alpha && score < beta) {
+          score = -negamax(pos, depth - 1, -beta, -alpha, ctx, 1, childKey, true);
+        }
       }
     }
 
     pos.undoMove(u);
+    rm.nodes += ctx.nodes - nodes0;
     if (ctx.aborted) break;
 
+    rm.score = score;
+    rm.exact = score > alpha && score < beta;
     if (score > bestScore) {
       bestScore = score;
-      bestMove = m;
+      bestIdx = i;
     }
     if (score > alpha) alpha = score;
     if (alpha >= beta) {
@@ -1334,8 +1121,12 @@ static RootOut searchRoot(Position& pos, std::uint64_t rootKey, MoveList& moves,
     }
   }
 
-  // Store root for ordering/PV reconstruction.
-  if (ctx.useTT) {
+  const Move bestMove = rms[bestIdx].move;
+  const auto it = rms.begin() + static_cast<std::ptrdiff_t>(first);
+  std::rotate(it, rms.begin() + static_cast<std::ptrdiff_t>(bestIdx), rms.begin() + static_cast<std::ptrdiff_t>(bestIdx + 1));
+
+  // Store root for ordering/PV reconstruction (only for the unrestricted pass).
+  if (ctx.useTT && first == 0 && !ctx.rootRestricted) {
     TTEntry& r = ttSlot(rootKey);
     const TTFlag flag = (bestScore <= alpha0) ? TTFlag::Upper : (bestScore >= beta) ? TTFlag::Lower : TTFlag::Exact;
     r.key = rootKey;
@@ -1350,7 +1141,93 @@ static RootOut searchRoot(Position& pos, std::uint64_t rootKey, MoveList& moves,
   return out;
 }
 
+// Orders root moves [first, end) by the regular move-ordering score; ties (mostly quiet moves
+// without history) go to the move with the larger subtree in the previous iteration.
+static void orderRootMoves(const Position& pos, std::vector<RootMove>& rms, std::size_t first, const Move& ttBest, const SearchContext& ctx) {
+  std::vector<std::pair<int, RootMove>> keyed;
+  keyed.reserve(rms.size() - first);
+  for (std::size_t i = first; i < rms.size(); ++i) keyed.emplace_back(orderScore(pos, rms[i].move, ttBest, ctx, 0), std::move(rms[i]));
+  std::stable_sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) {
+    if (a.first != b.first) return a.first > b.first;
+    return a.second.nodes > b.second.nodes;
+  });
+  for (std::size_t i = first; i < rms.size(); ++i) rms[i] = std::move(keyed[i - first].second);
+}
+
+// --------------------------------------------------------------------------------------
+// Instrumentation counters
+// --------------------------------------------------------------------------------------
+
+SearchStats& SearchStats::operator+=(const SearchStats& o) {
+  pvNodes += o.pvNodes;
+  cutNodes += o.cutNodes;
+  allNodes += o.allNodes;
+  qNodes += o.qNodes;
+  ttProbes += o.ttProbes;
+  ttHits += o.ttHits;
+  ttCutoffs += o.ttCutoffs;
+  nullTries += o.nullTries;
+  nullCutoffs += o.nullCutoffs;
+  razorPrunes += o.razorPrunes;
+  rfpPrunes += o.rfpPrunes;
+  futilityPrunes += o.futilityPrunes;
+  lmpPrunes += o.lmpPrunes;
+  lmrReductions += o.lmrReductions;
+  lmrResearches += o.lmrResearches;
+  betaCutoffs += o.betaCutoffs;
+  firstMoveCutoffs += o.firstMoveCutoffs;
+  genNodes += o.genNodes;
+  for (std::size_t i = 0; i < genByType.size(); ++i) genByType[i] += o.genByType[i];
+  return *this;
+}
+
+static double pct(std::uint64_t num, std::uint64_t den) {
+  return den ? 100.0 * static_cast<double>(num) / static_cast<double>(den) : 0.0;
+}
+
+std::vector<std::string> formatSearchStats(const SearchStats& st) {
+  static constexpr const char* TYPE_NAMES[6] = {"normal", "construct", "command", "catapult", "ranged", "bastion"};
+  std::vector<std::string> out;
+  auto line = [&](auto&&... parts) {
+    std::ostringstream os;
+    os.setf(std::ios::fixed);
+    os.precision(1);
+    (os << ... << parts);
+    out.push_back(os.str());
+  };
+
+  line("nodes pv ", st.pvNodes, " cut ", st.cutNodes, " all ", st.allNodes, " qs ", st.qNodes);
+  line("tt probes ", st.ttProbes, " hits ", st.ttHits, " (", pct(st.ttHits, st.ttProbes), "%) cutoffs ", st.ttCutoffs, " (",
+       pct(st.ttCutoffs, st.ttProbes), "%)");
+  line("null tries ", st.nullTries, " cutoffs ", st.nullCutoffs, " (", pct(st.nullCutoffs, st.nullTries), "%)");
+  line("prune razor ", st.razorPrunes, " rfp ", st.rfpPrunes, " futility ", st.futilityPrunes, " lmp ", st.lmpPrunes);
+  line("lmr reductions ", st.lmrReductions, " researches ", st.lmrResearches, " (", pct(st.lmrResearches, st.lmrReductions), "%)");
+  line("cutoffs ", st.betaCutoffs, " first-move ", st.firstMoveCutoffs, " (", pct(st.firstMoveCutoffs, st.betaCutoffs), "%)");
+
+  std::uint64_t genTotal = 0;
+  for (std::uint64_t n : st.genByType) genTotal += n;
+  const double perNode = st.genNodes ? static_cast<double>(genTotal) / static_cast<double>(st.genNodes) : 0.0;
+  std::ostringstream os;
+  os.setf(std::ios::fixed);
+  os.precision(1);
+  os << "moves/node " << perNode;
+  for (std::size_t i = 0; i < st.genByType.size(); ++i) {
+    os << ' ' << TYPE_NAMES[i] << ' ' << (st.genNodes ? static_cast<double>(st.genByType[i]) / static_cast<double>(st.genNodes) : 0.0);
+  }
+  out.push_back(os.str());
+  return out;
+}
+
+static std::mutex LAST_STATS_MUTEX;
+static SearchStats LAST_STATS;
+
+SearchStats lastSearchStats() {
+  std::lock_guard<std::mutex> lock(LAST_STATS_MUTEX);
+  return LAST_STATS;
+}
+
 SearchResult searchBestMove(Position& pos, const SearchOptions& opt) {
+  TraceScope traceSearch("search", "search", "depthLimit", opt.limits.depth);
   if (opt.useTT) ensureTT();
 
   SearchResult res;
@@ -1361,21 +1238,60 @@ SearchResult searchBestMove(Position& pos, const SearchOptions& opt) {
   ctx.evalBackend = opt.evalBackend;
   ctx.nnue = opt.nnue;
   ctx.useNNUE = (opt.evalBackend == EvalBackend::NNUE) && (opt.nnue != nullptr) && opt.nnue->loaded();
+  ctx.params = opt.params ? *opt.params : searchParams();
+  ctx.ponder = opt.ponder;
+  ctx.pondering = (opt.ponder != nullptr) && opt.ponder->load(std::memory_order_relaxed);
   ctx.useTT = opt.useTT;
+  ctx.useEvalCache = opt.useEvalCache;
   ctx.nodeLimit = opt.limits.nodeLimit;
   ctx.useTime = opt.limits.timeLimitMs != 0;
+  ctx.useTM = opt.limits.timeLeftMs != 0;
 
   const auto t0 = std::chrono::steady_clock::now();
   ctx.start = t0;
-  if (ctx.useTime) ctx.end = t0 + std::chrono::milliseconds(opt.limits.timeLimitMs);
+  ctx.clockStart = t0;
+  ctx.hardMs = opt.limits.timeLimitMs;
+  if (ctx.useTM) {
+    ctx.tm.init(opt.limits.timeLeftMs, opt.limits.incMs, opt.limits.movesToGo, opt.limits.moveOverheadMs);
+    if (ctx.hardMs == 0 || ctx.tm.hardLimitMs() < ctx.hardMs) ctx.hardMs = ctx.tm.hardLimitMs();
+    ctx.useTime = true;
+  }
+  if (ctx.useTime) ctx.end = t0 + std::chrono::milliseconds(ctx.hardMs);
   ctx.resetHeuristics();
+  if (opt.keepHeuristics) {
+    // Age the carried history so it guides ordering without dominating fresh cutoffs.
+    for (std::size_t i = 0; i < HISTORY_SIZE; ++i) ctx.history[i] = HISTORY_CARRY[i] / 2;
+  }
 
   int maxDepth = opt.limits.depth;
   if (maxDepth <= 0) maxDepth = 1;
   if (maxDepth > MAX_PLY - 1) maxDepth = MAX_PLY - 1;
 
-  MoveList rootMoves;
-  pos.generateMoves(rootMoves);
+  const std::uint64_t rootKey = hashPosition(pos);
+
+  // Root move list, restricted to opt.searchMoves when any of them is legal.
+  std::vector<RootMove> rootMoves;
+  {
+    MoveList legal;
+    pos.generateMoves(legal);
+    auto wanted = [&](const Move& m) {
+      return std::any_of(opt.searchMoves.begin(), opt.searchMoves.end(), [&](const Move& s) { return sameMove(s, m); });
+    };
+    for (std::uint32_t i = 0; i < legal.size; ++i) {
+      if (wanted(legal.buf[i])) rootMoves.emplace_back().move = legal.buf[i];
+    }
+    ctx.rootRestricted = !rootMoves.empty();
+    if (rootMoves.empty()) {
+      for (std::uint32_t i = 0; i < legal.size; ++i) rootMoves.emplace_back().move = legal.buf[i];
+    }
+
+    Move ttBest = nullMove();
+    if (ctx.useTT) {
+      const TTEntry& e = ttSlot(rootKey);
+      if (e.key == rootKey) ttBest = e.best;
+    }
+    orderRootMoves(pos, rootMoves, 0, ttBest, ctx);
+  }
   if (rootMoves.empty()) {
     res.best = nullMove();
     res.score = 0;
@@ -1384,73 +1300,133 @@ SearchResult searchBestMove(Position& pos, const SearchOptions& opt) {
     return res;
   }
 
+  // Everything below the root must run without heap allocation: size the repetition history for
+  // the deepest line and touch this thread's ply buffers before the first node.
+  pos.reserveHistory(static_cast<std::size_t>(MAX_PLY) + 1);
   if (ctx.useNNUE) ctx.nnue->initAccumulator(pos, PLY.nnueAcc[0]);
+  (void)PLY.moves.size();
 
-  const std::uint64_t rootKey = hashPosition(pos);
-
-  Move bestMove = rootMoves.buf[0];
+  Move bestMove = rootMoves[0].move;
+  Move ponderMove = nullMove(); // expected reply: second move of the last completed PV
   int bestScore = -INF;
 
-  int prevScore = 0;
   int lastCompletedDepth = 0;
+  std::vector<RootMove> completed; // root list as of the last completed iteration
+
+  // MultiPV: pass k of an iteration searches the root without the k moves already found.
+  const std::size_t multiPV = std::clamp<std::size_t>(static_cast<std::size_t>(std::max(opt.multiPV, 1)), 1, rootMoves.size());
+  const auto linesEnd = rootMoves.begin() + static_cast<std::ptrdiff_t>(multiPV);
 
+  SearchInfo info; // reused so its PV keeps its capacity between reports
   for (int curDepth = 1; curDepth <= maxDepth; ++curDepth) {
     if (ctx.shouldStop()) break;
+    TraceScope traceIter("iteration", "search", "depth", curDepth);
     ctx.seldepth = 0;
 
-    int alpha = -INF;
-    int beta = INF;
-
-    // Aspiration windows after depth 1.
-    int window = (curDepth <= 2) ? 140 : 90;
-    if (curDepth > 1) {
-      alpha = prevScore - window;
-      beta = prevScore + window;
+    for (RootMove& rm : rootMoves) {
+      rm.previousScore = rm.score;
+      rm.nodes = 0;
     }
+    const std::uint64_t iterNodes0 = ctx.nodes;
 
-    RootOut iter;
-    while (true) {
-      iter = searchRoot(pos, rootKey, rootMoves, curDepth, alpha, beta, ctx);
-      if (ctx.aborted) break;
+    for (std::size_t pvIdx = 0; pvIdx < multiPV; ++pvIdx) {
+      int alpha = -INF;
+      int beta = INF;
 
-      if (curDepth == 1) break;
-      if (iter.score <= alpha) {
-        // fail-low: widen downward
-        alpha = -INF;
-        window *= 2;
-        beta = iter.score + window;
-        continue;
+      // Aspiration windows after depth 1.
+      int window = (curDepth <= 2) ? ctx.params[SearchParams::AspWindowShallow] : ctx.params[SearchParams::AspWindow];
+      if (curDepth > 1) {
+        alpha = rootMoves[pvIdx].previousScore - window;
+        beta = rootMoves[pvIdx].previousScore + window;
       }
-      if (iter.score >= beta) {
-        // fail-high: widen upward
-        beta = INF;
-        window *= 2;
-        alpha = iter.score - window;
-        continue;
+
+      while (true) {
+        RootOut iter;
+        {
+          TraceScope traceRoot("root", "search", "window", (alpha == -INF || beta == INF) ? 0 : beta - alpha);
+          iter = searchRoot(pos, rootKey, rootMoves, pvIdx, curDepth, alpha, beta, ctx);
+        }
+        if (ctx.aborted) break;
+
+        if (curDepth == 1) break;
+        if (iter.score <= alpha) {
+          traceInstant("fail-low", "aspiration", "score", iter.score);
+          // fail-low: widen downward
+          alpha = -INF;
+          window *= 2;
+          beta = iter.score + window;
+          continue;
+        }
+        if (iter.score >= beta) {
+          traceInstant("fail-high", "aspiration", "score", iter.score);
+          // fail-high: widen upward
+          beta = INF;
+          window *= 2;
+          alpha = iter.score - window;
+          continue;
+        }
+        break;
       }
-      break;
+
+      if (ctx.aborted) break;
     }
 
     if (ctx.aborted) break;
 
-    bestMove = iter.best;
-    bestScore = iter.score;
-    prevScore = bestScore;
+    // Lines best-first (a later pass can, rarely, score above an earlier one), then the rest in
+    // move-ordering order with subtree size breaking ties.
+    std::stable_sort(rootMoves.begin(), linesEnd, [](const RootMove& a, const RootMove& b) { return a.score > b.score; });
+    orderRootMoves(pos, rootMoves, multiPV, nullMove(), ctx);
+
+    const bool bestChanged = (lastCompletedDepth == 0) || !sameMove(rootMoves[0].move, bestMove);
+    bestMove = rootMoves[0].move;
+    bestScore = rootMoves[0].score;
     lastCompletedDepth = curDepth;
 
+    // PVs of the completed iteration (an aborted later iteration may overwrite TT entries).
+    for (std::size_t k = 0; k < rootMoves.size(); ++k) {
+      RootMove& rm = rootMoves[k];
+      if (k < multiPV && ctx.useTT) {
+        rm.pv = extractLinePV(pos, rootKey, rm.move, std::min(MAX_PLY - 1, curDepth + 16));
+      } else {
+        rm.pv.assign(1, rm.move);
+      }
+    }
+    ponderMove = (rootMoves[0].pv.size() >= 2) ? rootMoves[0].pv[1] : nullMove();
+
     if (ctx.onInfo) {
-      SearchInfo info;
-      info.depth = curDepth;
-      info.seldepth = ctx.seldepth;
-      info.score = bestScore;
-      info.nodes = ctx.nodes;
-      info.timeMs = ctx.elapsedMs();
-      info.best = bestMove;
-      if (ctx.useTT) info.pv = extractPV(pos, rootKey, std::min(MAX_PLY - 1, curDepth + 16));
-      ctx.onInfo(info);
+      TraceScope traceInfo("onInfo", "uci", "lines", static_cast<std::int64_t>(multiPV));
+      for (std::size_t k = 0; k < multiPV; ++k) {
+        info.depth = curDepth;
+        info.seldepth = ctx.seldepth;
+        info.multipv = static_cast<int>(k + 1);
+        info.score = rootMoves[k].score;
+        info.nodes = ctx.nodes;
+        info.evalCacheProbes = ctx.evalCacheProbes;
+        info.evalCacheHits = ctx.evalCacheHits;
+        info.timeMs = ctx.elapsedMs();
+        info.best = rootMoves[k].move;
+        info.pv = rootMoves[k].pv;
+        ctx.onInfo(info);
+      }
+    }
+    completed = rootMoves;
+    ctx.iterationCompleted = true;
+
+    if (ctx.useTM && !ctx.stillPondering()) {
+      const std::uint64_t iterNodes = ctx.nodes - iterNodes0;
+      const double share = (iterNodes > 0) ? (static_cast<double>(rootMoves[0].nodes) / static_cast<double>(iterNodes)) : 1.0;
+      ctx.tm.onIteration(curDepth, bestChanged, bestScore, share);
+      if (ctx.tm.stopAfterIteration(ctx.clockElapsedMs()) || std::chrono::steady_clock::now() >= ctx.end) break;
     }
   }
 
+  // A pondering search must not return before 'ponderhit' or 'stop', even if it ran out of depth.
+  while (ctx.stillPondering() && !(ctx.stop && ctx.stop->load(std::memory_order_relaxed))) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (opt.keepHeuristics) HISTORY_CARRY = ctx.history;
+
   const auto t1 = std::chrono::steady_clock::now();
   const std::chrono::duration<double> dt = t1 - t0;
 
@@ -1461,30 +1437,41 @@ SearchResult searchBestMove(Position& pos, const SearchOptions& opt) {
       if (e.key == rootKey) {
         if (e.best.to != SQ_NONE) {
           // Validate TT move at root (defensive against collisions).
-          bool ok = false;
-          for (std::uint32_t i = 0; i < rootMoves.size; ++i) {
-            if (sameMove(rootMoves.buf[i], e.best)) {
-              ok = true;
-              break;
-            }
-          }
+          const bool ok = std::any_of(rootMoves.begin(), rootMoves.end(), [&](const RootMove& rm) { return sameMove(rm.move, e.best); });
           if (ok) bestMove = e.best;
         }
         bestScore = scoreFromTT(e.score, 0);
       } else {
-        bestMove = rootMoves.buf[0];
-        bestScore = evalStm(pos, ctx, 0);
+        bestMove = rootMoves[0].move;
+        bestScore = evalStm(pos, ctx, 0, rootKey);
       }
     } else {
-      bestMove = rootMoves.buf[0];
-      bestScore = evalStm(pos, ctx, 0);
+      bestMove = rootMoves[0].move;
+      bestScore = evalStm(pos, ctx, 0, rootKey);
     }
   }
 
   res.best = bestMove;
+  res.ponder = ponderMove;
   res.score = bestScore;
   res.nodes = ctx.nodes;
+  res.evalCacheProbes = ctx.evalCacheProbes;
+  res.evalCacheHits = ctx.evalCacheHits;
   res.seconds = dt.count();
+  res.stats = ctx.stats;
+  if constexpr (kSearchStatsEnabled) {
+    {
+      std::lock_guard<std::mutex> lock(LAST_STATS_MUTEX);
+      LAST_STATS = ctx.stats;
+    }
+    for (const auto& l : formatSearchStats(ctx.stats)) std::cerr << "stats " << l << "\n";
+  }
+
+  // Refutation lines for the non-PV moves are only worth the TT walk once, at the end.
+  for (std::size_t k = multiPV; k < completed.size() && opt.useTT; ++k) {
+    completed[k].pv = extractLinePV(pos, rootKey, completed[k].move, lastCompletedDepth);
+  }
+  res.rootMoves = std::move(completed);
   return res;
 }
 
@@ -1494,6 +1481,14 @@ SearchResult searchBestMove(Position& pos, int depth) {
   return searchBestMove(pos, opt);
 }
 
+std::uint64_t searchHash(const Position& pos) {
+  return hashPosition(pos);
+}
+
+std::uint64_t searchHashAfterMake(std::uint64_t parentKey, const Position& posAfterMove, const Undo& u) {
+  return hashAfterMake(parentKey, posAfterMove, u);
+}
+
 int evaluatePositionStm(const Position& pos, EvalBackend backend, const NNUE* nnue) {
   if (backend == EvalBackend::NNUE && nnue && nnue->loaded()) {
     NNUE::Accumulator acc;
@@ -0,0 +1,75 @@
+#include "citadel/searchparams.hpp"
+
+#include <utility>
+
+#include "citadel/paramfile.hpp"
+
+namespace citadel {
+
+static constexpr std::uint8_t HCE = 1;
+static constexpr std::uint8_t NNUE = 2;
+
+// Same order as SearchParams::Index.
+static constexpr std::array<SearchParams::Info, SearchParams::Count> PARAM_INFO = {{
+    {"RazorBase", 220, 0, 1000, 20.0, HCE},
+    {"RazorDepth", 180, 0, 1000, 20.0, HCE},
+    {"RfpBase", 160, 0, 1000, 15.0, HCE},
+    {"RfpDepth", 120, 0, 1000, 15.0, HCE},
+    {"NmpMinDepth", 3, 1, 12, 0.5, HCE},
+    {"NmpMinPieces", 3, 0, 17, 0.5, HCE},
+    {"NmpBaseR", 2, 0, 6, 0.5, HCE},
+    {"NmpDeepDepth", 6, 1, 20, 1.0, HCE},
+    {"FutilityMargin", 220, 0, 1000, 20.0, HCE},
+    {"LmpMoves", 20, 1, 200, 2.0, HCE},
+    {"LmpMargin", 140, 0, 1000, 15.0, HCE},
+
+    {"NnueNmpMinDepth", 4, 1, 12, 0.5, NNUE},
+    {"NnueNmpMinPieces", 4, 0, 17, 0.5, NNUE},
+    {"NnueNmpBaseR", 1, 0, 6, 0.5, NNUE},
+    {"NnueNmpDeepDepth", 7, 1, 20, 1.0, NNUE},
+    {"NnueFutilityMargin", 340, 0, 1000, 25.0, NNUE},
+    {"NnueLmpMoves", 32, 1, 200, 3.0, NNUE},
+    {"NnueLmpMargin", 200, 0, 1000, 20.0, NNUE},
+
+    {"LmrMinDepth", 3, 2, 12, 0.5, HCE | NNUE},
+    {"LmrMinMoves", 4, 1, 40, 0.5, HCE | NNUE},
+    {"LmrLateMoves", 8, 1, 80, 1.0, HCE | NNUE},
+    {"LmrDeepDepth", 6, 1, 20, 1.0, HCE | NNUE},
+    {"AspWindow", 90, 5, 1000, 10.0, HCE | NNUE},
+    {"AspWindowShallow", 140, 5, 1000, 15.0, HCE | NNUE},
+}};
+
+static constexpr SearchParams buildDefaults() {
+  SearchParams p;
+  for (std::size_t i = 0; i < p.value.size(); ++i) p.value[i] = PARAM_INFO[i].value;
+  return p;
+}
+
+static constexpr SearchParams DEFAULT_PARAMS = buildDefaults();
+static SearchParams g_params = DEFAULT_PARAMS;
+
+const SearchParams& SearchParams::defaults() { return DEFAULT_PARAMS; }
+
+const SearchParams::Info& SearchParams::info(std::size_t i) { return PARAM_INFO.at(i); }
+
+static const char* paramName(std::size_t i) { return PARAM_INFO[i].name; }
+
+std::size_t SearchParams::find(std::string_view n) { return findParam(n, Count, paramName); }
+
+bool SearchParams::usedBy(std::size_t i, EvalBackend backend) {
+  return PARAM_INFO.at(i).uses & (backend == EvalBackend::NNUE ? NNUE : HCE);
+}
+
+SearchParams SearchParams::load(const std::string& path) {
+  SearchParams p = DEFAULT_PARAMS;
+  loadParamFile(path, "search params", p.value, paramName, [](std::size_t i) { return std::pair{PARAM_INFO[i].min, PARAM_INFO[i].max}; });
+  return p;
+}
+
+void SearchParams::save(const std::string& path) const { saveParamFile(path, "search params", value, paramName); }
+
+const SearchParams& searchParams() { return g_params; }
+
+void setSearchParams(const SearchParams& p) { g_params = p; }
+
+} // namespace citadel
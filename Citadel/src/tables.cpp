@@ -28,6 +28,7 @@ static Tables buildTables() {
           const int cc = c + d.c;
           if (!inBounds(rr, cc)) continue;
           t.knightTargets[s][n++] = sq(rr, cc);
+          t.knightMask[s].set(sq(rr, cc));
         }
         t.knightCount[s] = n;
       }
@@ -40,10 +41,15 @@ static Tables buildTables() {
           const int cc = c + d.c;
           if (!inBounds(rr, cc)) continue;
           t.kingTargets[s][n++] = sq(rr, cc);
+          t.kingMask[s].set(sq(rr, cc));
         }
         t.kingCount[s] = n;
       }
 
+      for (const auto& d : DIRS4) {
+        if (inBounds(r + d.r, c + d.c)) t.orthoMask[s].set(sq(r + d.r, c + d.c));
+      }
+
       // Rays (8 directions)
       for (std::uint8_t dir = 0; dir < 8; ++dir) {
         const auto& d = DIRS8[dir];
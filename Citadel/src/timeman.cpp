@@ -0,0 +1,77 @@
+#include "citadel/timeman.hpp"
+
+#include <algorithm>
+
+namespace citadel {
+
+void TimeManager::init(std::uint64_t timeLeftMs, std::uint64_t incMs, int movesToGo, std::uint64_t overheadMs) {
+  scale_ = 1.0;
+  stableIters_ = 0;
+  prevScore_ = 0;
+  havePrevScore_ = false;
+
+  // Keep a safety margin for GUI/OS latency.
+  const std::uint64_t avail = (timeLeftMs > overheadMs + 1) ? (timeLeftMs - overheadMs) : 1;
+
+  // Sudden death: plan for ~30 more moves (the old fixed 1/30 budget), but never run the clock
+  // below what the increment replenishes.
+  const int mtg = (movesToGo > 0) ? std::min(movesToGo, 50) : 30;
+  const auto mtgU = static_cast<std::uint64_t>(mtg);
+
+  std::uint64_t soft = avail / mtgU + (incMs * 3) / 4;
+  std::uint64_t hard = soft * 4;
+
+  // Last move before the time control: use most of what is left.
+  if (mtg == 1) {
+    soft = (avail * 6) / 10;
+    hard = (avail * 9) / 10;
+  }
+
+  // Never plan on more than a fraction of the remaining clock.
+  const std::uint64_t softCap = (avail * 4) / 10;
+  const std::uint64_t hardCap = (mtg == 1) ? (avail * 9) / 10 : (avail * 3) / 4;
+  soft = std::min(soft, softCap);
+  hard = std::min(hard, hardCap);
+
+  softMs_ = std::max<std::uint64_t>(soft, 1);
+  hardMs_ = std::max<std::uint64_t>(hard, softMs_);
+}
+
+void TimeManager::onIteration(int depth, bool bestMoveChanged, int score, double bestNodeShare) {
+  stableIters_ = bestMoveChanged ? 0 : (stableIters_ + 1);
+
+  // Shallow iterations are too noisy to steer the clock.
+  if (depth < 4) {
+    prevScore_ = score;
+    havePrevScore_ = true;
+    scale_ = 1.0;
+    return;
+  }
+
+  // 1) Best-move stability: a freshly changed best move deserves more time.
+  static constexpr double STABILITY[7] = {1.50, 1.25, 1.10, 1.00, 0.90, 0.80, 0.70};
+  const double stability = STABILITY[std::min(stableIters_, 6)];
+
+  // 2) Score drop vs the previous iteration (a rising score lets us move a bit sooner).
+  double drop = 1.0;
+  if (havePrevScore_) {
+    const int d = std::clamp(prevScore_ - score, -300, 300);
+    drop = std::clamp(1.0 + static_cast<double>(d) / 300.0, 0.90, 1.60);
+  }
+
+  // 3) Root node share of the best move: a dominant move is an "easy" move.
+  const double share = std::clamp(bestNodeShare, 0.0, 1.0);
+  const double nodeTm = 1.6 - share; // 0.6 .. 1.6
+
+  scale_ = stability * drop * nodeTm;
+  prevScore_ = score;
+  havePrevScore_ = true;
+}
+
+bool TimeManager::stopAfterIteration(std::uint64_t elapsedMs) const {
+  double limit = static_cast<double>(softMs_) * scale_;
+  if (limit > static_cast<double>(hardMs_)) limit = static_cast<double>(hardMs_);
+  return static_cast<double>(elapsedMs) >= limit;
+}
+
+} // namespace citadel
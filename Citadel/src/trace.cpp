@@ -0,0 +1,156 @@
+#include "citadel/trace.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace citadel {
+
+namespace {
+
+constexpr std::size_t RING_SIZE = 1u << 15; // events per thread
+
+struct TraceEvent {
+  const char* name;
+  const char* category;
+  const char* argName;
+  std::int64_t arg;
+  std::uint64_t tsNs;
+  std::uint64_t durNs;
+  char phase; // 'X' complete, 'i' instant
+};
+
+struct ThreadRing {
+  int tid = 0;
+  const char* threadName = nullptr;
+  std::atomic<std::uint64_t> written{0}; // total events ever pushed; slot = written % RING_SIZE
+  std::array<TraceEvent, RING_SIZE> events{};
+
+  void push(const TraceEvent& e) {
+    const std::uint64_t n = written.load(std::memory_order_relaxed);
+    events[static_cast<std::size_t>(n % RING_SIZE)] = e;
+    written.store(n + 1, std::memory_order_release);
+  }
+};
+
+// Rings outlive their threads so that events of finished workers still reach the file. A thread
+// that exits hands its ring back, and the next new thread continues it (same timeline row), so
+// the UCI loop's search thread per `go` does not add a ring per move.
+std::mutex REGISTRY_MUTEX;
+std::vector<std::unique_ptr<ThreadRing>> RINGS;
+std::vector<ThreadRing*> FREE_RINGS;
+std::string TRACE_PATH;
+std::chrono::steady_clock::time_point EPOCH = std::chrono::steady_clock::now();
+
+struct RingOwner {
+  ThreadRing* ring = nullptr;
+
+  ~RingOwner() {
+    if (!ring) return;
+    std::lock_guard<std::mutex> lock(REGISTRY_MUTEX);
+    FREE_RINGS.push_back(ring);
+  }
+};
+
+thread_local RingOwner LOCAL_RING;
+
+ThreadRing& localRing() {
+  if (!LOCAL_RING.ring) {
+    std::lock_guard<std::mutex> lock(REGISTRY_MUTEX);
+    if (!FREE_RINGS.empty()) {
+      LOCAL_RING.ring = FREE_RINGS.back();
+      FREE_RINGS.pop_back();
+    } else {
+      RINGS.push_back(std::make_unique<ThreadRing>());
+      LOCAL_RING.ring = RINGS.back().get();
+      LOCAL_RING.ring->tid = static_cast<int>(RINGS.size());
+    }
+  }
+  return *LOCAL_RING.ring;
+}
+
+std::uint64_t nowNs() {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - EPOCH).count());
+}
+
+void writeEvent(std::FILE* f, bool& first, int tid, const TraceEvent& e) {
+  std::fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", first ? "" : ",", e.name, e.category, e.phase, tid,
+               static_cast<double>(e.tsNs) / 1000.0);
+  if (e.phase == 'X') std::fprintf(f, ",\"dur\":%.3f", static_cast<double>(e.durNs) / 1000.0);
+  if (e.phase == 'i') std::fprintf(f, ",\"s\":\"t\"");
+  if (e.argName) std::fprintf(f, ",\"args\":{\"%s\":%lld}", e.argName, static_cast<long long>(e.arg));
+  std::fprintf(f, "}");
+  first = false;
+}
+
+// Caller holds REGISTRY_MUTEX.
+bool writeTraceFile(const std::string& path) {
+  std::FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) return false;
+  std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  bool first = true;
+  for (const auto& ring : RINGS) {
+    const std::uint64_t n = ring->written.load(std::memory_order_acquire);
+    if (n == 0) continue;
+    if (ring->threadName) {
+      std::fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",", ring->tid,
+                   ring->threadName);
+      first = false;
+    }
+    const std::uint64_t begin = (n > RING_SIZE) ? n - RING_SIZE : 0;
+    for (std::uint64_t i = begin; i < n; ++i) writeEvent(f, first, ring->tid, ring->events[static_cast<std::size_t>(i % RING_SIZE)]);
+  }
+  std::fprintf(f, "\n]}\n");
+  return std::fclose(f) == 0;
+}
+
+} // namespace
+
+bool traceOpen(const std::string& path) {
+  traceClose();
+  std::lock_guard<std::mutex> lock(REGISTRY_MUTEX);
+  // Fail early rather than after the search.
+  std::FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) return false;
+  std::fclose(f);
+  for (auto& ring : RINGS) ring->written.store(0, std::memory_order_relaxed);
+  TRACE_PATH = path;
+  EPOCH = std::chrono::steady_clock::now();
+  detail::TRACE_ENABLED.store(true, std::memory_order_release);
+  return true;
+}
+
+void traceClose() {
+  if (!detail::TRACE_ENABLED.exchange(false, std::memory_order_acq_rel)) return;
+  std::lock_guard<std::mutex> lock(REGISTRY_MUTEX);
+  (void)writeTraceFile(TRACE_PATH);
+  TRACE_PATH.clear();
+}
+
+void traceThreadName(const char* name) {
+  if (!traceEnabled()) return;
+  localRing().threadName = name;
+}
+
+void traceInstant(const char* name, const char* category, const char* argName, std::int64_t arg) {
+  if (!traceEnabled()) return;
+  localRing().push(TraceEvent{name, category, argName, arg, nowNs(), 0, 'i'});
+}
+
+TraceScope::TraceScope(const char* name, const char* category, const char* argName, std::int64_t arg)
+    : name_(name), category_(category), argName_(argName), arg_(arg) {
+  if (!traceEnabled()) return;
+  active_ = true;
+  startNs_ = nowNs();
+}
+
+TraceScope::~TraceScope() {
+  if (!active_ || !traceEnabled()) return;
+  const std::uint64_t end = nowNs();
+  localRing().push(TraceEvent{name_, category_, argName_, arg_, startNs_, end - startNs_, 'X'});
+}
+
+} // namespace citadel
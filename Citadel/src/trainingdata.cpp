@@ -0,0 +1,280 @@
+#include "citadel/trainingdata.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+namespace citadel {
+
+std::optional<DataFormat> parseDataFormat(std::string_view s) {
+  if (s == "text" || s == "txt") return DataFormat::Text;
+  if (s == "bin" || s == "packed") return DataFormat::Packed;
+  if (s == "chain") return DataFormat::Chain;
+  return std::nullopt;
+}
+
+const char* dataFormatName(DataFormat f) {
+  switch (f) {
+    case DataFormat::Text:
+      return "text";
+    case DataFormat::Packed:
+      return "bin";
+    case DataFormat::Chain:
+      return "chain";
+  }
+  return "?";
+}
+
+std::int8_t PackedPosition::rawAt(std::uint8_t s) const {
+  const std::uint8_t byte = cells[s / 2u];
+  const int nib = (s & 1u) ? (byte >> 4) : (byte & 0x0F);
+  if (nib == 0) return 0;
+  const bool reinf = (reinforced[s / 8u] >> (s % 8u)) & 1u;
+  const int v = (nib <= 7) ? nib : -(nib - 7);
+  return static_cast<std::int8_t>(reinf ? (v > 0 ? v + 1 : v - 1) : v);
+}
+
+PackedPosition packPosition(const Position& pos, int eval, std::int8_t result, int ply) {
+  PackedPosition pp;
+  for (std::uint8_t s = 0; s < SQ_N; ++s) {
+    int v = pos.rawAt(s);
+    if (v == 8 || v == -8) {
+      pp.reinforced[s / 8u] = static_cast<std::uint8_t>(pp.reinforced[s / 8u] | (1u << (s % 8u)));
+      v = (v > 0) ? 7 : -7;
+    }
+    const auto nib = static_cast<std::uint8_t>((v >= 0) ? v : 7 - v);
+    pp.cells[s / 2u] = static_cast<std::uint8_t>(pp.cells[s / 2u] | ((s & 1u) ? (nib << 4) : nib));
+  }
+
+  if (pos.turn() == Color::Black) pp.flags |= PackedPosition::kFlagBlackToMove;
+  if (pos.bastionRight(Color::White)) pp.flags |= PackedPosition::kFlagBastionWhite;
+  if (pos.bastionRight(Color::Black)) pp.flags |= PackedPosition::kFlagBastionBlack;
+  if (pos.wallBuiltLast(Color::White)) pp.flags |= PackedPosition::kFlagWallBuiltWhite;
+  if (pos.wallBuiltLast(Color::Black)) pp.flags |= PackedPosition::kFlagWallBuiltBlack;
+
+  pp.result = result;
+  pp.eval = static_cast<std::int16_t>(std::clamp(eval, -32767, 32767));
+  pp.ply = static_cast<std::uint16_t>(std::clamp(ply, 0, 65535));
+  pp.halfmove = static_cast<std::uint16_t>(std::clamp(pos.halfmoveClock(), 0, 65535));
+  pp.fullmove = static_cast<std::uint16_t>(std::clamp(pos.fullmoveNumber(), 0, 65535));
+  return pp;
+}
+
+Position unpackPosition(const PackedPosition& pp) {
+  std::array<std::int8_t, SQ_N> board{};
+  for (std::uint8_t s = 0; s < SQ_N; ++s) board[s] = pp.rawAt(s);
+  return Position::fromRaw(board, pp.turn(), {pp.bastionRight(Color::White), pp.bastionRight(Color::Black)},
+                           {pp.wallBuiltLast(Color::White), pp.wallBuiltLast(Color::Black)}, pp.halfmove, pp.fullmove);
+}
+
+int moveIndexOf(Position& pos, const Move& m) {
+  MoveList moves;
+  pos.generateMoves(moves);
+  for (std::uint32_t i = 0; i < moves.size; ++i) {
+    const Move& c = moves.buf[i];
+    if (c.type == m.type && c.from == m.from && c.to == m.to && c.aux1 == m.aux1 && c.aux2 == m.aux2) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+std::optional<TextSample> parseTextSample(std::string_view line) {
+  const std::size_t bar = line.find('|');
+  if (line.empty() || line.front() == '#' || bar == std::string_view::npos) return std::nullopt;
+
+  std::string_view fen = line.substr(0, bar);
+  while (!fen.empty() && fen.back() == ' ') fen.remove_suffix(1);
+  if (fen.empty()) return std::nullopt;
+
+  // Fields after the bar: <stm> <eval> [<result>].
+  std::string_view rest = line.substr(bar + 1);
+  std::string_view fields[3];
+  int n = 0;
+  while (n < 3) {
+    while (!rest.empty() && (rest.front() == ' ' || rest.front() == '\t' || rest.front() == '\r')) rest.remove_prefix(1);
+    if (rest.empty()) break;
+    const std::size_t end = std::min(rest.find_first_of(" \t\r"), rest.size());
+    fields[n++] = rest.substr(0, end);
+    rest.remove_prefix(end);
+  }
+  if (n < 2 || (fields[0] != "w" && fields[0] != "b")) return std::nullopt;
+
+  TextSample s;
+  s.fen = std::string(fen);
+  s.stm = (fields[0] == "w") ? Color::White : Color::Black;
+  auto parseInt = [](std::string_view f, int& v) { return std::from_chars(f.data(), f.data() + f.size(), v).ec == std::errc{}; };
+  if (!parseInt(fields[1], s.eval)) return std::nullopt;
+  if (n == 3) {
+    int r = 0;
+    if (!parseInt(fields[2], r) || r < -1 || r > 1) return std::nullopt;
+    s.result = static_cast<std::int8_t>(r);
+  }
+  return s;
+}
+
+std::string formatTextSample(const TextSample& s) {
+  std::string line = s.fen;
+  line += (s.stm == Color::White) ? " | w " : " | b ";
+  line += std::to_string(s.eval);
+  if (s.result != kResultUnknown) {
+    line.push_back(' ');
+    line += std::to_string(s.result);
+  }
+  return line;
+}
+
+template <typename T>
+static void appendRaw(std::string& buf, const T& v) {
+  buf.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+void appendDataFileHeader(std::string& buf, DataFormat format) {
+  DataFileHeader h;
+  h.format = static_cast<std::uint16_t>(format);
+  appendRaw(buf, h);
+}
+
+void appendPacked(std::string& buf, const PackedPosition& pp) {
+  appendRaw(buf, pp);
+}
+
+void appendChainGame(std::string& buf, const PackedPosition& start, const std::vector<ChainEntry>& entries) {
+  appendRaw(buf, start);
+  appendRaw(buf, static_cast<std::uint32_t>(entries.size()));
+  buf.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ChainEntry));
+}
+
+TrainingDataReader::TrainingDataReader(const std::string& path) : path_(path) {
+  in_.open(path, std::ios::binary);
+  if (!in_) throw std::runtime_error("training data: failed to open " + path);
+
+  DataFileHeader h;
+  const DataFileHeader expect;
+  in_.read(reinterpret_cast<char*>(&h), sizeof(h));
+  if (static_cast<std::size_t>(in_.gcount()) != sizeof(h) || h.magic != expect.magic) {
+    in_.clear();
+    in_.seekg(0);
+    format_ = DataFormat::Text;
+    return;
+  }
+  if (h.version != expect.version) throw std::runtime_error("training data: unsupported version in " + path);
+  if (h.format != static_cast<std::uint16_t>(DataFormat::Packed) && h.format != static_cast<std::uint16_t>(DataFormat::Chain)) {
+    throw std::runtime_error("training data: unknown record format in " + path);
+  }
+  format_ = static_cast<DataFormat>(h.format);
+}
+
+bool TrainingDataReader::readBytes(void* dst, std::size_t n) {
+  in_.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(n));
+  const auto got = static_cast<std::size_t>(in_.gcount());
+  if (got == n) return true;
+  if (got != 0) throw std::runtime_error("training data: truncated record in " + path_);
+  return false;
+}
+
+bool TrainingDataReader::nextTextLine(std::string& line) {
+  while (std::getline(in_, line)) {
+    ++lineNo_;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (!line.empty() && line.front() != '#') return true;
+  }
+  return false;
+}
+
+PackedPosition TrainingDataReader::parseTextLine(const std::string& line, std::uint64_t lineNo) const {
+  const auto s = parseTextSample(line);
+  if (!s) throw std::runtime_error("training data: bad sample at line " + std::to_string(lineNo) + " of " + path_);
+  try {
+    return packPosition(Position::fromFEN(s->fen), s->eval, s->result, 0);
+  } catch (const std::exception& e) {
+    throw std::runtime_error("training data: bad FEN at line " + std::to_string(lineNo) + " of " + path_ + ": " + e.what());
+  }
+}
+
+std::size_t TrainingDataReader::nextBatch(std::vector<PackedPosition>& out, std::size_t max, int threads) {
+  out.clear();
+  if (format_ != DataFormat::Text) {
+    PackedPosition pp;
+    while (out.size() < max && next(pp)) out.push_back(pp);
+    return out.size();
+  }
+
+  std::vector<std::string> lines;
+  std::vector<std::uint64_t> lineNos;
+  std::string line;
+  while (lines.size() < max && nextTextLine(line)) {
+    lines.push_back(line);
+    lineNos.push_back(lineNo_);
+  }
+  out.resize(lines.size());
+
+  // Contiguous slices per thread; the first error (if any) is rethrown after the join.
+  const std::size_t n = lines.size();
+  const std::size_t workers = std::clamp<std::size_t>(static_cast<std::size_t>(std::max(threads, 1)), 1, std::max<std::size_t>(n / 256, 1));
+  std::vector<std::exception_ptr> errors(workers);
+  auto work = [&](std::size_t w) {
+    try {
+      for (std::size_t i = n * w / workers; i < n * (w + 1) / workers; ++i) out[i] = parseTextLine(lines[i], lineNos[i]);
+    } catch (...) {
+      errors[w] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> pool;
+  for (std::size_t w = 1; w < workers; ++w) pool.emplace_back(work, w);
+  work(0);
+  for (auto& t : pool) t.join();
+  for (const auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+  return out.size();
+}
+
+bool TrainingDataReader::next(PackedPosition& out) {
+  if (format_ == DataFormat::Packed) return readBytes(&out, sizeof(out));
+  if (format_ == DataFormat::Text) {
+    std::string line;
+    if (!nextTextLine(line)) return false;
+    out = parseTextLine(line, lineNo_);
+    return true;
+  }
+
+  while (true) {
+    while (chainLeft_ == 0) {
+      if (!readBytes(&chainStart_, sizeof(chainStart_))) return false;
+      if (!readBytes(&chainLeft_, sizeof(chainLeft_))) throw std::runtime_error("training data: truncated game in " + path_);
+      chainPos_ = unpackPosition(chainStart_);
+      chainPly_ = chainStart_.ply;
+    }
+
+    ChainEntry e;
+    if (!readBytes(&e, sizeof(e))) throw std::runtime_error("training data: truncated game in " + path_);
+    --chainLeft_;
+    const bool sample = e.eval != kChainNoSample;
+    if (sample) out = packPosition(chainPos_, e.eval, chainStart_.result, chainPly_);
+    if (chainLeft_ == 0) {
+      if (sample) return true; // the last move only matters to the writer
+      continue;
+    }
+
+    MoveList moves;
+    chainPos_.generateMoves(moves);
+    if (e.moveIndex >= moves.size) throw std::runtime_error("training data: move index out of range in " + path_);
+    Undo u;
+    chainPos_.makeMove(moves.buf[e.moveIndex], u);
+    ++chainPly_;
+    if (sample) return true;
+  }
+}
+
+bool TrainingDataReader::nextGame(PackedPosition& start, std::vector<ChainEntry>& entries) {
+  if (format_ != DataFormat::Chain) throw std::runtime_error("training data: nextGame() needs a chain file: " + path_);
+  if (!readBytes(&start, sizeof(start))) return false;
+  std::uint32_t count = 0;
+  if (!readBytes(&count, sizeof(count))) throw std::runtime_error("training data: truncated game in " + path_);
+  entries.resize(count);
+  if (count > 0 && !readBytes(entries.data(), count * sizeof(ChainEntry))) throw std::runtime_error("training data: truncated game in " + path_);
+  return true;
+}
+
+} // namespace citadel
@@ -0,0 +1,185 @@
+#include "citadel/uciprocess.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace citadel {
+
+UciProcess::~UciProcess() {
+  stop();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// Close-on-exec pipe: engines started concurrently from other threads must not inherit each
+// other's pipe ends, or an engine's stdin never sees EOF and a crash never closes its output.
+static int cloexecPipe(int fds[2]) {
+#if defined(__APPLE__)
+  // No pipe2(); a fork in another thread between the two calls can still leak the pipe.
+  if (::pipe(fds) != 0) return -1;
+  ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+#else
+  return ::pipe2(fds, O_CLOEXEC);
+#endif
+}
+
+// Makes `fd` the child's descriptor `target`, kept across exec (dup2 does not copy
+// FD_CLOEXEC; when fd already is target the flag is cleared instead).
+static void childRedirect(int fd, int target) {
+  if (fd == target) ::fcntl(fd, F_SETFD, 0);
+  else ::dup2(fd, target);
+}
+
+bool UciProcess::start(const std::string& command) {
+  stop();
+  // A dead engine must show up as a failed write, not kill the whole match.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  int in[2];
+  int out[2];
+  if (cloexecPipe(in) != 0) {
+    lastError_ = std::string("pipe: ") + std::strerror(errno);
+    return false;
+  }
+  if (cloexecPipe(out) != 0) {
+    lastError_ = std::string("pipe: ") + std::strerror(errno);
+    ::close(in[0]);
+    ::close(in[1]);
+    return false;
+  }
+
+  const pid_t pid = ::fork();
+  if (pid < 0) {
+    lastError_ = std::string("fork: ") + std::strerror(errno);
+    for (const int fd : {in[0], in[1], out[0], out[1]}) ::close(fd);
+    return false;
+  }
+  if (pid == 0) {
+    // Everything else, including the pipes of other engines, is closed by exec.
+    childRedirect(in[0], STDIN_FILENO);
+    childRedirect(out[1], STDOUT_FILENO);
+    ::execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+    ::_exit(127);
+  }
+
+  ::close(in[0]);
+  ::close(out[1]);
+  pid_ = pid;
+  toChild_ = in[1];
+  fromChild_ = out[0];
+  alive_ = true;
+  buffer_.clear();
+  return true;
+}
+
+void UciProcess::stop() {
+  if (pid_ < 0) return;
+  if (alive_) send("quit");
+  ::close(toChild_);
+
+  // Give the engine a moment to exit on its own before it is killed.
+  int status = 0;
+  bool exited = false;
+  for (int i = 0; i < 50 && !exited; ++i) {
+    exited = ::waitpid(pid_, &status, WNOHANG) == pid_;
+    if (!exited) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  if (!exited) {
+    ::kill(pid_, SIGKILL);
+    ::waitpid(pid_, &status, 0);
+  }
+  ::close(fromChild_);
+  pid_ = toChild_ = fromChild_ = -1;
+  alive_ = false;
+}
+
+bool UciProcess::send(const std::string& line) {
+  if (!alive_) return false;
+  std::string msg = line;
+  msg.push_back('\n');
+  std::size_t done = 0;
+  while (done < msg.size()) {
+    const ssize_t n = ::write(toChild_, msg.data() + done, msg.size() - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      lastError_ = std::string("write: ") + std::strerror(errno);
+      alive_ = false;
+      return false;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+std::optional<std::string> UciProcess::readLine(int timeoutMs) {
+  using Clock = std::chrono::steady_clock;
+  const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs < 0 ? 0 : timeoutMs);
+  while (true) {
+    const std::size_t nl = buffer_.find('\n');
+    if (nl != std::string::npos) {
+      std::string line = buffer_.substr(0, nl);
+      buffer_.erase(0, nl + 1);
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      return line;
+    }
+    if (pid_ < 0 || fromChild_ < 0) return std::nullopt;
+
+    int wait = -1;
+    if (timeoutMs >= 0) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+      if (left <= 0) return std::nullopt;
+      wait = static_cast<int>(left);
+    }
+    pollfd pfd{fromChild_, POLLIN, 0};
+    const int ready = ::poll(&pfd, 1, wait);
+    if (ready < 0 && errno == EINTR) continue;
+    if (ready == 0) return std::nullopt;
+
+    char chunk[4096];
+    const ssize_t n = ::read(fromChild_, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      alive_ = false;
+      lastError_ = "engine closed its output";
+      return std::nullopt;
+    }
+    buffer_.append(chunk, static_cast<std::size_t>(n));
+  }
+}
+
+#else
+
+bool UciProcess::start(const std::string& command) {
+  (void)command;
+  lastError_ = "UCI engine processes are only supported on POSIX systems";
+  return false;
+}
+
+void UciProcess::stop() {}
+
+bool UciProcess::send(const std::string& line) {
+  (void)line;
+  return false;
+}
+
+std::optional<std::string> UciProcess::readLine(int timeoutMs) {
+  (void)timeoutMs;
+  return std::nullopt;
+}
+
+#endif
+
+} // namespace citadel